@@ -0,0 +1,47 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <SDL3/SDL.h>
+
+// Alignment of every arena allocation: a cache line, so scratch of two threads never shares one
+#define ARENA_ALIGNMENT 64
+
+// Size of a huge page; arenas backed by huge pages round their capacity up to it
+#define ARENA_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+// initArena() flag: ask the system to back the arena with huge pages (Linux transparent huge pages,
+// ignored elsewhere), which saves TLB misses when a large arena is walked every frame
+#define ARENA_HUGE_PAGES 1
+
+// Extra block an arena allocated when its memory ran out
+typedef struct ArenaBlock ArenaBlock;
+
+// Bump allocator for scratch memory that lives until the next resetArena(). Allocating moves a pointer;
+// nothing is freed on its own. Requests that do not fit get a block from the heap, and the next reset
+// replaces the arena's memory by one block as large as the most it ever held, so after warm-up a
+// thread's scratch costs no heap allocation at all.
+typedef struct {
+    unsigned char* base;  // Memory of the arena
+    size_t capacity;      // Bytes at 'base'
+    size_t used;          // Bytes allocated since the last reset, overflow blocks included
+    size_t highWater;     // Most bytes the arena held between two resets
+    ArenaBlock* overflow; // Blocks allocated since the last reset because 'base' was full
+    int flags;            // Flags the arena was created with
+    int mapped;           // 'base' was mapped from the system instead of allocated from the heap
+    Uint64 heapAllocations; // Blocks ever requested from the heap or the system, the first one included
+} Arena;
+
+// Creates an arena of 'capacity' bytes with the given flags (0 or ARENA_HUGE_PAGES).
+// Returns 0 (after printing an error) when its memory cannot be allocated.
+int initArena(Arena* arena, size_t capacity, int flags);
+
+// Frees the memory of the arena
+void freeArena(Arena* arena);
+
+// Returns 'size' bytes aligned to ARENA_ALIGNMENT, or NULL (after printing an error) when the heap is out of memory
+void* arenaAlloc(Arena* arena, size_t size);
+
+// Releases everything allocated from the arena and grows it to its high-water mark if it overflowed
+void resetArena(Arena* arena);
+
+#endif // ARENA_H
@@ -10,6 +10,24 @@ typedef struct {
     Vector max;  // Maximum corner
 } AABB;
 
+// Largest number of subtrees cullBVHFrustum() hands out for one frustum
+#define BVH_FRUSTUM_MAX_NODES 16
+
+// Pyramid of rays that share an origin, bounded by four side planes through it
+typedef struct {
+    Vector origin;     // Apex shared by the rays
+    Vector normals[4]; // Side plane normals, pointing into the pyramid
+} BVHFrustum;
+
+// Largest number of objects buildBVH() puts in a leaf
+#define BVH_LEAF_SIZE 2
+
+// SAH cost of visiting an inner node, relative to intersecting one object
+#define BVH_TRAVERSAL_COST 1.0f
+
+// rebuildDegradedBVH() rebuilds a subtree once refits have made it this much more costly than when it was built
+#define BVH_REBUILD_COST_RATIO 1.5f
+
 // Forward declaration of Scene
 struct Scene;
 
@@ -19,6 +37,9 @@ typedef struct BVHNode{
     struct BVHNode* left;  // Left child
     struct BVHNode* right; // Right child
     Objects objects;       // Objects in the leaf node
+    int sources[BVH_LEAF_SIZE]; // Leaves: index of each object in the arrays the BVH was built from (planes, spheres, then triangles)
+    float cost;            // SAH cost of a ray that enters 'bounds', in object intersections (kept up to date by refitBVH())
+    float builtCost;       // 'cost' when the subtree was built
 } BVHNode;
 
 // Structure to store an object along with its center and type
@@ -27,13 +48,16 @@ struct ObjectArray
     Vector center; // Center of the object (used for sorting)
     void* object; // Pointer to the actual object (Plane, Sphere, or Triangle)
     int type; // 0 = Plane, 1 = Sphere, 2 = Triangle
+    int source; // Index of the object in the arrays the BVH is built from
 };
 
 typedef struct {
     Vector point; // The intersection point
     Vector normal; // The normal at the intersection point
     Material material; // The material of the intersected object
-    int objectType; // The type of the intersected object
+    int objectType; // The type of the intersected object (0 = sphere, 1 = plane, 2 = triangle, -1 = no hit)
+    const void* object; // Identity of the intersected primitive (stable while the BVH exists), NULL for no hit
+    float distance; // Distance along the ray to the intersection point
 } ObjectIntersection;
 
 // Compute AABB for a single sphere
@@ -48,12 +72,52 @@ AABB computeTriangleAABB(Triangle* triangle);
 // Build the BVH Tree
 BVHNode* buildBVH(Objects* objects);
 
+// Deep copy of a BVH, for a scene version that refits it while others still trace the original.
+// Returns NULL (after printing an error) when memory runs out.
+BVHNode* copyBVH(const BVHNode* node);
+
+// Follows objects that moved without adding or removing any: every leaf copy is refreshed from 'objects' (the
+// arrays the BVH was built from, same counts and order; NULL keeps the copies) and the bounds and SAH costs
+// are recomputed bottom-up. O(n) and allocation free, but the tree keeps its shape, so objects that travel
+// far leave it with overlapping boxes; rebuildDegradedBVH() repairs that.
+void refitBVH(BVHNode* root, const Objects* objects);
+
+// Returns the number of objects in the leaves of a BVH
+int countBVHObjects(const BVHNode* root);
+
+// Rebuilds, in place, the subtrees whose cost grew past maxCostRatio times their builtCost: the whole tree
+// when the root degraded, otherwise only the degraded subtrees below it. The root node keeps its address.
+// Returns the number of subtrees rebuilt.
+int rebuildDegradedBVH(BVHNode* root, float maxCostRatio);
+
 // Check for intersection between Ray and AABB
 float intersectAABB(Ray ray, AABB box);
 
-// Recursively checks for ray intersections with a BVH (Bounding Volume Hierarchy) tree.
+// Finds the closest intersection of the ray with the objects in a BVH (Bounding Volume Hierarchy) tree.
+// Returns 1 and fills 'hit' when the ray hits an object, 0 otherwise.
 int intersectBVH(Ray ray, BVHNode* node, ObjectIntersection* hit);
 
+// Finds the closest intersection of the ray with the objects below any of the given BVH nodes
+// (subtrees of one tree that do not overlap, e.g. from cullBVHFrustum()).
+// Returns 1 and fills 'hit' when the ray hits an object, 0 otherwise.
+int intersectBVHNodes(Ray ray, BVHNode* const* nodes, int count, ObjectIntersection* hit);
+
+// Builds the frustum of the rays from 'origin' through the four corner directions, given in order around it
+void initBVHFrustum(BVHFrustum* frustum, Vector origin, const Vector corners[4]);
+
+// Walks the BVH once against a frustum and collects, nearest first, the subtrees that a ray inside the
+// frustum can hit: nodes entirely inside it and leaves that cross its sides. Nodes outside are dropped.
+// When that would take more than 'capacity' nodes (at most BVH_FRUSTUM_MAX_NODES), the deepest node holding everything the frustum
+// overlaps is returned alone instead. Returns the number of nodes written (0 when nothing is visible).
+int cullBVHFrustum(BVHNode* root, const BVHFrustum* frustum, BVHNode** nodes, int capacity);
+
+// Traces up to SIMD_LANES shadow rays together through the BVH with any-hit semantics: a ray stops at the
+// first object it meets before its maxDistance (__FLT_MAX__ for directional lights). Nodes are tested for all
+// rays at once, and nodes outside the box around the rays' segments are skipped with a single test, so the
+// rays of one light from nearby points share most of the walk.
+// Returns a bitmask with bit i set when rays[i] is blocked.
+int traceShadowPacketBVH(BVHNode* root, const Ray* rays, const float* maxDistances, int count);
+
 // Free the BVH tree
 void freeBVH(BVHNode *node);
 
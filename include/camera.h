@@ -13,12 +13,45 @@ typedef struct {
     float aspectRatio;   // Screen width / screen height
 } Camera;
 
+// Ray generation basis for one frame, precomputed from a Camera so per-pixel work is a few adds
+typedef struct {
+    Vector origin;     // Shared origin of every primary ray (the camera position)
+    Vector topLeft;    // Unnormalized direction through the center of pixel (0, 0)
+    Vector deltaX;     // Direction change from one pixel to the next one on the right
+    Vector deltaY;     // Direction change from one row to the next one down
+    int screenWidth;   // Image width in pixels
+    int screenHeight;  // Image height in pixels
+} RayGenerator;
+
 // Function to initialize a camera with position, direction, up vector, FOV, and screen dimensions
 void initCamera(Camera* camera, Vector pos, Vector dir, Vector up, float fov, int screenWidth, int screenHeight);
 
 // Function to generate a ray from a given pixel position on the screen
 Ray mapPixelToRay(Camera* camera, int pixelX, int pixelY, int screenWidth, int screenHeight);
 
+// Function to precompute the ray generation basis for the current camera state (call once per frame)
+void initRayGenerator(RayGenerator* generator, Camera* camera, int screenWidth, int screenHeight);
+
+// Function to shift every ray of the generator by the same sub-pixel offset (in pixels, relative to the pixel center).
+// Jittering the whole frame keeps row generation incremental while successive frames sample different sub-pixel positions.
+void setRayGeneratorJitter(RayGenerator* generator, float offsetX, float offsetY);
+
+// Function to generate the primary ray through an image-plane position given in pixels.
+// Pixel centers are at (x + 0.5, y + 0.5); fractional positions allow jittered samples.
+Ray generateRay(const RayGenerator* generator, float imageX, float imageY);
+
+// Function to generate the primary rays of 'count' consecutive pixels starting at (pixelX, pixelY), SIMD_LANES at a time.
+// A pixel's ray does not depend on where the row segment starts, so tiles of any size and split produce the same image.
+void generateRayRow(const RayGenerator* generator, int pixelX, int pixelY, int count, Ray* rays);
+
+// Function to generate the primary rays of a tile, stored row by row (width * height rays)
+void generateRayTile(const RayGenerator* generator, int pixelX, int pixelY, int width, int height, Ray* rays);
+
+// Function to project a world-space point into the image of the generator (the inverse of generateRay).
+// Returns 0 when the point is not in front of the camera; otherwise fills the image position in pixels
+// (pixel centers at x + 0.5) and the depth of the point along the view direction.
+int projectPointToPixel(const RayGenerator* generator, Vector point, float* imageX, float* imageY, float* depth);
+
 // Function to move the camera forward along the direction vector
 void moveCameraForward(Camera* camera);
 
@@ -0,0 +1,9 @@
+#ifndef COLOR_H
+#define COLOR_H
+
+// Linear RGB color with unbounded float channels (1.0 is full display brightness)
+typedef struct {
+    float r, g, b;
+} FloatColor;
+
+#endif // COLOR_H
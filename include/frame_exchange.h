@@ -0,0 +1,56 @@
+#ifndef FRAME_EXCHANGE_H
+#define FRAME_EXCHANGE_H
+
+#include <SDL3/SDL.h>
+#include "render_functions.h" // For RenderStats
+
+// Frames a FrameExchange cycles through: one being rendered, one being shown, one waiting between them
+#define FRAME_EXCHANGE_SLOTS 3
+
+// Pixels and statistics of one finished frame
+typedef struct {
+    Uint32* pixels;           // Resolved pixels, FrameExchange.pixelsPerRow per row
+    int width;                // Rendered area in the top-left corner of 'pixels'
+    int height;
+    Uint64 frameNumber;       // Frames published before this one plus one, 0 for a slot that was never published
+    RenderStats stats;        // Ray counts of the frame
+    double renderMilliseconds; // Time renderFrame() took
+    Uint64 timedFrames;       // RenderState.timedFrames and timedMilliseconds after the frame
+    double timedMilliseconds;
+} RenderedFrame;
+
+// Lock-free triple buffer that hands finished frames from a render thread to a presentation thread.
+// The render thread owns one slot and the presenter another; publishing and acquiring swap the owned
+// slot with the one in the middle through a single atomic exchange, so neither thread ever waits for
+// the other and the presenter always gets the newest frame (frames it was too slow for are skipped).
+typedef struct {
+    RenderedFrame frames[FRAME_EXCHANGE_SLOTS];
+    int pixelsPerRow;      // Row length of every slot's pixels
+    int maxHeight;         // Rows of every slot's pixels
+    int renderSlot;        // Slot the render thread fills, only touched by it
+    int presentSlot;       // Slot the presenter shows, only touched by it
+    SDL_AtomicInt middle;  // Slot between the two, plus FRAME_EXCHANGE_FRESH once it holds a frame not acquired yet
+    Uint64 published;      // Frames published so far, only touched by the render thread
+} FrameExchange;
+
+// Flag in FrameExchange.middle marking a published frame the presenter has not taken yet
+#define FRAME_EXCHANGE_FRESH 4
+
+// Allocates the slots for frames of up to width x height pixels. Returns 0 (after printing an error) when that fails.
+int initFrameExchange(FrameExchange* exchange, int width, int height);
+
+// Frees the slots
+void freeFrameExchange(FrameExchange* exchange);
+
+// Render thread: returns the slot to render the next frame into
+RenderedFrame* getFrameToRender(FrameExchange* exchange);
+
+// Render thread: numbers the frame returned by getFrameToRender() and makes it the newest one;
+// the render thread continues in another slot
+void publishFrame(FrameExchange* exchange);
+
+// Presentation thread: takes the newest published frame, which stays untouched until the next call.
+// Returns the same frame again when nothing was published in between, and NULL before the first frame.
+const RenderedFrame* acquireLatestFrame(FrameExchange* exchange);
+
+#endif // FRAME_EXCHANGE_H
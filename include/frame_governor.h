@@ -0,0 +1,42 @@
+#ifndef FRAME_GOVERNOR_H
+#define FRAME_GOVERNOR_H
+
+#include <SDL3/SDL.h>
+#include "render_functions.h" // For RenderSettings
+
+// Weight of the newest frame in the moving average of render times
+#define GOVERNOR_SMOOTHING 0.3f
+
+// Average render times between (1 - GOVERNOR_TOLERANCE) x target and the target leave everything as it is
+#define GOVERNOR_TOLERANCE 0.15f
+
+// Largest factor the render scale changes by in one step, so the image does not jump between sizes
+#define GOVERNOR_MAX_STEP 1.25f
+
+// Render scales are multiples of this, so timing noise does not resize the buffers every frame
+#define GOVERNOR_SCALE_STEP (1.0f / 32.0f)
+
+// Adjusts the render resolution, and the adaptive sample count once the resolution is at its minimum,
+// to keep the render time of a frame near a target
+typedef struct {
+    int enabled;               // 0 renders at full resolution with the full sample count
+    float targetMilliseconds;  // Render time per frame to aim for (for example 16 or 33 ms)
+    float minScale;            // Smallest fraction of the window width and height that is rendered
+    float scale;               // Fraction of the window width and height currently rendered
+    float averageMilliseconds; // Moving average of the render times since the last adjustment (0 = none yet)
+    int maxSamplesPerPixel;    // Sample count restored when there is time to spare
+} FrameGovernor;
+
+// Initializes a governor at full resolution; maxSamplesPerPixel is the sample count it may lower and restore
+void initFrameGovernor(FrameGovernor* governor, float targetMilliseconds, float minScale, int maxSamplesPerPixel);
+
+// Feeds the render time of the last traced frame. When the average leaves the tolerance band, the
+// scale moves by the square root of target / average (cost follows the pixel count); below minScale
+// settings->maxSamplesPerPixel is halved instead, and raised again first when there is time to spare.
+// Returns 1 when the scale or the sample count changed.
+int updateFrameGovernor(FrameGovernor* governor, double frameMilliseconds, RenderSettings* settings);
+
+// Computes the render resolution for a window of the given size at the governor's current scale
+void getGovernedResolution(const FrameGovernor* governor, int windowWidth, int windowHeight, int* width, int* height);
+
+#endif // FRAME_GOVERNOR_H
@@ -0,0 +1,96 @@
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+#include <SDL3/SDL.h>
+#include "color.h"  // For FloatColor
+#include "shapes.h" // For Vector and Material
+
+// Float RGB image that shading writes into; one plane per channel so rows resolve SIMD_LANES pixels at a time
+typedef struct {
+    float* red;    // Red channel, width * height values
+    float* green;  // Green channel
+    float* blue;   // Blue channel
+    int width;     // Width in pixels
+    int height;    // Height in pixels
+} FrameBuffer;
+
+// How float colors are mapped to the displayable [0, 1] range
+typedef enum {
+    TONE_MAP_CLAMP = 0, // Values above 1 are clipped
+    TONE_MAP_REINHARD   // x / (1 + x), keeps detail in bright areas
+} ToneMapping;
+
+// Options of the float-to-RGBA8 resolve pass
+typedef struct {
+    float exposure;          // Scale applied before tone mapping
+    ToneMapping toneMapping; // Curve that maps the scaled color into [0, 1]
+    int encodeSRGB;          // Apply the sRGB transfer curve (for linear shading output)
+    int dither;              // Add ordered dithering instead of rounding to hide banding
+} ResolveSettings;
+
+// Float buffer that sums per-pixel samples over several frames so noisy estimates converge
+typedef struct {
+    FrameBuffer sum; // Sums of the samples of each pixel
+    int frameCount;  // Number of completed frames in the sums
+} AccumulationBuffer;
+
+// Primary hit of one pixel, the record a G-buffer stores per pixel
+typedef struct {
+    const void* object; // Primitive hit, NULL for the background
+    Vector position;    // World-space hit point (a far point along the ray for the background)
+    Vector normal;      // Surface normal at the hit point
+    Material material;  // Material of the primitive
+} PixelHit;
+
+// Per-pixel surface data of the last frame's primary hits: finds edges between surfaces, is the source of
+// reprojection, and lets light-only changes shade again without tracing
+typedef struct {
+    const void** object; // Primitive hit by each pixel's center ray, NULL for the background
+    Vector* position;    // World-space hit point of each pixel's center ray (a far point for the background)
+    Vector* normal;      // Surface normal at each hit point
+    Material* material;  // Material of each hit primitive
+    int width;           // Width in pixels
+    int height;          // Height in pixels
+} GBuffer;
+
+// Allocates a frame buffer of the given size and clears it to black
+void initFrameBuffer(FrameBuffer* buffer, int width, int height);
+
+// Frees the memory of a frame buffer
+void freeFrameBuffer(FrameBuffer* buffer);
+
+// Clears every pixel of a frame buffer to black
+void clearFrameBuffer(FrameBuffer* buffer);
+
+// Tone-maps, clamps and packs rows [firstRow, firstRow + rowCount) into 32-bit pixels of the given format.
+// pixelsPerRow is the row stride of 'pixels' in Uint32 values.
+void resolveFrameBuffer(const FrameBuffer* buffer, int firstRow, int rowCount, Uint32* pixels, int pixelsPerRow, const SDL_PixelFormatDetails* format, const ResolveSettings* settings);
+
+// Allocates a G-buffer of the given size with every pixel showing the background
+void initGBuffer(GBuffer* buffer, int width, int height);
+
+// Frees the memory of a G-buffer
+void freeGBuffer(GBuffer* buffer);
+
+// Stores the hit of one pixel
+void writeGBufferHit(GBuffer* buffer, int index, const PixelHit* hit);
+
+// Reads the hit of one pixel
+PixelHit readGBufferHit(const GBuffer* buffer, int index);
+
+// Allocates an accumulation buffer of the given size and clears it
+void initAccumulationBuffer(AccumulationBuffer* buffer, int width, int height);
+
+// Frees the memory of an accumulation buffer
+void freeAccumulationBuffer(AccumulationBuffer* buffer);
+
+// Drops all accumulated samples (call when the camera or the scene changes)
+void resetAccumulationBuffer(AccumulationBuffer* buffer);
+
+// Adds every pixel of the frame to the sums and replaces the frame with the running average
+void accumulateFrameBuffer(AccumulationBuffer* buffer, FrameBuffer* frame);
+
+// Marks the end of a frame; every pixel must have received one sample
+void finishAccumulationFrame(AccumulationBuffer* buffer);
+
+#endif // FRAMEBUFFER_H
@@ -6,6 +6,7 @@
 #include "shapes.h"        // For Material
 #include "light_sources.h" // For PointLight, DirectionalLight, SpotLight
 #include "scene.h"         
+#include "color.h"         // For FloatColor
 
 struct Scene; // Forward declaration of Scene
 
@@ -30,4 +31,41 @@ float computeSpotLightSpecular(SpotLight* light, Vector point, Vector normal, Ve
 // Computes the final surface color at a given point based on lighting and material properties
 SDL_Color computeSurfaceColor(Scene* scene, Vector point, Vector normal, Vector viewDirection, Material material);
 
+// Same result as computeSurfaceColor, but evaluates point lights and spotlights SIMD_LANES at a time
+// from scene->lightBuffer (falls back to computeSurfaceColor when the buffer has not been built).
+// When scene->lightBvhRoot is set only the lights whose influence volume contains the point are visited.
+SDL_Color computeSurfaceColorBatched(Scene* scene, Vector point, Vector normal, Vector viewDirection, Material material);
+
+// Float version of computeSurfaceColorBatched: the color before clamping to 8 bits, for the float frame buffer
+FloatColor computeSurfaceRadianceBatched(Scene* scene, Vector point, Vector normal, Vector viewDirection, Material material);
+
+// Light one light would send to a surface point, and the shadow ray that decides whether it arrives
+typedef struct {
+    const void* light;  // The light (identifies it for the shadow occluder cache)
+    int lightIndex;     // Position of the light among the point lights, then spotlights, then directional lights
+    Ray shadowRay;      // Starts just above the surface and points at the light
+    float maxDistance;  // Distance to the light along the shadow ray
+    float diffuse[3];   // Unshadowed diffuse light, tinted by the light color
+    float specular[3];  // Unshadowed specular light, tinted by the light color
+} LightContribution;
+
+// Computes the unshadowed light of every light that reaches the point (culled with scene->lightBvhRoot like
+// computeSurfaceRadianceBatched) and stores up to 'capacity' of them without tracing their shadow rays.
+// Returns the number stored; a capacity of one per scene light is always enough.
+int computeLightContributions(Scene* scene, Vector point, Vector normal, Vector viewDirection, float shininess, LightContribution* contributions, int capacity);
+
+// Turns the summed diffuse and specular light that reached a surface point into its color, as the shading
+// functions do: both sums are clamped, the diffuse light is tinted by the material, and the ambient light is added
+FloatColor combineLightContributions(Scene* scene, Material material, const float diffuse[3], const float specular[3]);
+
+// Stochastic many-light mode: shades lightSamples point/spot lights picked from scene->lightBvhRoot in
+// proportion to their estimated contribution, weighted by 1 / (lightSamples * probability) so the summed light is
+// an unbiased estimate of the full loop. Each sample traces at most one shadow ray. Average several frames to
+// converge: the sums are left unclamped so the average is not darkened, and are clamped when the average is
+// resolved. Directional lights are always shaded.
+SDL_Color computeSurfaceColorSampled(Scene* scene, Vector point, Vector normal, Vector viewDirection, Material material, int lightSamples, Uint32* randomState);
+
+// Float version of computeSurfaceColorSampled, for the float frame buffer
+FloatColor computeSurfaceRadianceSampled(Scene* scene, Vector point, Vector normal, Vector viewDirection, Material material, int lightSamples, Uint32* randomState);
+
 #endif // ILLUMINATION_H
\ No newline at end of file
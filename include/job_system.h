@@ -0,0 +1,62 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <SDL3/SDL.h>
+
+// Largest number of threads a job system runs jobs on, the thread that created it included
+#define MAX_JOB_WORKERS 64
+
+// Jobs one worker can have queued; a job submitted to a full deque runs at once on the submitting thread
+#define JOB_DEQUE_CAPACITY 4096
+
+// Rounds an idle worker keeps looking for work before it sleeps
+#define JOB_SPIN_ROUNDS 64
+
+// Function run by a job
+typedef void (*JobFunction)(void* data);
+
+// Body of a parallel loop, called for consecutive index ranges [begin, end) on any worker
+typedef void (*ParallelForFunction)(int begin, int end, void* data);
+
+// Number of unfinished jobs of a group. A job may submit child jobs with a counter of its own and
+// wait for them; waiting runs other jobs instead of blocking the worker.
+typedef struct {
+    SDL_AtomicInt pending;
+} JobCounter;
+
+// Fixed pool of worker threads. Every worker owns a Chase-Lev deque: it pushes and pops jobs at the
+// bottom, and idle workers steal the oldest jobs from the top of the others' deques. Workers that find
+// nothing to steal sleep on a condition variable until new jobs are queued.
+typedef struct JobSystem JobSystem;
+
+// Starts a job system that runs jobs on workerCount threads: the calling thread (worker 0, which runs
+// jobs while it waits for them) and workerCount - 1 new threads. workerCount <= 0 uses every logical core.
+// Returns NULL (after printing an error) when the system cannot be created.
+JobSystem* createJobSystem(int workerCount);
+
+// Waits for the worker threads to finish their current job, stops them and frees the system
+void destroyJobSystem(JobSystem* system);
+
+// Returns the number of threads that run jobs, the creating thread included
+int getJobWorkerCount(const JobSystem* system);
+
+// Returns the index of the calling thread among the workers, or -1 for a thread that is not one of them
+int getCurrentJobWorker(const JobSystem* system);
+
+// Sets a counter to no pending jobs
+void initJobCounter(JobCounter* counter);
+
+// Queues function(data) on the calling worker's deque and adds it to the counter (which may be NULL).
+// Threads that are not workers of the system run the job at once.
+void submitJob(JobSystem* system, JobFunction function, void* data, JobCounter* counter);
+
+// Runs queued jobs until every job of the counter has finished
+void waitForJobs(JobSystem* system, JobCounter* counter);
+
+// Calls body over [0, count) in ranges of 'grain' indices spread over the workers, and returns when
+// all of them are done. Idle workers steal the first ranges and the calling thread works from the last
+// one back, so the ranges of a list sorted by cost, largest first, start roughly in that order.
+// Without a system, or from a thread that is not a worker, body runs over the whole range at once.
+void parallelFor(JobSystem* system, int count, int grain, ParallelForFunction body, void* data);
+
+#endif // JOB_SYSTEM_H
@@ -0,0 +1,52 @@
+#ifndef LIGHT_BUFFER_H
+#define LIGHT_BUFFER_H
+
+#include "light_sources.h" // For SceneLights
+#include "simd.h"          // For SIMD_LANES
+
+// Structure-of-arrays copy of the scene's point lights.
+// Arrays are padded to a multiple of SIMD_LANES; padding lanes have zero intensity.
+typedef struct {
+    float* positionX;
+    float* positionY;
+    float* positionZ;
+    float* range;
+    float* intensity;
+    float* red;        // Light color channels normalized to 0..1
+    float* green;
+    float* blue;
+    int count;         // Number of real lights
+    int paddedCount;   // count rounded up to a multiple of SIMD_LANES
+} PointLightBuffer;
+
+// Structure-of-arrays copy of the scene's spotlights, with cutoff angles pre-converted to cosines
+typedef struct {
+    float* positionX;
+    float* positionY;
+    float* positionZ;
+    float* directionX;
+    float* directionY;
+    float* directionZ;
+    float* outerCutoffCosine;
+    float* innerCutoffCosine;
+    float* intensity;
+    float* red;
+    float* green;
+    float* blue;
+    int count;
+    int paddedCount;
+} SpotLightBuffer;
+
+// Light data laid out for batched shading, lane i of batch b maps to light b * SIMD_LANES + i of SceneLights
+typedef struct LightBuffer {
+    PointLightBuffer pointLights;
+    SpotLightBuffer spotLights;
+} LightBuffer;
+
+// Builds the SoA light buffer from the scene lights, returns NULL on allocation failure
+LightBuffer* buildLightBuffer(SceneLights* lights);
+
+// Frees a light buffer created by buildLightBuffer
+void freeLightBuffer(LightBuffer* buffer);
+
+#endif // LIGHT_BUFFER_H
@@ -0,0 +1,60 @@
+#ifndef LIGHT_BVH_H
+#define LIGHT_BVH_H
+
+#include "bvh.h"           // For AABB
+#include "light_sources.h" // For SceneLights
+#include "sampling.h"      // For randomFloat
+
+// Maximum number of lights stored in one leaf of the light BVH
+#define LIGHT_BVH_LEAF_SIZE 4
+
+// Kind of light referenced by a light BVH entry
+typedef enum {
+    LIGHT_TYPE_POINT = 0,
+    LIGHT_TYPE_SPOT = 1
+} LightType;
+
+// A light stored in the light BVH together with its influence volume
+typedef struct {
+    LightType type;        // Point light or spotlight
+    int index;             // Index into SceneLights.pointLights or SceneLights.spotLights
+    Vector position;       // Light position (sphere center or cone apex)
+    Vector direction;      // Spotlight direction (unused for point lights)
+    float radius;          // Point light range, or spotlight cone length bounded by the scene
+    float cutoffCosine;    // Cosine of the spotlight outer cutoff (unused for point lights)
+    float power;           // Light intensity, used to guide stochastic light selection
+    AABB bounds;           // Bounding box of the influence volume
+} LightReference;
+
+// Light BVH node: inner nodes have two children, leaves hold up to LIGHT_BVH_LEAF_SIZE lights
+typedef struct LightBVHNode {
+    AABB bounds;                // Union of the children's influence volumes
+    AABB positionBounds;        // Bounds of the light positions, used to estimate distance
+    float power;                // Sum of the light intensities below this node
+    struct LightBVHNode* left;  // Left child
+    struct LightBVHNode* right; // Right child
+    LightReference* lights;     // Lights in the leaf node
+    int lightCount;             // Number of lights in the leaf node
+} LightBVHNode;
+
+// Called once for every light whose influence volume contains the queried point
+typedef void (*LightVisitor)(LightType type, int index, void* userData);
+
+// Builds a light BVH over the point and spot lights.
+// Spotlights have no range, so their cones are cut off where they leave sceneBounds; with no bounds
+// (NULL, a scene without objects) they reach everywhere.
+// Returns NULL when there are no point or spot lights.
+LightBVHNode* buildLightBVH(SceneLights* lights, const AABB* sceneBounds);
+
+// Visits every light whose range sphere or cone contains the point
+void queryLightBVH(LightBVHNode* node, Vector point, LightVisitor visit, void* userData);
+
+// Picks one light with probability roughly proportional to its contribution at the point
+// (intensity x attenuation x cone factor), walking the tree as a light tree.
+// Returns 1 and fills type, index and probability, or 0 when the walk finds no light that reaches the point.
+int sampleLightBVH(LightBVHNode* root, SceneLights* lights, Vector point, Uint32* randomState, LightType* type, int* index, float* probability);
+
+// Free the light BVH tree
+void freeLightBVH(LightBVHNode* node);
+
+#endif // LIGHT_BVH_H
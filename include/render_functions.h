@@ -7,12 +7,196 @@
 #include "illumination.h"
 #include "scene.h"  
 #include "bvh.h" 
+#include "light_buffer.h"
+#include "light_bvh.h"
+#include "sampling.h"
+#include "framebuffer.h"
+#include "tile_order.h"
+#include "job_system.h"
+#include "arena.h"
+
+// Frames averaged by progressive rendering before the image is considered converged and tracing pauses
+#define PROGRESSIVE_MAX_FRAMES 256
+
+// Pixel spacing of the first preview pass after the view changes; each later pass halves it down to 1
+#define PREVIEW_START_SPACING 8
+
+// Every pixel is traced again at least once in this many reprojected frames, so view-dependent shading
+// does not stay stale while the camera keeps moving
+#define REPROJECTION_REFRESH_PERIOD 8
+
+// Distance of the stand-in hit point of rays that miss every object
+#define BACKGROUND_DISTANCE 1.0e4f
+
+// A reprojected sample this much (relative) deeper than the nearest sample around it is a surface behind
+// a gap in the foreground and is traced again
+#define DISOCCLUSION_DEPTH_TOLERANCE 0.1f
+
+// Largest number of mirror reflections a path may follow (RenderSettings.maxBounces is clamped to it)
+#define MAX_REFLECTION_BOUNCES 8
+
+// Paths whose remaining weight (product of the reflectivities so far) drops below this stop reflecting
+#define MIN_PATH_THROUGHPUT 0.02f
+
+// Reflections after which Russian roulette may end a path, with the throughput as survival probability
+#define RUSSIAN_ROULETTE_DEPTH 2
+
+// Distance a reflected ray starts off its surface so it does not hit it again
+#define REFLECTION_RAY_OFFSET 1e-3f
+
+// Rays main.c sorts together in the wavefront renderer (RenderSettings.raySortBatch)
+#define DEFAULT_RAY_SORT_BATCH 4096
+
+// Extra rays an edge pixel traces before it may stop early because they all agree with its center ray
+#define ADAPTIVE_EARLY_OUT_SAMPLES 3
+
+// How the first frame after a camera move is rendered
+typedef enum {
+    MOTION_FULL = 0,  // Trace every pixel of the new view
+    MOTION_PREVIEW,   // Coarse-to-fine preview passes
+    MOTION_REPROJECT, // Reuse the previous frame's shading where its surfaces stay visible, trace the rest
+    MOTION_MODE_COUNT
+} MotionMode;
+
+// Options that control how frames are rendered
+typedef struct {
+    int progressive;    // Accumulate jittered frames while the view is still (anti-aliasing during idle time)
+    int lightSamples;   // Point/spot lights sampled per shading point, 0 shades every light
+    TileOrder tileOrder; // Order in which the tiles of a frame are rendered
+    ResolveSettings resolve; // Tone mapping, sRGB encoding and dithering of the final image
+    int maxSamplesPerPixel;  // Rays a pixel may trace per frame, 1 disables adaptive supersampling
+    float adaptiveThreshold; // Largest channel difference between neighbours before both are supersampled
+    float previewBudgetMilliseconds; // Time a frame may spend on further, finer preview passes (0 = one pass per frame)
+    MotionMode motionMode;   // Rendering of the first frame after the camera moves
+    int maxBounces;          // Mirror reflections followed per path using Material.reflectivity, 0 disables them
+    int wavefront;           // Trace full passes stage by stage over ray queues (see wavefront.h) instead of pixel by pixel
+    int raySortBatch;        // Wavefront shadow and reflection rays sorted together by origin cell and direction, 0 keeps shading order
+    int shadowPackets;       // Trace the wavefront shadow rays of each light SIMD_LANES at a time through the BVH
+} RenderSettings;
+
+// Ray counts of the last rendered frame
+typedef struct {
+    Uint64 primaryRays;    // One ray through the center of every pixel
+    Uint64 extraRays;      // Sub-pixel rays spent by adaptive supersampling
+    Uint64 refinedPixels;  // Pixels that received extra rays
+    Uint64 reusedPixels;   // Pixels whose shading was reprojected from the previous frame
+    Uint64 reshadedPixels; // Pixels shaded again from the G-buffer after a light edit
+    int spacing;           // Pixel spacing of the first pass of the frame, 1 for a complete frame,
+                           // 0 for a frame built from the previous one (reprojected or reshaded)
+    Uint64 bounceHistogram[MAX_REFLECTION_BOUNCES + 1]; // Shaded paths by the number of reflection rays they traced
+    Uint64 shadowRays;     // Shadow rays traced
+    Uint64 shadowCacheHits; // Shadow rays answered by the occluder cache; consecutive coherent rays raise the share
+    Uint64 shadowPackets;  // Packets the shadow rays were traced in (shadowRays / shadowPackets rays per packet)
+    Uint64 scratchBytes;   // Most scratch memory a worker has held for one tile or frame (largest arena high-water mark)
+} RenderStats;
+
+typedef struct WavefrontQueues WavefrontQueues; // Ray queues of the wavefront renderer, see wavefront.h
+
+// Initial size of a tile worker's scratch arena; it grows to its high-water mark on its own
+#define RENDER_SCRATCH_BYTES (64 * 1024)
+
+// Scratch buffers and ray counts of one thread rendering tiles
+typedef struct {
+    Ray* tileRays;              // Primary rays of the tile being rendered
+    WavefrontQueues* wavefront; // Queues of the wavefront renderer, allocated when settings->wavefront is first used
+    Arena scratch;              // Temporary memory of the tile being rendered, reset before every tile
+    RenderStats stats;          // Rays this worker traced in the current frame, added to RenderState.stats at its end
+} TileWorker;
+
+// State the frame loop keeps from one frame to the next
+typedef struct {
+    int width;                        // Render resolution width in pixels
+    int height;                       // Render resolution height in pixels
+    int maxWidth;                     // Width the buffers were allocated for
+    int maxHeight;                    // Height the buffers were allocated for
+    TileSchedule schedule;            // Tiles in visiting order, rebuilt when the tile order changes and reordered by their cost in TILE_ORDER_COST
+    JobSystem* jobs;                  // Workers that render the tiles, NULL to render them on the calling thread
+    TileWorker* workers;              // One per job worker (one without a job system)
+    int workerCount;                  // Entries of 'workers'
+    FrameBuffer frameBuffer;          // Float colors written by shading, resolved to pixels at the end of the frame
+    GBuffer gBuffer;                  // Primitive and hit point seen by each pixel's center ray
+    FrameBuffer history;              // Colors of the previous frame, the source of reprojection
+    GBuffer historyGBuffer;           // Hits of the previous frame
+    float* splatDepth;                // Depth of the nearest reprojected sample in each pixel
+    int historyValid;                 // The G-buffer holds a hit for every pixel of the last frame
+    int viewChanged;                  // restartRendering() was called since the last frame
+    Uint32 geometryRevision;          // Scene geometryRevision the history was rendered with
+    Uint32 lightsRevision;            // Scene lightsRevision the history was shaded with
+    Uint8* refineMask;                // Pixels marked for supersampling in the current frame
+    int previewSpacing;               // Pixel spacing of the next pass, 1 once the preview is complete
+    int tracedSpacing;                // Spacing of the preview samples already in the frame buffer, 0 for none
+    AccumulationBuffer accumulation;  // Running average of the frames rendered since the view last changed
+    Uint32 frameIndex;                // Seeds the per-pixel random streams
+    Uint64 timedFrames;               // Frames rendered since the tile order last changed
+    double timedMilliseconds;         // Total render time of those frames
+    double lastFrameMilliseconds;     // Render time of the last traced frame
+    RenderStats stats;                // Ray counts of the last frame
+} RenderState;
 
 
 // Initializes the scene with default objects and lighting.
 void initialize_scene(int WINDOW_WIDTH, int WINDOW_HEIGHT, Camera* camera, Scene* scene);
 
-// Computes the color of a pixel by tracing a ray from the camera through the scene.
-SDL_Color computePixelColor(int WINDOW_WIDTH, int WINDOW_HEIGHT, int x, int y, Camera* camera, Scene* scene);
+// Computes the color seen along a primary ray; randomSeed starts the random stream used by stochastic
+// light sampling. When pixelHit is not NULL it receives the primary hit for the G-buffer; a miss has a NULL
+// object and a position BACKGROUND_DISTANCE along the ray.
+FloatColor computePixelColor(Ray viewRay, Scene* scene, RenderSettings* settings, Uint32 randomSeed, PixelHit* pixelHit);
+
+// Collects the BVH subtrees the primary rays of a tile can hit, nearest first, by walking the tree once against
+// the frustum of the tile's corner rays (see cullBVHFrustum). 'nodes' holds BVH_FRUSTUM_MAX_NODES entries.
+// Returns the number of subtrees, 0 when the tile sees no object.
+int cullTileBVH(const RayGenerator* rayGenerator, const Tile* tile, BVHNode* root, BVHNode** nodes);
+
+// Copies the calling thread's count of shaded paths by reflection depth
+void getBounceHistogram(Uint64 histogram[MAX_REFLECTION_BOUNCES + 1]);
+
+// Clears the calling thread's reflection depth counts
+void resetBounceHistogram(void);
+
+// Counts a finished path in the calling thread's reflection depth histogram
+void countPathBounces(int bounces);
+
+// Allocates the per-frame buffers for a width x height framebuffer, the largest render resolution
+void initRenderState(RenderState* state, int width, int height, RenderSettings* settings);
+
+// Renders the tiles of complete passes and resolves the image on the workers of a job system (NULL renders
+// on the calling thread). renderFrame() must then be called from the thread that created the job system.
+// Returns 0 (after printing an error) when the per-worker buffers cannot be allocated; the state then keeps rendering on one thread.
+int setRenderJobSystem(RenderState* state, JobSystem* jobs);
+
+// Changes the render resolution (clamped to the allocated size) without reallocating the buffers.
+// Frames are then traced into the top-left width x height pixels; accumulation restarts when the size changes.
+void setRenderResolution(RenderState* state, int width, int height);
+
+// Frees the buffers of the render state
+void freeRenderState(RenderState* state);
+
+// Starts over after the camera moved (scene edits are detected by renderFrame): drops the accumulated frames, and the next frame is
+// rendered as settings->motionMode says
+void restartRendering(RenderState* state);
+
+// Returns a readable name for a motion mode
+const char* getMotionModeName(MotionMode mode);
+
+// Renders one frame tile by tile in settings->tileOrder into the float frame buffer, then resolves it into
+// 'pixels' (pixelsPerRow Uint32 values per row) in the given pixel format.
+// Every pixel traces one center ray (with settings->wavefront and all lights shaded, complete passes run
+// through the wavefront stages); pixels whose neighbours see another primitive or differ in color by more
+// than settings->adaptiveThreshold trace up to settings->maxSamplesPerPixel rays in total.
+// The tiles of complete passes are spread over the job system's workers (see setRenderJobSystem) and timed;
+// in TILE_ORDER_COST the next frame starts the most expensive tiles first and splits the hot ones (see scheduleTilesByCost).
+// Edits to the scene are picked up through its revisions: after a light edit with an unchanged view the
+// frame is shaded again from the G-buffer without tracing primary rays; after an object edit the BVH is
+// brought up to date (see updateSceneBVH()) and every pixel is traced again.
+// In MOTION_REPROJECT mode the first frame after restartRendering() splats the previous frame's hits
+// into the new view; samples that land in a pixel and pass a disocclusion check keep their color, the
+// remaining pixels and a rotating 1 / REPROJECTION_REFRESH_PERIOD of all pixels are traced.
+// In MOTION_PREVIEW mode the frames after restartRendering() are previews: every PREVIEW_START_SPACING-th
+// pixel is traced and fills its block, then each pass halves the spacing and traces only the pixels not
+// traced yet. A frame runs further passes while the next one fits into settings->previewBudgetMilliseconds.
+// In progressive or stochastic mode the frame is averaged with the earlier ones since the last
+// restartRendering(); once PROGRESSIVE_MAX_FRAMES are in, 'pixels' is left as it is.
+// Returns 1 when a frame was traced, 0 when the accumulation had already converged.
+int renderFrame(RenderState* state, Camera* camera, Scene* scene, RenderSettings* settings, Uint32* pixels, int pixelsPerRow, const SDL_PixelFormatDetails* format);
 
 #endif // RENDER_FUNCTIONS_H
\ No newline at end of file
@@ -0,0 +1,18 @@
+#ifndef SAMPLING_H
+#define SAMPLING_H
+
+#include <SDL3/SDL.h>
+
+// Hashes an integer into a well-mixed 32-bit value (used to seed per-pixel random streams)
+Uint32 hashUint32(Uint32 value);
+
+// Builds a random seed from a pixel position and a frame index
+Uint32 pixelSeed(int x, int y, Uint32 frameIndex);
+
+// Returns a uniformly distributed float in [0, 1) and advances the random state
+float randomFloat(Uint32* state);
+
+// Returns the index-th point of the van der Corput sequence in the given base (one Halton dimension), in [0, 1)
+float radicalInverse(Uint32 index, Uint32 base);
+
+#endif // SAMPLING_H
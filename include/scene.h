@@ -9,11 +9,21 @@ typedef struct BVHNode BVHNode;
 
 struct BVHNode; // Forward declaration of BVHNode
 
+typedef struct LightBuffer LightBuffer; // SoA light data, see light_buffer.h
+typedef struct LightBVHNode LightBVHNode; // Spatial index over light ranges, see light_bvh.h
+
 // Structure representing a scene with various objects
 typedef struct {
     Objects objects;  // Objects contained in the scene (spheres, planes, triangles)
     SceneLights lights; // Lights contained in the scene (point lights, directional lights, spotlights, and ambient light)
-    BVHNode* bvhRoot; // Root node of the BVH tree
+    BVHNode* bvhRoot; // Root node of the BVH tree (bring up to date after changing objects)
+    LightBuffer* lightBuffer; // SoA copy of the lights for batched shading (rebuild after changing lights)
+    LightBVHNode* lightBvhRoot; // Root of the light BVH used to cull lights by range (rebuild after changing lights)
+    Uint32 geometryRevision; // Incremented by every change to the objects
+    Uint32 lightsRevision;   // Incremented by every change to the lights
+    Uint32 bvhRevision;      // geometryRevision the BVH was built or refit for
+    Uint32 lightStructuresRevision; // lightsRevision the light buffer and light BVH were built for
+    Uint32 lightStructuresGeometryRevision; // geometryRevision of the bounds the light BVH cut spotlight cones off at
 } Scene;
 
 // Function to initialize a scene with dynamic memory allocation for spheres, planes, and triangles
@@ -31,6 +41,12 @@ void addPlane(Scene* scene, Vector position, Vector normal, float width, float h
 // Function to add a triangle to the scene
 void addTriangle(Scene* scene, Vector v1, Vector v2, Vector v3, Material material);
 
+// Function to move an existing sphere (the BVH follows with refitBVH())
+void moveSphere(Scene* scene, int index, Vector position);
+
+// Function to move the vertices of an existing triangle (the BVH follows with refitBVH())
+void moveTriangle(Scene* scene, int index, Vector v1, Vector v2, Vector v3);
+
 // Function to add a point light
 void addPointLight(Scene* scene, LightMaterial material, Vector position, float range);
 
@@ -43,6 +59,34 @@ void addSpotLight(Scene* scene, LightMaterial material, Vector position, Vector
 // Function to set ambient light
 void setAmbientLight(Scene* scene, LightMaterial material);
 
+// Function to move an existing point light
+void movePointLight(Scene* scene, int index, Vector position);
+
+// Function to bring the BVH up to date if the objects changed since it was built: refit when objects only
+// moved, rebuilt when objects were added (or there is no BVH yet)
+void updateSceneBVH(Scene* scene);
+
+// Function to rebuild the light buffer and the light BVH if the lights (or the scene bounds) changed since they were built
+void updateSceneLightStructures(Scene* scene);
+
+// Counters of the per-thread shadow occluder cache
+typedef struct {
+    Uint64 hits;   // Shadow rays answered by the cached occluder
+    Uint64 misses; // Shadow rays that needed a full walk over the scene objects
+} ShadowCacheStats;
+
+// Function to build the shadow ray from a surface point along the normalized direction to a light,
+// starting just above the surface so the surface does not shadow itself
+Ray makeShadowRay(Vector point, Vector lightDirection);
+
+// Function to check whether any object blocks a shadow ray before maxDistance.
+// 'light' only identifies the light for the per-thread occluder cache.
+int traceShadowRay(Scene* scene, const void* light, Ray shadowRay, float maxDistance);
+
+// Function to trace up to SIMD_LANES shadow rays together; returns a mask with bit i set when ray i is blocked.
+// Uses traceShadowPacketBVH when the scene's BVH is up to date, otherwise traceShadowRay with lights[i].
+int traceShadowRays(Scene* scene, const void* const* lights, const Ray* shadowRays, const float* maxDistances, int count);
+
 // Function to check if a point is in shadow relative to a point light source
 int isPointInShadow(Vector point, PointLight* light, Scene* scene);
 
@@ -52,4 +96,10 @@ int isPointInShadowDir(Vector point, DirectionalLight* light, Scene* scene);
 // Function to check if a point is in shadow relative to a spotlight source
 int isPointInShadowSpot(Vector point, SpotLight* light, Scene* scene);
 
+// Returns the shadow occluder cache counters of the calling thread
+ShadowCacheStats getShadowCacheStats(void);
+
+// Clears the shadow occluder cache counters of the calling thread
+void resetShadowCacheStats(void);
+
 #endif // SCENE_H
\ No newline at end of file
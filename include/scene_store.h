@@ -0,0 +1,92 @@
+#ifndef SCENE_STORE_H
+#define SCENE_STORE_H
+
+#include <SDL3/SDL.h>
+#include "scene.h"
+
+// Kinds of queued scene edits; each one calls the matching scene function on the next version
+typedef enum {
+    SCENE_EDIT_ADD_SPHERE = 0,
+    SCENE_EDIT_ADD_PLANE,
+    SCENE_EDIT_ADD_TRIANGLE,
+    SCENE_EDIT_MOVE_SPHERE,
+    SCENE_EDIT_MOVE_TRIANGLE,
+    SCENE_EDIT_ADD_POINT_LIGHT,
+    SCENE_EDIT_ADD_DIRECTIONAL_LIGHT,
+    SCENE_EDIT_ADD_SPOT_LIGHT,
+    SCENE_EDIT_SET_AMBIENT_LIGHT,
+    SCENE_EDIT_MOVE_POINT_LIGHT
+} SceneEditType;
+
+// One change to a scene, with the arguments of the scene function that makes it
+typedef struct {
+    SceneEditType type;
+    union {
+        struct { Vector position; float radius; Material material; } sphere;
+        struct { Vector position; Vector normal; float width; float height; Material material; } plane;
+        struct { Vector v1; Vector v2; Vector v3; Material material; } triangle;
+        struct { LightMaterial material; Vector position; float range; } pointLight;
+        struct { LightMaterial material; Vector position; Vector direction; } directionalLight;
+        struct { LightMaterial material; Vector position; Vector direction; float cutOffAngle; float innerCutoffAngle; } spotLight;
+        LightMaterial ambientLight;
+        struct { int index; Vector position; } moveSphere;
+        struct { int index; Vector v1; Vector v2; Vector v3; } moveTriangle;
+        struct { int index; Vector position; } movePointLight;
+    };
+} SceneEdit;
+
+typedef struct SceneStore SceneStore;
+
+// An immutable version of the scene, with its BVH and light structures built. Readers hold a reference
+// while they trace it; the version is freed once the store and every reader have let go of it.
+typedef struct SceneVersion {
+    Scene scene;
+    Uint64 number;                 // 1 for the scene the store started with, one more for every commit
+    SDL_AtomicInt references;      // The store's (while current), readers', and later versions sharing the BVH
+    struct SceneVersion* bvhOwner; // Version whose BVH scene.bvhRoot is; itself unless only lights changed
+    SceneStore* store;
+} SceneVersion;
+
+// Publishes scene versions RCU style: edits from any thread are queued, commitSceneEdits() applies them to
+// a copy of the current version and swaps the copy in with one pointer store, and frames that started on
+// the old version finish on it undisturbed. Readers never wait for a commit: the lock they take only covers
+// loading the current pointer and adding their reference.
+struct SceneStore {
+    SceneVersion* current;         // Newest published version
+    SDL_SpinLock currentLock;      // Guards loading 'current' together with taking a reference to it
+    SDL_SpinLock editLock;         // Guards the edit queue
+    SceneEdit* edits;              // Edits queued since the last commit
+    int editCount;
+    int editCapacity;
+    SDL_Mutex* commitMutex;        // Serializes commits from different threads
+    SDL_AtomicInt liveVersions;    // Versions not freed yet, the current one included
+    BVHNode* spareBVH;             // BVH of the last freed version that owned one, refit by the next commit that only moves
+                                   // objects instead of copying the current BVH (swapped atomically, NULL when none)
+};
+
+// Takes over 'scene' (its arrays and BVH) as the first version, bringing its BVH up to date and building its light structures.
+// Returns 0 (after printing an error) when the store cannot be created; the scene is then left to the caller.
+int initSceneStore(SceneStore* store, Scene* scene);
+
+// Frees the current version, the spare BVH and the queued edits; every reader must have released its version
+void freeSceneStore(SceneStore* store);
+
+// Queues an edit for the next commit; safe from any thread. Returns 0 (after printing an error) when the queue cannot grow.
+int queueSceneEdit(SceneStore* store, const SceneEdit* edit);
+
+// Applies the queued edits, in queue order, to a copy of the current version: the BVH is rebuilt when
+// objects were added, refit when objects only moved (rebuilding the subtrees the moves degraded) and shared
+// with the current version otherwise, and the light structures are rebuilt. A move refits the spare BVH a
+// freed version left behind, so a store alternates between two trees while old frames finish in time; only
+// when no spare is free yet is the current BVH deep-copied, which costs an allocation per node.
+// The copy then becomes the current version. Takes as long as the rebuilds, but readers keep tracing the
+// old version meanwhile. Returns 1 when a new version was published, 0 when nothing was queued or it failed.
+int commitSceneEdits(SceneStore* store);
+
+// Returns the current version with a reference for the caller, who traces it until releaseSceneVersion()
+SceneVersion* acquireSceneVersion(SceneStore* store);
+
+// Drops a reference; the last one frees the version
+void releaseSceneVersion(SceneVersion* version);
+
+#endif // SCENE_STORE_H
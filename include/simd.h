@@ -0,0 +1,171 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <SDL3/SDL.h>
+#include "ray.h" // For Vector
+
+#ifdef SDL_SSE2_INTRINSICS
+#include <emmintrin.h>
+#endif
+
+// Number of floats processed together by one lane operation
+#define SIMD_LANES 4
+
+// A group of SIMD_LANES floats processed with one instruction where the CPU supports it
+#ifdef SDL_SSE2_INTRINSICS
+typedef __m128 FloatLanes;
+#else
+typedef struct {
+    float v[SIMD_LANES];
+} FloatLanes;
+#endif
+
+// Structure-of-arrays vector: SIMD_LANES vectors stored component by component
+typedef struct {
+    FloatLanes x, y, z;
+} VectorLanes;
+
+#ifdef SDL_SSE2_INTRINSICS
+
+static inline FloatLanes splatLanes(float value) { return _mm_set1_ps(value); }
+static inline FloatLanes loadLanes(const float* values) { return _mm_loadu_ps(values); }
+static inline void storeLanes(float* values, FloatLanes lanes) { _mm_storeu_ps(values, lanes); }
+static inline FloatLanes addLanes(FloatLanes a, FloatLanes b) { return _mm_add_ps(a, b); }
+static inline FloatLanes subtractLanes(FloatLanes a, FloatLanes b) { return _mm_sub_ps(a, b); }
+static inline FloatLanes multiplyLanes(FloatLanes a, FloatLanes b) { return _mm_mul_ps(a, b); }
+static inline FloatLanes divideLanes(FloatLanes a, FloatLanes b) { return _mm_div_ps(a, b); }
+static inline FloatLanes sqrtLanes(FloatLanes a) { return _mm_sqrt_ps(a); }
+static inline FloatLanes minLanes(FloatLanes a, FloatLanes b) { return _mm_min_ps(a, b); }
+static inline FloatLanes maxLanes(FloatLanes a, FloatLanes b) { return _mm_max_ps(a, b); }
+
+// Comparisons return a mask with all bits set in the lanes where the comparison holds
+static inline FloatLanes greaterThanLanes(FloatLanes a, FloatLanes b) { return _mm_cmpgt_ps(a, b); }
+static inline FloatLanes lessThanLanes(FloatLanes a, FloatLanes b) { return _mm_cmplt_ps(a, b); }
+static inline FloatLanes andLanes(FloatLanes a, FloatLanes b) { return _mm_and_ps(a, b); }
+static inline FloatLanes orLanes(FloatLanes a, FloatLanes b) { return _mm_or_ps(a, b); }
+
+// Picks lanes from 'a' where the mask is set and from 'b' elsewhere
+static inline FloatLanes selectLanes(FloatLanes mask, FloatLanes a, FloatLanes b)
+{
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+// Packs the mask into an integer with one bit per lane
+static inline int maskBits(FloatLanes mask) { return _mm_movemask_ps(mask); }
+
+// Builds a lane mask from the low SIMD_LANES bits of an integer
+static inline FloatLanes bitsToMask(int bits)
+{
+    __m128i laneBits = _mm_set_epi32(8, 4, 2, 1);
+    __m128i selected = _mm_and_si128(_mm_set1_epi32(bits), laneBits);
+    return _mm_castsi128_ps(_mm_cmpeq_epi32(selected, laneBits));
+}
+
+// Truncates the color lanes to integers, shifts each channel into place and stores SIMD_LANES packed pixels
+static inline void packPixelLanes(Uint32* pixels, FloatLanes red, FloatLanes green, FloatLanes blue, Uint32 alphaBits, int redShift, int greenShift, int blueShift)
+{
+    __m128i packed = _mm_set1_epi32((int)alphaBits);
+    packed = _mm_or_si128(packed, _mm_sll_epi32(_mm_cvttps_epi32(red), _mm_cvtsi32_si128(redShift)));
+    packed = _mm_or_si128(packed, _mm_sll_epi32(_mm_cvttps_epi32(green), _mm_cvtsi32_si128(greenShift)));
+    packed = _mm_or_si128(packed, _mm_sll_epi32(_mm_cvttps_epi32(blue), _mm_cvtsi32_si128(blueShift)));
+    _mm_storeu_si128((__m128i*)pixels, packed);
+}
+
+#else
+
+static inline FloatLanes splatLanes(float value)
+{
+    FloatLanes r;
+    for (int i = 0; i < SIMD_LANES; i++) r.v[i] = value;
+    return r;
+}
+
+static inline FloatLanes loadLanes(const float* values)
+{
+    FloatLanes r;
+    for (int i = 0; i < SIMD_LANES; i++) r.v[i] = values[i];
+    return r;
+}
+
+static inline void storeLanes(float* values, FloatLanes lanes)
+{
+    for (int i = 0; i < SIMD_LANES; i++) values[i] = lanes.v[i];
+}
+
+#define SIMD_SCALAR_BINARY(name, expression) \
+    static inline FloatLanes name(FloatLanes a, FloatLanes b) \
+    { \
+        FloatLanes r; \
+        for (int i = 0; i < SIMD_LANES; i++) r.v[i] = (expression); \
+        return r; \
+    }
+
+// In the scalar fallback a set mask lane holds 1.0f and a cleared lane holds 0.0f
+SIMD_SCALAR_BINARY(addLanes, a.v[i] + b.v[i])
+SIMD_SCALAR_BINARY(subtractLanes, a.v[i] - b.v[i])
+SIMD_SCALAR_BINARY(multiplyLanes, a.v[i] * b.v[i])
+SIMD_SCALAR_BINARY(divideLanes, a.v[i] / b.v[i])
+SIMD_SCALAR_BINARY(minLanes, SDL_min(a.v[i], b.v[i]))
+SIMD_SCALAR_BINARY(maxLanes, SDL_max(a.v[i], b.v[i]))
+SIMD_SCALAR_BINARY(greaterThanLanes, a.v[i] > b.v[i] ? 1.0f : 0.0f)
+SIMD_SCALAR_BINARY(lessThanLanes, a.v[i] < b.v[i] ? 1.0f : 0.0f)
+SIMD_SCALAR_BINARY(andLanes, (a.v[i] != 0.0f && b.v[i] != 0.0f) ? 1.0f : 0.0f)
+SIMD_SCALAR_BINARY(orLanes, (a.v[i] != 0.0f || b.v[i] != 0.0f) ? 1.0f : 0.0f)
+
+#undef SIMD_SCALAR_BINARY
+
+static inline FloatLanes sqrtLanes(FloatLanes a)
+{
+    for (int i = 0; i < SIMD_LANES; i++) a.v[i] = SDL_sqrtf(a.v[i]);
+    return a;
+}
+
+static inline FloatLanes selectLanes(FloatLanes mask, FloatLanes a, FloatLanes b)
+{
+    for (int i = 0; i < SIMD_LANES; i++) a.v[i] = mask.v[i] != 0.0f ? a.v[i] : b.v[i];
+    return a;
+}
+
+static inline int maskBits(FloatLanes mask)
+{
+    int bits = 0;
+    for (int i = 0; i < SIMD_LANES; i++) bits |= (mask.v[i] != 0.0f) << i;
+    return bits;
+}
+
+static inline FloatLanes bitsToMask(int bits)
+{
+    FloatLanes r;
+    for (int i = 0; i < SIMD_LANES; i++) r.v[i] = (bits >> i) & 1 ? 1.0f : 0.0f;
+    return r;
+}
+
+static inline void packPixelLanes(Uint32* pixels, FloatLanes red, FloatLanes green, FloatLanes blue, Uint32 alphaBits, int redShift, int greenShift, int blueShift)
+{
+    for (int i = 0; i < SIMD_LANES; i++)
+    {
+        pixels[i] = alphaBits | ((Uint32)red.v[i] << redShift) | ((Uint32)green.v[i] << greenShift) | ((Uint32)blue.v[i] << blueShift);
+    }
+}
+
+#endif
+
+// Clamps every lane between low and high
+static inline FloatLanes clampLanes(FloatLanes a, float low, float high)
+{
+    return minLanes(maxLanes(a, splatLanes(low)), splatLanes(high));
+}
+
+// Dot product of SIMD_LANES vector pairs
+static inline FloatLanes dotProductLanes(VectorLanes u, VectorLanes v)
+{
+    return addLanes(addLanes(multiplyLanes(u.x, v.x), multiplyLanes(u.y, v.y)), multiplyLanes(u.z, v.z));
+}
+
+// Broadcasts one vector into every lane
+static inline VectorLanes splatVectorLanes(Vector v)
+{
+    return (VectorLanes){splatLanes(v.x), splatLanes(v.y), splatLanes(v.z)};
+}
+
+#endif // SIMD_H
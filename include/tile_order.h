@@ -0,0 +1,69 @@
+#ifndef TILE_ORDER_H
+#define TILE_ORDER_H
+
+#include <SDL3/SDL.h>
+
+#include "arena.h"
+
+// Default edge length of a square render tile in pixels
+#define DEFAULT_TILE_SIZE 16
+
+// In TILE_ORDER_COST, a tile that cost this many times the average tile is split into quadrants
+#define TILE_SPLIT_COST_FACTOR 4
+
+// Order in which the tiles of a frame are visited
+typedef enum {
+    TILE_ORDER_SCANLINE = 0, // Row by row, left to right
+    TILE_ORDER_MORTON,       // Z-order curve
+    TILE_ORDER_HILBERT,      // Hilbert curve (every step moves to a neighbouring tile)
+    TILE_ORDER_COST,         // Most expensive tiles of the last frame first, hot tiles split (Hilbert order until costs are known)
+    TILE_ORDER_COUNT
+} TileOrder;
+
+// Rectangle of pixels rendered together; pixels inside a tile are visited row by row
+typedef struct {
+    int x, y;          // Top-left pixel
+    int width, height; // Size in pixels (smaller than the tile size on the right and bottom edges)
+} Tile;
+
+// The tiles of a frame, sorted in visiting order
+typedef struct {
+    Tile* tiles;     // Tiles in the order they are rendered
+    int count;       // Number of tiles
+    int tileSize;    // Edge length of a full tile in pixels
+    TileOrder order; // Order the tiles were sorted in
+    int width;       // Image width in pixels
+    int height;      // Image height in pixels
+    int tilesX;      // Columns of the full-size tile grid
+    int tilesY;      // Rows of the full-size tile grid
+    Uint64* tileCost; // Time each tile took since the last scheduleTilesByCost(), in performance counter ticks
+    Uint64* cellCost; // Scratch for the cost of each grid cell
+} TileSchedule;
+
+// Interleaves the bits of x and y into a Morton (Z-order) index
+Uint32 mortonIndex(Uint32 x, Uint32 y);
+
+// Returns the distance of cell (x, y) along the Hilbert curve filling a gridSize x gridSize grid (gridSize a power of two)
+Uint32 hilbertIndex(Uint32 gridSize, Uint32 x, Uint32 y);
+
+// Splits a width x height image into tiles and sorts them in the given order
+void buildTileSchedule(TileSchedule* schedule, int width, int height, int tileSize, TileOrder order);
+
+// Stores the time the tile at position tileIndex took. Each tile has its own slot, so threads rendering
+// different tiles can record their costs at the same time.
+void recordTileCost(TileSchedule* schedule, int tileIndex, Uint64 ticks);
+
+// Reorders a TILE_ORDER_COST schedule from the recorded costs, summed per grid cell: cells that cost more than
+// TILE_SPLIT_COST_FACTOR times the average are split into quadrants (half the tile size, so split tiles
+// still start on multiples of tileSize / 2), then the tiles are sorted by cost, largest first, so the
+// longest work starts early and the cheap tiles fill the end of the frame. Clears the costs.
+// The sort runs in memory taken from 'scratch'. Does nothing for the other orders or when no cost was recorded.
+void scheduleTilesByCost(TileSchedule* schedule, Arena* scratch);
+
+// Frees the tiles of a schedule
+void freeTileSchedule(TileSchedule* schedule);
+
+// Returns a printable name for a tile order
+const char* getTileOrderName(TileOrder order);
+
+#endif // TILE_ORDER_H
@@ -0,0 +1,97 @@
+#ifndef WAVEFRONT_H
+#define WAVEFRONT_H
+
+#include "render_functions.h" // For RenderState, RenderSettings and the reflection limits
+
+// Rays of one wavefront stage, stored component by component so each stage streams through flat arrays
+typedef struct {
+    float* originX;
+    float* originY;
+    float* originZ;
+    float* directionX;
+    float* directionY;
+    float* directionZ;
+    float* weight;        // Product of the reflectivities before this ray, scales the light it finds
+    Uint32* randomState;  // Random stream of the path (Russian roulette)
+    int* pixel;           // Frame buffer index the path adds its light to
+    int count;            // Rays in the queue
+    int capacity;         // Rays the arrays can hold
+} RayQueue;
+
+// Closest hits of the rays of a RayQueue; entry i belongs to ray i
+typedef struct {
+    const void** object;  // Primitive that was hit, NULL for a miss
+    float* pointX;
+    float* pointY;
+    float* pointZ;
+    float* normalX;
+    float* normalY;
+    float* normalZ;
+    Material* material;
+    float* diffuse;       // Light that reached the hit, 3 floats per hit, summed by the occlusion stage
+    float* specular;      // Specular light that reached the hit, 3 floats per hit
+} HitQueue;
+
+// Shadow rays of the shaded hits, each carrying the light that arrives if nothing blocks it
+typedef struct {
+    float* originX;
+    float* originY;
+    float* originZ;
+    float* directionX;
+    float* directionY;
+    float* directionZ;
+    float* maxDistance;   // Distance to the light
+    const void** light;   // Light the ray points at (key of the shadow occluder cache)
+    int* hit;             // Hit the light belongs to
+    int* lightIndex;      // LightContribution.lightIndex of the light, groups the rays into packets
+    int* order;           // Rays in the order they are traced in as packets
+    float* diffuse;       // Unshadowed diffuse light, 3 floats per ray
+    float* specular;      // Unshadowed specular light, 3 floats per ray
+    int count;            // Rays in the queue
+    int capacity;         // Rays the arrays can hold
+} ShadowQueue;
+
+// Sort key of a queued ray: direction octant in the top bits, then the Morton index of its origin cell
+typedef struct {
+    Uint32 key;  // Rays with close keys start close together and point the same way
+    int index;   // Position of the ray in its queue
+} RaySortEntry;
+
+// Work queues of the wavefront renderer, reused from tile to tile
+struct WavefrontQueues {
+    RayQueue rays;         // Rays of the current bounce
+    RayQueue nextRays;     // Reflection rays spawned for the next bounce
+    HitQueue hits;         // Hits of 'rays'
+    ShadowQueue shadows;   // Shadow rays of the hits that are being shaded
+    LightContribution* lights; // Lights of the hit being shaded, before they move to the shadow queue
+    int lightCapacity;     // Entries 'lights' can hold
+    int* lightStart;       // Per light, where its rays start (then end) in shadows.order; lightCapacity + 1 entries
+    RaySortEntry* sortEntries; // Keys of the rays being binned, in 'scratch'
+    Arena* scratch;        // Arena of the worker rendering the tile, reset before its next tile
+};
+
+// Computes the sort key of a ray that starts inside 'bounds' (origins outside are clamped to its faces)
+Uint32 rayBinKey(Vector origin, Vector direction, const AABB* bounds);
+
+// Allocates queues for pathCapacity paths. Returns 0 (after printing an error) when allocation fails.
+int initWavefrontQueues(WavefrontQueues* queues, int pathCapacity);
+
+// Frees the queues
+void freeWavefrontQueues(WavefrontQueues* queues);
+
+// Renders the center ray of every pixel of a tile stage by stage instead of pixel by pixel, in the worker's
+// queues (which must be allocated) and counting the rays in the worker's stats: generate the primary rays
+// (which only traverse the BVH subtrees cullTileBVH() finds), then per bounce extend them to their closest
+// hits, queue the shadow rays of every light that would reach each hit, trace the shadow rays, accumulate
+// the light that arrived into the frame buffer, and spawn the reflection rays of the next bounce.
+// The primary hits go to the G-buffer.
+// Paths end like in the depth-first renderer (settings->maxBounces, MIN_PATH_THROUGHPUT, Russian roulette),
+// and the image matches it up to the light it prunes; every light is shaded, so settings->lightSamples is ignored.
+// With settings->raySortBatch > 0, shadow rays and reflection rays are sorted by rayBinKey in batches of that
+// many rays before they are traced, so consecutive rays start close together and point the same way
+// (queues hold one tile, so larger batches sort the whole queue).
+// With settings->shadowPackets, the shadow rays of each light are traced SIMD_LANES at a time by
+// traceShadowPacketBVH instead of one by one against the object lists.
+void renderTileWavefront(TileWorker* worker, RenderState* state, const Tile* tile, const RayGenerator* rayGenerator, Scene* scene, RenderSettings* settings);
+
+#endif // WAVEFRONT_H
@@ -0,0 +1,142 @@
+#include "arena.h"
+
+#include <stdio.h>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+// Header of an overflow block; the allocation follows it at the next ARENA_ALIGNMENT boundary
+struct ArenaBlock {
+    ArenaBlock* next;
+};
+
+// Helper function that rounds a size up to a multiple of 'alignment' (a power of two)
+static size_t alignSize(size_t size, size_t alignment)
+{
+    return (size + alignment - 1) & ~(alignment - 1);
+}
+
+// Helper function that allocates the main memory of an arena, mapping huge pages when asked for them.
+// Returns NULL when nothing could be allocated.
+static unsigned char* allocateArenaMemory(Arena* arena, size_t capacity)
+{
+    arena->mapped = 0;
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    if ((arena->flags & ARENA_HUGE_PAGES) && capacity > 0)
+    {
+        // Map one huge page more than needed and trim the ends, so the arena starts on a huge page boundary
+        size_t mappedSize = alignSize(capacity, ARENA_HUGE_PAGE_SIZE);
+        unsigned char* mapping = mmap(NULL, mappedSize + ARENA_HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mapping != MAP_FAILED)
+        {
+            unsigned char* base = (unsigned char*)alignSize((size_t)mapping, ARENA_HUGE_PAGE_SIZE);
+            if (base > mapping) munmap(mapping, (size_t)(base - mapping));
+            munmap(base + mappedSize, (size_t)(mapping + ARENA_HUGE_PAGE_SIZE - base));
+            madvise(base, mappedSize, MADV_HUGEPAGE);
+            arena->mapped = 1;
+            arena->capacity = mappedSize;
+            arena->heapAllocations++;
+            return base;
+        }
+    }
+#endif
+
+    capacity = alignSize(capacity > 0 ? capacity : ARENA_ALIGNMENT, ARENA_ALIGNMENT);
+    unsigned char* base = SDL_aligned_alloc(ARENA_ALIGNMENT, capacity);
+    arena->capacity = base != NULL ? capacity : 0;
+    arena->heapAllocations++;
+    return base;
+}
+
+// Helper function that frees the main memory of an arena
+static void freeArenaMemory(Arena* arena)
+{
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    if (arena->mapped)
+    {
+        munmap(arena->base, arena->capacity);
+        arena->base = NULL;
+        arena->capacity = 0;
+        return;
+    }
+#endif
+    SDL_aligned_free(arena->base);
+    arena->base = NULL;
+    arena->capacity = 0;
+}
+
+// Helper function that frees the overflow blocks of an arena
+static void freeArenaOverflow(Arena* arena)
+{
+    while (arena->overflow != NULL)
+    {
+        ArenaBlock* next = arena->overflow->next;
+        SDL_aligned_free(arena->overflow);
+        arena->overflow = next;
+    }
+}
+
+int initArena(Arena* arena, size_t capacity, int flags)
+{
+    *arena = (Arena){0};
+    arena->flags = flags;
+    arena->base = allocateArenaMemory(arena, capacity);
+    if (arena->base == NULL)
+    {
+        printf("Error in creating arena: Memory allocation failed!\n");
+        return 0;
+    }
+    return 1;
+}
+
+void freeArena(Arena* arena)
+{
+    freeArenaOverflow(arena);
+    freeArenaMemory(arena);
+    arena->used = 0;
+}
+
+void* arenaAlloc(Arena* arena, size_t size)
+{
+    size = alignSize(size > 0 ? size : 1, ARENA_ALIGNMENT);
+
+    // Bump inside the arena's memory until the first request that does not fit; from then on 'used'
+    // counts overflow blocks too, so everything goes to the heap until the next reset
+    if (arena->overflow == NULL && arena->used + size <= arena->capacity)
+    {
+        void* memory = arena->base + arena->used;
+        arena->used += size;
+        return memory;
+    }
+
+    // Out of memory: take a block of its own from the heap until the next reset merges it in
+    ArenaBlock* block = SDL_aligned_alloc(ARENA_ALIGNMENT, ARENA_ALIGNMENT + size);
+    if (block == NULL)
+    {
+        printf("Error in allocating from arena: Memory allocation failed!\n");
+        return NULL;
+    }
+    block->next = arena->overflow;
+    arena->overflow = block;
+    arena->used += size;
+    arena->heapAllocations++;
+    return (unsigned char*)block + ARENA_ALIGNMENT;
+}
+
+void resetArena(Arena* arena)
+{
+    arena->highWater = SDL_max(arena->highWater, arena->used);
+    if (arena->overflow != NULL)
+    {
+        // Replace the memory by one piece that holds everything the arena needed
+        freeArenaOverflow(arena);
+        freeArenaMemory(arena);
+        arena->base = allocateArenaMemory(arena, arena->highWater);
+        if (arena->base == NULL)
+        {
+            printf("Error in growing arena: Memory allocation failed!\n");
+        }
+    }
+    arena->used = 0;
+}
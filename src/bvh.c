@@ -1,4 +1,6 @@
 #include "bvh.h"
+#include "simd.h"
+#include <stdio.h>
 #include <stdlib.h>
 
 AABB computeSphereAABB(Sphere* sphere) 
@@ -133,6 +135,42 @@ AABB computeObjectsAABB(Objects* objects)
     return box;
 }
 
+// Helper function that frees the object arrays of an Objects list
+static void freeObjects(Objects* objects)
+{
+    free(objects->planes);
+    free(objects->spheres);
+    free(objects->triangles);
+    objects->planes = NULL;
+    objects->spheres = NULL;
+    objects->triangles = NULL;
+}
+
+// Helper function that copies the used part of each object array into new allocations
+static Objects copyObjects(Objects* objects)
+{
+    Objects copy = *objects;
+    copy.maxPlanes = objects->planeCount;
+    copy.maxSpheres = objects->sphereCount;
+    copy.maxTriangles = objects->triangleCount;
+    copy.planes = objects->planeCount ? malloc(sizeof(Plane) * objects->planeCount) : NULL;
+    copy.spheres = objects->sphereCount ? malloc(sizeof(Sphere) * objects->sphereCount) : NULL;
+    copy.triangles = objects->triangleCount ? malloc(sizeof(Triangle) * objects->triangleCount) : NULL;
+
+    if ((objects->planeCount && !copy.planes) || (objects->sphereCount && !copy.spheres) || (objects->triangleCount && !copy.triangles))
+    {
+        printf("Error in creating BVH leaf: Memory allocation failed!\n");
+        freeObjects(&copy);
+        copy.planeCount = copy.sphereCount = copy.triangleCount = 0;
+        return copy;
+    }
+
+    if (copy.planes) SDL_memcpy(copy.planes, objects->planes, sizeof(Plane) * objects->planeCount);
+    if (copy.spheres) SDL_memcpy(copy.spheres, objects->spheres, sizeof(Sphere) * objects->sphereCount);
+    if (copy.triangles) SDL_memcpy(copy.triangles, objects->triangles, sizeof(Triangle) * objects->triangleCount);
+    return copy;
+}
+
 // Comparison functions for sorting objects along different axes
 int compareX(const void *a, const void *b)
 {
@@ -164,12 +202,89 @@ int compareZ(const void *a, const void *b)
     return 0;
 }
 
-// Function to recursively build the BVH tree
-BVHNode *buildBVH(Objects *objects)
+// Helper function that returns the surface area of a box, kept above zero so costs can be divided by it
+static float surfaceAreaAABB(AABB box)
 {
-    // Allocate memory for the BVH node
-    BVHNode *node = malloc(sizeof(BVHNode));
+    Vector size = subtractVectors(box.max, box.min);
+    return SDL_max(2.0f * (size.x * size.y + size.y * size.z + size.z * size.x), 1e-6f);
+}
+
+// Helper function that returns the smallest box around two boxes
+static AABB unionAABB(AABB a, AABB b)
+{
+    AABB box;
+    box.min.x = SDL_min(a.min.x, b.min.x);
+    box.min.y = SDL_min(a.min.y, b.min.y);
+    box.min.z = SDL_min(a.min.z, b.min.z);
+
+    box.max.x = SDL_max(a.max.x, b.max.x);
+    box.max.y = SDL_max(a.max.y, b.max.y);
+    box.max.z = SDL_max(a.max.z, b.max.z);
+    return box;
+}
+
+// Helper function that computes a node's SAH cost from its children's, which must be up to date: a ray
+// that enters the node's box enters a child's box with the ratio of their surface areas as probability
+static float computeNodeCost(const BVHNode* node)
+{
+    if (node->left == NULL && node->right == NULL)
+    {
+        return (float)(node->objects.planeCount + node->objects.sphereCount + node->objects.triangleCount);
+    }
+
+    float area = surfaceAreaAABB(node->bounds);
+    float cost = BVH_TRAVERSAL_COST;
+    if (node->left != NULL) cost += node->left->cost * surfaceAreaAABB(node->left->bounds) / area;
+    if (node->right != NULL) cost += node->right->cost * surfaceAreaAABB(node->right->bounds) / area;
+    return cost;
+}
+
+// Helper function that copies objectsArray[first, last) into a partition with exact-size arrays, writing
+// their sources in the planes, spheres, then triangles order of the partition. Returns 0 when memory runs out.
+static int fillPartition(const struct ObjectArray* objectsArray, int first, int last, Objects* part, int* partSources)
+{
+    *part = (Objects){0};
+    int i;
+    for(i = first; i < last; i++)
+    {
+        if(objectsArray[i].type == 0) part->maxPlanes++;
+        else if(objectsArray[i].type == 1) part->maxSpheres++;
+        else part->maxTriangles++;
+    }
+    part->planes = part->maxPlanes ? malloc(sizeof(Plane) * part->maxPlanes) : NULL;
+    part->spheres = part->maxSpheres ? malloc(sizeof(Sphere) * part->maxSpheres) : NULL;
+    part->triangles = part->maxTriangles ? malloc(sizeof(Triangle) * part->maxTriangles) : NULL;
+    if ((part->maxPlanes && !part->planes) || (part->maxSpheres && !part->spheres) || (part->maxTriangles && !part->triangles))
+    {
+        freeObjects(part);
+        return 0;
+    }
+
+    for(i = first; i < last; i++)
+    {
+        if(objectsArray[i].type == 0)
+        {
+            partSources[part->planeCount] = objectsArray[i].source;
+            part->planes[part->planeCount++] = *(Plane *)objectsArray[i].object;
+        }
+        else if(objectsArray[i].type == 1)
+        {
+            partSources[part->maxPlanes + part->sphereCount] = objectsArray[i].source;
+            part->spheres[part->sphereCount++] = *(Sphere *)objectsArray[i].object;
+        }
+        else
+        {
+            partSources[part->maxPlanes + part->maxSpheres + part->triangleCount] = objectsArray[i].source;
+            part->triangles[part->triangleCount++] = *(Triangle *)objectsArray[i].object;
+        }
+    }
+    return 1;
+}
 
+// Helper function that recursively builds the BVH over 'objects'; sources[i] is where the i-th of them
+// (planes, spheres, then triangles) sits in the arrays the whole BVH is built from
+static BVHNode *buildBVHNode(Objects *objects, const int *sources)
+{
     // Count total number of objects
     int numberOfObjects = objects->planeCount + objects->sphereCount + objects->triangleCount;
     if (numberOfObjects == 0)
@@ -177,16 +292,31 @@ BVHNode *buildBVH(Objects *objects)
         return NULL; // If no objects, return NULL
     }
 
+    // Allocate memory for the BVH node
+    BVHNode *node = malloc(sizeof(BVHNode));
+    if (!node)
+    {
+        printf("Error in creating BVH node: Memory allocation failed!\n");
+        return NULL;
+    }
+
     // Base case: If the number of objects is small, store them in a leaf node
-    if(numberOfObjects <= 2)
+    if(numberOfObjects <= BVH_LEAF_SIZE)
     {
-        node->objects = *objects;
+        // The leaf keeps its own copy, so the caller's arrays can be freed independently
+        node->objects = copyObjects(objects);
         node->left = NULL;
         node->right = NULL;
         node->bounds = computeObjectsAABB(objects); // Compute bounding box
+        SDL_memcpy(node->sources, sources, sizeof(int) * numberOfObjects);
+        node->cost = computeNodeCost(node);
+        node->builtCost = node->cost;
         return node;
     }
 
+    // Inner nodes hold no objects themselves
+    node->objects = (Objects){0};
+
     // Compute the bounding box of all objects
     AABB box = computeObjectsAABB(objects);
     node->bounds = box;
@@ -206,8 +336,17 @@ BVHNode *buildBVH(Objects *objects)
         axis = 2;
     }
 
-    // Create an array to store objects with their centers for sorting
+    // Create an array to store objects with their centers for sorting, and room for the partitions' sources
     struct ObjectArray *objectsArray = malloc(sizeof(struct ObjectArray) * numberOfObjects);
+    int *partSources = malloc(sizeof(int) * numberOfObjects);
+    if (!objectsArray || !partSources)
+    {
+        printf("Error in creating BVH node: Memory allocation failed!\n");
+        free(objectsArray);
+        free(partSources);
+        free(node);
+        return NULL;
+    }
     int i;
 
     // Store planes in the array
@@ -217,6 +356,7 @@ BVHNode *buildBVH(Objects *objects)
         objectsArray[i].center = plane->position;
         objectsArray[i].object = plane;
         objectsArray[i].type = 0;
+        objectsArray[i].source = sources[i];
     }
 
     // Store spheres in the array
@@ -226,6 +366,7 @@ BVHNode *buildBVH(Objects *objects)
         objectsArray[i + objects->planeCount].center = sphere->position;
         objectsArray[i + objects->planeCount].object = sphere;
         objectsArray[i + objects->planeCount].type = 1;
+        objectsArray[i + objects->planeCount].source = sources[i + objects->planeCount];
     }
 
     // Store triangles in the array
@@ -236,6 +377,7 @@ BVHNode *buildBVH(Objects *objects)
             multiplyVector(addVectors(triangle->v1, addVectors(triangle->v2, triangle->v3)), (1.0f / 3.0f));
         objectsArray[i + objects->planeCount + objects->sphereCount].object = triangle;
         objectsArray[i + objects->planeCount + objects->sphereCount].type = 2;
+        objectsArray[i + objects->planeCount + objects->sphereCount].source = sources[i + objects->planeCount + objects->sphereCount];
     }
 
     // Sort objects based on the selected axis
@@ -255,78 +397,229 @@ BVHNode *buildBVH(Objects *objects)
     // Determine the median index for splitting
     int medianIndex = numberOfObjects / 2;
 
-    // Allocate and initialize the left objects list
+    // Split into left and right partitions sized to what they hold
     Objects leftObjects;
-    leftObjects.maxPlanes = objects->maxPlanes;
-    leftObjects.maxSpheres = objects->maxSpheres;
-    leftObjects.maxTriangles = objects->maxTriangles;
-    leftObjects.planes = malloc(sizeof(Plane) * objects->maxPlanes);
-    leftObjects.spheres = malloc(sizeof(Sphere) * objects->maxSpheres);
-    leftObjects.triangles = malloc(sizeof(Triangle) * objects->maxTriangles);
-    leftObjects.planeCount = 0;
-    leftObjects.sphereCount = 0;
-    leftObjects.triangleCount = 0;
-
-    // Assign objects to the left partition
-    for(i = 0; i < medianIndex; i++)
+    Objects rightObjects = {0};
+    if (!fillPartition(objectsArray, 0, medianIndex, &leftObjects, partSources) ||
+        !fillPartition(objectsArray, medianIndex, numberOfObjects, &rightObjects, partSources + medianIndex))
     {
-        if(objectsArray[i].type == 0)
-        {
-            leftObjects.planes[leftObjects.planeCount] = *(Plane *)objectsArray[i].object;
-            leftObjects.planeCount++;
-        }
-        else if(objectsArray[i].type == 1)
-        {
-            leftObjects.spheres[leftObjects.sphereCount] = *(Sphere *)objectsArray[i].object;
-            leftObjects.sphereCount++;
-        }
-        else
-        {
-            leftObjects.triangles[leftObjects.triangleCount] = *(Triangle *)objectsArray[i].object;
-            leftObjects.triangleCount++;
-        }
+        printf("Error in creating BVH node: Memory allocation failed!\n");
+        freeObjects(&leftObjects);
+        free(objectsArray);
+        free(partSources);
+        free(node);
+        return NULL;
     }
 
-    // Allocate and initialize the right objects list
-    Objects rightObjects;
-    rightObjects.maxPlanes = objects->maxPlanes;
-    rightObjects.maxSpheres = objects->maxSpheres;
-    rightObjects.maxTriangles = objects->maxTriangles;
-    rightObjects.planes = malloc(sizeof(Plane) * objects->maxPlanes);
-    rightObjects.spheres = malloc(sizeof(Sphere) * objects->maxSpheres);
-    rightObjects.triangles = malloc(sizeof(Triangle) * objects->maxTriangles);
-    rightObjects.planeCount = 0;
-    rightObjects.sphereCount = 0;
-    rightObjects.triangleCount = 0;
+    // Free the temporary objects array
+    free(objectsArray);
+
+    // Recursively build left and right child nodes
+    node->left = buildBVHNode(&leftObjects, partSources);
+    node->right = buildBVHNode(&rightObjects, partSources + medianIndex);
+
+    // The children copied what they need from the partitions
+    freeObjects(&leftObjects);
+    freeObjects(&rightObjects);
+    free(partSources);
+
+    node->cost = computeNodeCost(node);
+    node->builtCost = node->cost;
+    return node; // Return the constructed BVH node
+}
 
-    // Assign objects to the right partition
-    for(i = medianIndex; i < numberOfObjects; i++)
+// Function to build the BVH tree over the objects, remembering each one's index for refitBVH()
+BVHNode *buildBVH(Objects *objects)
+{
+    int numberOfObjects = objects->planeCount + objects->sphereCount + objects->triangleCount;
+    if (numberOfObjects == 0)
     {
-        if(objectsArray[i].type == 0)
-        {
-            rightObjects.planes[rightObjects.planeCount] = *(Plane *)objectsArray[i].object;
-            rightObjects.planeCount++;
-        }
-        else if(objectsArray[i].type == 1)
-        {
-            rightObjects.spheres[rightObjects.sphereCount] = *(Sphere *)objectsArray[i].object;
-            rightObjects.sphereCount++;
-        }
-        else
+        return NULL; // If no objects, return NULL
+    }
+
+    // Sources restart at 0 for every type
+    int *sources = malloc(sizeof(int) * numberOfObjects);
+    if (!sources)
+    {
+        printf("Error in creating BVH: Memory allocation failed!\n");
+        return NULL;
+    }
+    int i = 0;
+    for (int j = 0; j < objects->planeCount; j++) sources[i++] = j;
+    for (int j = 0; j < objects->sphereCount; j++) sources[i++] = j;
+    for (int j = 0; j < objects->triangleCount; j++) sources[i++] = j;
+
+    BVHNode *root = buildBVHNode(objects, sources);
+    free(sources);
+    return root;
+}
+
+BVHNode *copyBVH(const BVHNode *node)
+{
+    if (node == NULL)
+    {
+        return NULL;
+    }
+
+    BVHNode *copy = malloc(sizeof(BVHNode));
+    if (!copy)
+    {
+        printf("Error in copying BVH: Memory allocation failed!\n");
+        return NULL;
+    }
+    *copy = *node;
+    copy->objects = copyObjects((Objects *)&node->objects);
+    copy->left = copyBVH(node->left);
+    copy->right = copyBVH(node->right);
+
+    // copyObjects() reports its own failure by leaving the copy empty
+    int objectCount = node->objects.planeCount + node->objects.sphereCount + node->objects.triangleCount;
+    int copiedCount = copy->objects.planeCount + copy->objects.sphereCount + copy->objects.triangleCount;
+    if ((node->left && !copy->left) || (node->right && !copy->right) || copiedCount != objectCount)
+    {
+        freeBVH(copy);
+        return NULL;
+    }
+    return copy;
+}
+
+void refitBVH(BVHNode *node, const Objects *objects)
+{
+    if (node == NULL)
+    {
+        return;
+    }
+
+    if (node->left == NULL && node->right == NULL)
+    {
+        if (objects != NULL)
         {
-            rightObjects.triangles[rightObjects.triangleCount] = *(Triangle *)objectsArray[i].object;
-            rightObjects.triangleCount++;
+            int k = 0;
+            int j;
+            for (j = 0; j < node->objects.planeCount; j++) node->objects.planes[j] = objects->planes[node->sources[k++]];
+            for (j = 0; j < node->objects.sphereCount; j++) node->objects.spheres[j] = objects->spheres[node->sources[k++]];
+            for (j = 0; j < node->objects.triangleCount; j++) node->objects.triangles[j] = objects->triangles[node->sources[k++]];
         }
+        node->bounds = computeObjectsAABB(&node->objects);
+    }
+    else
+    {
+        // Children first, so every box is the union of boxes that are already refit
+        refitBVH(node->left, objects);
+        refitBVH(node->right, objects);
+        if (node->left == NULL) node->bounds = node->right->bounds;
+        else if (node->right == NULL) node->bounds = node->left->bounds;
+        else node->bounds = unionAABB(node->left->bounds, node->right->bounds);
     }
+    node->cost = computeNodeCost(node);
+}
 
-    // Free the temporary objects array
-    free(objectsArray);
+// Helper function that counts the objects of each type in the leaves below a node
+static void countBVHObjectTypes(const BVHNode *node, Objects *counts)
+{
+    if (node == NULL)
+    {
+        return;
+    }
+    counts->maxPlanes += node->objects.planeCount;
+    counts->maxSpheres += node->objects.sphereCount;
+    counts->maxTriangles += node->objects.triangleCount;
+    countBVHObjectTypes(node->left, counts);
+    countBVHObjectTypes(node->right, counts);
+}
 
-    // Recursively build left and right child nodes
-    node->left = buildBVH(&leftObjects);
-    node->right = buildBVH(&rightObjects);
+int countBVHObjects(const BVHNode *node)
+{
+    Objects counts = {0};
+    countBVHObjectTypes(node, &counts);
+    return counts.maxPlanes + counts.maxSpheres + counts.maxTriangles;
+}
 
-    return node; // Return the constructed BVH node
+// Helper function that appends the leaf objects below a node to 'objects', and their sources to the
+// per-type sections of 'sources' (planes from 0, spheres from maxPlanes, triangles after those)
+static void gatherBVHObjects(const BVHNode *node, Objects *objects, int *sources)
+{
+    if (node == NULL)
+    {
+        return;
+    }
+    int k = 0;
+    int j;
+    for (j = 0; j < node->objects.planeCount; j++, k++)
+    {
+        sources[objects->planeCount] = node->sources[k];
+        objects->planes[objects->planeCount++] = node->objects.planes[j];
+    }
+    for (j = 0; j < node->objects.sphereCount; j++, k++)
+    {
+        sources[objects->maxPlanes + objects->sphereCount] = node->sources[k];
+        objects->spheres[objects->sphereCount++] = node->objects.spheres[j];
+    }
+    for (j = 0; j < node->objects.triangleCount; j++, k++)
+    {
+        sources[objects->maxPlanes + objects->maxSpheres + objects->triangleCount] = node->sources[k];
+        objects->triangles[objects->triangleCount++] = node->objects.triangles[j];
+    }
+    gatherBVHObjects(node->left, objects, sources);
+    gatherBVHObjects(node->right, objects, sources);
+}
+
+// Helper function that rebuilds the subtree below a node from its own leaves, keeping the node's address.
+// Returns 0 (after printing an error) and leaves the subtree as it was when memory runs out.
+static int rebuildBVHNode(BVHNode *node)
+{
+    Objects objects = {0};
+    countBVHObjectTypes(node, &objects);
+    int numberOfObjects = objects.maxPlanes + objects.maxSpheres + objects.maxTriangles;
+    objects.planes = objects.maxPlanes ? malloc(sizeof(Plane) * objects.maxPlanes) : NULL;
+    objects.spheres = objects.maxSpheres ? malloc(sizeof(Sphere) * objects.maxSpheres) : NULL;
+    objects.triangles = objects.maxTriangles ? malloc(sizeof(Triangle) * objects.maxTriangles) : NULL;
+    int *sources = malloc(sizeof(int) * numberOfObjects);
+    if ((objects.maxPlanes && !objects.planes) || (objects.maxSpheres && !objects.spheres) || (objects.maxTriangles && !objects.triangles) || !sources)
+    {
+        printf("Error in rebuilding BVH: Memory allocation failed!\n");
+        freeObjects(&objects);
+        free(sources);
+        return 0;
+    }
+    gatherBVHObjects(node, &objects, sources);
+
+    BVHNode *rebuilt = buildBVHNode(&objects, sources);
+    freeObjects(&objects);
+    free(sources);
+    if (rebuilt == NULL)
+    {
+        return 0;
+    }
+
+    // Swap the new subtree in under the old node
+    freeBVH(node->left);
+    freeBVH(node->right);
+    freeObjects(&node->objects);
+    *node = *rebuilt;
+    free(rebuilt);
+    return 1;
+}
+
+int rebuildDegradedBVH(BVHNode *node, float maxCostRatio)
+{
+    // Leaves always cost their object count, so only inner nodes degrade
+    if (node == NULL || (node->left == NULL && node->right == NULL))
+    {
+        return 0;
+    }
+
+    if (node->cost > node->builtCost * maxCostRatio)
+    {
+        return rebuildBVHNode(node);
+    }
+
+    int rebuilt = rebuildDegradedBVH(node->left, maxCostRatio) + rebuildDegradedBVH(node->right, maxCostRatio);
+    if (rebuilt > 0)
+    {
+        node->cost = computeNodeCost(node); // Same objects and bounds, cheaper children
+    }
+    return rebuilt;
 }
 
 float intersectAABB(Ray ray, AABB box)
@@ -389,6 +682,8 @@ ObjectIntersection getClosestObjectIntersection(Ray ray, Objects* objects)
     float minDistance = __FLT_MAX__;
     ObjectIntersection closestIntersection;
     closestIntersection.objectType = -1;
+    closestIntersection.object = NULL;
+    closestIntersection.distance = __FLT_MAX__;
     int objectIndex;
     bool intersectionFound = false;
 
@@ -431,6 +726,7 @@ ObjectIntersection getClosestObjectIntersection(Ray ray, Objects* objects)
     if (intersectionFound)
     {
         // Calculate the intersection point.
+        closestIntersection.distance = minDistance;
         closestIntersection.point = addVectors(ray.origin, multiplyVector(ray.direction, minDistance));
         
         // Determine the normal and material based on the object type.
@@ -439,14 +735,17 @@ ObjectIntersection getClosestObjectIntersection(Ray ray, Objects* objects)
             case 0: // Sphere
                 closestIntersection.normal = computeSphereNormal(closestIntersection.point,objects->spheres[objectIndex]);
                 closestIntersection.material = objects->spheres[objectIndex].material;
+                closestIntersection.object = &objects->spheres[objectIndex];
                 break;
             case 1: // Plane
                 closestIntersection.normal = objects->planes[objectIndex].surfaceNormal;
                 closestIntersection.material = objects->planes[objectIndex].material;
+                closestIntersection.object = &objects->planes[objectIndex];
                 break;
             case 2: // Triangle
                 closestIntersection.normal = computeTriangleNormal(objects->triangles[objectIndex], ray.origin);
                 closestIntersection.material = objects->triangles[objectIndex].material;
+                closestIntersection.object = &objects->triangles[objectIndex];
                 break;
         }
     }
@@ -461,46 +760,362 @@ ObjectIntersection getClosestObjectIntersection(Ray ray, Objects* objects)
     return closestIntersection;
 }
 
-int intersectBVH(Ray ray, BVHNode *node, ObjectIntersection *hit)
+// Helper function that computes where a ray enters a box (0 when the origin is inside).
+// Returns 0 when the ray misses the box or only reaches it beyond maxDistance.
+static int rayEntersAABB(Ray ray, AABB box, float maxDistance, float* entryDistance)
 {
-    // Check if the ray intersects the AABB of the current node
-    float nodeIntersection = intersectAABB(ray, node->bounds);
-    if (nodeIntersection <= 0.0f)
+    float origin[3] = {ray.origin.x, ray.origin.y, ray.origin.z};
+    float direction[3] = {ray.direction.x, ray.direction.y, ray.direction.z};
+    float boxMin[3] = {box.min.x, box.min.y, box.min.z};
+    float boxMax[3] = {box.max.x, box.max.y, box.max.z};
+
+    float tMin = 0.0f;
+    float tMax = maxDistance;
+    for (int axis = 0; axis < 3; axis++)
     {
-        return 0; // No intersection with this node
+        if (direction[axis] == 0.0f)
+        {
+            // Parallel to this slab: the origin has to lie between its planes
+            if (origin[axis] < boxMin[axis] || origin[axis] > boxMax[axis]) return 0;
+            continue;
+        }
+
+        float inverseDirection = 1.0f / direction[axis];
+        float tNear = (boxMin[axis] - origin[axis]) * inverseDirection;
+        float tFar = (boxMax[axis] - origin[axis]) * inverseDirection;
+        if (tNear > tFar)
+        {
+            float temp = tNear;
+            tNear = tFar;
+            tFar = temp;
+        }
+
+        tMin = SDL_max(tMin, tNear);
+        tMax = SDL_min(tMax, tFar);
+        if (tMin > tMax) return 0;
     }
 
+    *entryDistance = tMin;
+    return 1;
+}
+
+// Helper function that descends the BVH, keeping the closest hit found so far in 'hit'
+static void findClosestHitBVH(Ray ray, BVHNode* node, ObjectIntersection* hit)
+{
     // If this is a leaf node (no children), check for object intersections
     if (node->left == NULL && node->right == NULL)
     {
-        *hit = getClosestObjectIntersection(ray, &node->objects);
-        return 1; // Intersection found in the leaf node
+        ObjectIntersection leafHit = getClosestObjectIntersection(ray, &node->objects);
+        if (leafHit.objectType >= 0 && leafHit.distance < hit->distance)
+        {
+            *hit = leafHit;
+        }
+        return;
+    }
+
+    // Visit the child the ray enters first, then the other one if it can still hold a closer hit
+    float entryLeft = 0.0f, entryRight = 0.0f;
+    int hitsLeft = node->left != NULL && rayEntersAABB(ray, node->left->bounds, hit->distance, &entryLeft);
+    int hitsRight = node->right != NULL && rayEntersAABB(ray, node->right->bounds, hit->distance, &entryRight);
+
+    BVHNode* first = node->left;
+    BVHNode* second = node->right;
+    float secondEntry = entryRight;
+    int hitsFirst = hitsLeft;
+    int hitsSecond = hitsRight;
+    if (hitsLeft && hitsRight && entryRight < entryLeft)
+    {
+        first = node->right;
+        second = node->left;
+        secondEntry = entryLeft;
+    }
+    else if (!hitsLeft)
+    {
+        first = node->right;
+        hitsFirst = hitsRight;
+        hitsSecond = 0;
+    }
+
+    if (hitsFirst)
+    {
+        findClosestHitBVH(ray, first, hit);
+    }
+    if (hitsSecond && secondEntry <= hit->distance)
+    {
+        findClosestHitBVH(ray, second, hit);
+    }
+}
+
+int intersectBVH(Ray ray, BVHNode *node, ObjectIntersection *hit)
+{
+    return intersectBVHNodes(ray, &node, node != NULL, hit);
+}
+
+int intersectBVHNodes(Ray ray, BVHNode* const* nodes, int count, ObjectIntersection* hit)
+{
+    hit->objectType = -1;
+    hit->object = NULL;
+    hit->distance = __FLT_MAX__;
+
+    // Subtrees the ray misses, or only reaches behind the closest hit so far, are skipped
+    for (int i = 0; i < count; i++)
+    {
+        float entryDistance;
+        if (rayEntersAABB(ray, nodes[i]->bounds, hit->distance, &entryDistance))
+        {
+            findClosestHitBVH(ray, nodes[i], hit);
+        }
+    }
+    return hit->objectType >= 0;
+}
+
+void initBVHFrustum(BVHFrustum* frustum, Vector origin, const Vector corners[4])
+{
+    Vector center = addVectors(addVectors(corners[0], corners[1]), addVectors(corners[2], corners[3]));
+    frustum->origin = origin;
+    for (int i = 0; i < 4; i++)
+    {
+        // The plane through two neighbouring corner rays; flipped if needed so the pyramid is on its positive side
+        Vector normal = vectorCrossProduct(corners[i], corners[(i + 1) % 4]);
+        if (dotProduct(normal, center) < 0.0f)
+        {
+            normal = multiplyVector(normal, -1.0f);
+        }
+        frustum->normals[i] = normal;
+    }
+}
+
+// How a box lies relative to a frustum
+typedef enum {
+    FRUSTUM_OUTSIDE = 0,
+    FRUSTUM_CROSSING,
+    FRUSTUM_INSIDE
+} FrustumOverlap;
+
+// Helper function that classifies a box against the side planes of a frustum. Boxes that are outside the
+// pyramid without being outside one plane count as crossing, which only costs a subtree too many.
+static FrustumOverlap classifyFrustumAABB(const BVHFrustum* frustum, AABB box)
+{
+    Vector low = subtractVectors(box.min, frustum->origin);
+    Vector high = subtractVectors(box.max, frustum->origin);
+    FrustumOverlap overlap = FRUSTUM_INSIDE;
+    for (int i = 0; i < 4; i++)
+    {
+        // Corners of the box furthest along and furthest against the normal
+        Vector normal = frustum->normals[i];
+        Vector farCorner = {normal.x > 0.0f ? high.x : low.x, normal.y > 0.0f ? high.y : low.y, normal.z > 0.0f ? high.z : low.z};
+        Vector nearCorner = {normal.x > 0.0f ? low.x : high.x, normal.y > 0.0f ? low.y : high.y, normal.z > 0.0f ? low.z : high.z};
+        if (dotProduct(normal, farCorner) < 0.0f) return FRUSTUM_OUTSIDE;
+        if (dotProduct(normal, nearCorner) < 0.0f) overlap = FRUSTUM_CROSSING;
+    }
+    return overlap;
+}
+
+// Helper function that collects the subtrees below a crossing node that the frustum can see.
+// Returns 0 when they do not fit into 'capacity' nodes.
+static int collectFrustumNodes(const BVHFrustum* frustum, BVHNode* node, BVHNode** nodes, int* count, int capacity)
+{
+    FrustumOverlap overlap = classifyFrustumAABB(frustum, node->bounds);
+    if (overlap == FRUSTUM_OUTSIDE) return 1;
+
+    if (overlap == FRUSTUM_INSIDE || (node->left == NULL && node->right == NULL))
+    {
+        if (*count == capacity) return 0;
+        nodes[(*count)++] = node;
+        return 1;
+    }
+
+    return (node->left == NULL || collectFrustumNodes(frustum, node->left, nodes, count, capacity))
+        && (node->right == NULL || collectFrustumNodes(frustum, node->right, nodes, count, capacity));
+}
+
+// Helper function that returns the distance from a point to a box, 0 when the point is inside
+static float distanceToAABB(Vector point, AABB box)
+{
+    Vector offset = {
+        SDL_max(SDL_max(box.min.x - point.x, point.x - box.max.x), 0.0f),
+        SDL_max(SDL_max(box.min.y - point.y, point.y - box.max.y), 0.0f),
+        SDL_max(SDL_max(box.min.z - point.z, point.z - box.max.z), 0.0f)
+    };
+    return vectorLength(offset);
+}
+
+int cullBVHFrustum(BVHNode* root, const BVHFrustum* frustum, BVHNode** nodes, int capacity)
+{
+    capacity = SDL_min(capacity, BVH_FRUSTUM_MAX_NODES);
+    if (root == NULL || capacity < 1 || classifyFrustumAABB(frustum, root->bounds) == FRUSTUM_OUTSIDE) return 0;
+
+    // Go down while only one child is visible; that node is the fallback when the cut grows too large
+    BVHNode* entry = root;
+    while (entry->left != NULL && entry->right != NULL)
+    {
+        int leftVisible = classifyFrustumAABB(frustum, entry->left->bounds) != FRUSTUM_OUTSIDE;
+        int rightVisible = classifyFrustumAABB(frustum, entry->right->bounds) != FRUSTUM_OUTSIDE;
+        if (leftVisible == rightVisible)
+        {
+            if (!leftVisible) return 0;
+            break;
+        }
+        entry = leftVisible ? entry->left : entry->right;
+    }
+
+    int count = 0;
+    if (!collectFrustumNodes(frustum, entry, nodes, &count, capacity))
+    {
+        nodes[0] = entry;
+        return 1;
+    }
+
+    // Nearest subtrees first, so rays find close hits early and skip the subtrees behind them
+    float distances[BVH_FRUSTUM_MAX_NODES];
+    for (int i = 0; i < count; i++)
+    {
+        BVHNode* node = nodes[i];
+        float distance = distanceToAABB(frustum->origin, node->bounds);
+        int j = i;
+        for (; j > 0 && distances[j - 1] > distance; j--)
+        {
+            distances[j] = distances[j - 1];
+            nodes[j] = nodes[j - 1];
+        }
+        distances[j] = distance;
+        nodes[j] = node;
+    }
+    return count;
+}
+
+// SIMD_LANES shadow rays in lane form, plus a box around all of their segments
+typedef struct {
+    VectorLanes origin;
+    VectorLanes inverseDirection;
+    FloatLanes maxDistance;
+    Ray rays[SIMD_LANES];
+    float maxDistances[SIMD_LANES];
+    AABB segmentBounds; // Box around every segment from origin to maxDistance (only valid when 'bounded')
+    int bounded;        // Every ray ends at a finite distance
+} ShadowPacket;
+
+// Helper function that checks whether two boxes overlap
+static int boxesOverlap(AABB a, AABB b)
+{
+    return a.min.x <= b.max.x && a.max.x >= b.min.x
+        && a.min.y <= b.max.y && a.max.y >= b.min.y
+        && a.min.z <= b.max.z && a.max.z >= b.min.z;
+}
+
+// Helper function that returns the active lanes whose ray passes through the box before its max distance.
+// A box outside the packet's segment bounds is rejected for all lanes with one test.
+static int packetEntersAABB(const ShadowPacket* packet, AABB box, int activeMask)
+{
+    if (packet->bounded && !boxesOverlap(packet->segmentBounds, box)) return 0;
+
+    FloatLanes nearX = multiplyLanes(subtractLanes(splatLanes(box.min.x), packet->origin.x), packet->inverseDirection.x);
+    FloatLanes farX = multiplyLanes(subtractLanes(splatLanes(box.max.x), packet->origin.x), packet->inverseDirection.x);
+    FloatLanes nearY = multiplyLanes(subtractLanes(splatLanes(box.min.y), packet->origin.y), packet->inverseDirection.y);
+    FloatLanes farY = multiplyLanes(subtractLanes(splatLanes(box.max.y), packet->origin.y), packet->inverseDirection.y);
+    FloatLanes nearZ = multiplyLanes(subtractLanes(splatLanes(box.min.z), packet->origin.z), packet->inverseDirection.z);
+    FloatLanes farZ = multiplyLanes(subtractLanes(splatLanes(box.max.z), packet->origin.z), packet->inverseDirection.z);
+
+    FloatLanes entry = maxLanes(maxLanes(minLanes(nearX, farX), minLanes(nearY, farY)), maxLanes(minLanes(nearZ, farZ), splatLanes(0.0f)));
+    FloatLanes exit = minLanes(minLanes(maxLanes(nearX, farX), maxLanes(nearY, farY)), minLanes(maxLanes(nearZ, farZ), packet->maxDistance));
+    return activeMask & ~maskBits(greaterThanLanes(entry, exit));
+}
+
+// Helper function that checks whether any object of a leaf blocks one shadow ray before maxDistance
+static int leafOccludesRay(const Objects* objects, Ray ray, float maxDistance)
+{
+    float distance;
+    for (int i = 0; i < objects->sphereCount; i++)
+    {
+        if (intersectRaySphere(ray, objects->spheres[i], &distance) && distance > 0 && distance < maxDistance) return 1;
     }
+    for (int i = 0; i < objects->planeCount; i++)
+    {
+        if (intersectRayPlane(ray, objects->planes[i], &distance) && distance > 0 && distance < maxDistance) return 1;
+    }
+    for (int i = 0; i < objects->triangleCount; i++)
+    {
+        if (intersectRayTriangle(ray, objects->triangles[i], &distance) && distance > 0 && distance < maxDistance) return 1;
+    }
+    return 0;
+}
 
-    // Check for intersection distances with the bounding boxes of the left and right child nodes
-    float intersectDistanceLeft = node->left ? intersectAABB(ray, node->left->bounds) : 0.0f;
-    float intersectDistanceRight = node->right ? intersectAABB(ray, node->right->bounds) : 0.0f;
+// Helper function that descends the BVH with the lanes that are still unblocked and returns the lanes
+// blocked below this node; the walk stops as soon as every lane is blocked
+static int findPacketOccluders(const ShadowPacket* packet, BVHNode* node, int activeMask)
+{
+    activeMask = packetEntersAABB(packet, node->bounds, activeMask);
+    if (activeMask == 0) return 0;
 
-    // Prioritize checking the child node with the closer intersection
-    if (node->left != NULL && intersectDistanceLeft > 0.0f && 
-        (intersectDistanceRight == 0.0f || intersectDistanceLeft < intersectDistanceRight))
+    if (node->left == NULL && node->right == NULL)
     {
-        if (intersectBVH(ray, node->left, hit))
+        int blocked = 0;
+        for (int lane = 0; lane < SIMD_LANES; lane++)
         {
-            return 1; // Intersection found in the left subtree
+            if ((activeMask >> lane) & 1 && leafOccludesRay(&node->objects, packet->rays[lane], packet->maxDistances[lane]))
+            {
+                blocked |= 1 << lane;
+            }
         }
+        return blocked;
+    }
+
+    int blocked = 0;
+    if (node->left != NULL)
+    {
+        blocked = findPacketOccluders(packet, node->left, activeMask);
     }
+    if (node->right != NULL && (activeMask & ~blocked) != 0)
+    {
+        blocked |= findPacketOccluders(packet, node->right, activeMask & ~blocked);
+    }
+    return blocked;
+}
 
-    if (node->right != NULL && intersectDistanceRight > 0.0f && 
-        (intersectDistanceLeft == 0.0f || intersectDistanceRight < intersectDistanceLeft))
+int traceShadowPacketBVH(BVHNode *root, const Ray *rays, const float *maxDistances, int count)
+{
+    if (root == NULL || count <= 0) return 0;
+    count = SDL_min(count, SIMD_LANES);
+
+    ShadowPacket packet;
+    float originX[SIMD_LANES], originY[SIMD_LANES], originZ[SIMD_LANES];
+    float inverseX[SIMD_LANES], inverseY[SIMD_LANES], inverseZ[SIMD_LANES];
+    packet.bounded = 1;
+    packet.segmentBounds = (AABB){{__FLT_MAX__, __FLT_MAX__, __FLT_MAX__}, {-__FLT_MAX__, -__FLT_MAX__, -__FLT_MAX__}};
+    for (int lane = 0; lane < SIMD_LANES; lane++)
     {
-        if (intersectBVH(ray, node->right, hit))
+        // Unused lanes repeat the first ray and are masked off
+        int source = lane < count ? lane : 0;
+        Ray ray = rays[source];
+        float maxDistance = maxDistances[source];
+        packet.rays[lane] = ray;
+        packet.maxDistances[lane] = maxDistance;
+
+        originX[lane] = ray.origin.x;
+        originY[lane] = ray.origin.y;
+        originZ[lane] = ray.origin.z;
+
+        // A zero component is nudged so its inverse is huge but finite and the slab test stays NaN-free
+        inverseX[lane] = 1.0f / (ray.direction.x != 0.0f ? ray.direction.x : 1e-30f);
+        inverseY[lane] = 1.0f / (ray.direction.y != 0.0f ? ray.direction.y : 1e-30f);
+        inverseZ[lane] = 1.0f / (ray.direction.z != 0.0f ? ray.direction.z : 1e-30f);
+
+        // Point and spot light rays end at the light, so their segments fit in a box; directional ones do not
+        if (maxDistance >= __FLT_MAX__)
         {
-            return 1; // Intersection found in the right subtree
+            packet.bounded = 0;
+            continue;
         }
+        Vector end = addVectors(ray.origin, multiplyVector(ray.direction, maxDistance));
+        AABB* bounds = &packet.segmentBounds;
+        bounds->min = (Vector){SDL_min(bounds->min.x, SDL_min(ray.origin.x, end.x)), SDL_min(bounds->min.y, SDL_min(ray.origin.y, end.y)), SDL_min(bounds->min.z, SDL_min(ray.origin.z, end.z))};
+        bounds->max = (Vector){SDL_max(bounds->max.x, SDL_max(ray.origin.x, end.x)), SDL_max(bounds->max.y, SDL_max(ray.origin.y, end.y)), SDL_max(bounds->max.z, SDL_max(ray.origin.z, end.z))};
     }
+    packet.origin = (VectorLanes){loadLanes(originX), loadLanes(originY), loadLanes(originZ)};
+    packet.inverseDirection = (VectorLanes){loadLanes(inverseX), loadLanes(inverseY), loadLanes(inverseZ)};
+    packet.maxDistance = loadLanes(packet.maxDistances);
 
-    return 0; // No intersection found in this subtree
+    return findPacketOccluders(&packet, root, (1 << count) - 1);
 }
 
 void freeBVH(BVHNode *node)
@@ -514,9 +1129,7 @@ void freeBVH(BVHNode *node)
     freeBVH(node->right);
 
     // Free the dynamically allocated objects' arrays
-    free(node->objects.planes);
-    free(node->objects.spheres);
-    free(node->objects.triangles);
+    freeObjects(&node->objects);
 
     // Free the BVH node itself
     free(node);
@@ -1,4 +1,5 @@
 #include "camera.h"
+#include "simd.h"
 
 // Initializes the camera with a specific position, direction, and field of view.
 void initCamera(Camera* camera, Vector pos, Vector dir, Vector up, float fov, int screenWidth, int screenHeight)
@@ -23,11 +24,11 @@ Ray mapPixelToRay(Camera* camera, int pixelX, int pixelY, int screenWidth, int s
     float computedX, computedY, scale;
     
     // Convert pixel coordinates to normalized device coordinates (NDC) ranging from -1 to 1
-    computedX = 2 * (pixelX + 0.5) / screenWidth - 1;
-    computedY = 1 - 2 * (pixelY + 0.5) / screenHeight;
+    computedX = 2.0f * (pixelX + 0.5f) / screenWidth - 1.0f;
+    computedY = 1.0f - 2.0f * (pixelY + 0.5f) / screenHeight;
 
     // Compute the scaling factor using the tangent of half the FOV (converted to radians)
-    scale = SDL_tan((camera->fieldOfView * SDL_PI_F / 180.0) / 2);
+    scale = SDL_tanf((camera->fieldOfView * SDL_PI_F / 180.0f) / 2.0f);
     computedX *= scale; // Scale the x coordinate by FOV
     computedY *= scale; // Scale the y coordinate by FOV
     computedX *= camera->aspectRatio; // Apply aspect ratio correction to x
@@ -47,6 +48,115 @@ Ray mapPixelToRay(Camera* camera, int pixelX, int pixelY, int screenWidth, int s
     return ray;
 }
 
+void initRayGenerator(RayGenerator* generator, Camera* camera, int screenWidth, int screenHeight)
+{
+    // Half extents of the image plane at distance 1 in front of the camera
+    float halfHeight = SDL_tanf((camera->fieldOfView * SDL_PI_F / 180.0f) / 2.0f);
+    float halfWidth = halfHeight * camera->aspectRatio;
+
+    Vector right = multiplyVector(camera->rightVector, halfWidth);
+    Vector up = multiplyVector(camera->upVector, halfHeight);
+
+    generator->origin = camera->position;
+    generator->screenWidth = screenWidth;
+    generator->screenHeight = screenHeight;
+
+    // One pixel spans 2 / width of the NDC range horizontally and 2 / height vertically (downwards)
+    generator->deltaX = multiplyVector(right, 2.0f / screenWidth);
+    generator->deltaY = multiplyVector(up, -2.0f / screenHeight);
+
+    // Direction through the image-plane corner (0, 0): forward - right + up
+    generator->topLeft = addVectors(camera->direction, subtractVectors(up, right));
+}
+
+void setRayGeneratorJitter(RayGenerator* generator, float offsetX, float offsetY)
+{
+    generator->topLeft = addVectors(generator->topLeft,
+        addVectors(multiplyVector(generator->deltaX, offsetX), multiplyVector(generator->deltaY, offsetY)));
+}
+
+Ray generateRay(const RayGenerator* generator, float imageX, float imageY)
+{
+    Vector direction = addVectors(generator->topLeft,
+        addVectors(multiplyVector(generator->deltaX, imageX), multiplyVector(generator->deltaY, imageY)));
+
+    Ray ray;
+    ray.origin = generator->origin;
+    ray.direction = normalizeVector(direction);
+    return ray;
+}
+
+void generateRayRow(const RayGenerator* generator, int pixelX, int pixelY, int count, Ray* rays)
+{
+    // Direction through the left edge of the image row at the pixel centers' height. Each ray only depends
+    // on its own pixel position, so a pixel gets the same ray whichever tile or row segment it is generated in.
+    Vector rowBase = addVectors(generator->topLeft, multiplyVector(generator->deltaY, pixelY + 0.5f));
+
+    VectorLanes base = splatVectorLanes(rowBase);
+    VectorLanes delta = splatVectorLanes(generator->deltaX);
+    float laneOffsets[SIMD_LANES];
+
+    // The last batch is padded with the pixels after the row segment and only its first rays are stored
+    for (int i = 0; i < count; i += SIMD_LANES)
+    {
+        for (int lane = 0; lane < SIMD_LANES; lane++)
+        {
+            laneOffsets[lane] = (float)(pixelX + i + lane) + 0.5f;
+        }
+        FloatLanes offset = loadLanes(laneOffsets);
+
+        VectorLanes direction = {
+            addLanes(base.x, multiplyLanes(delta.x, offset)),
+            addLanes(base.y, multiplyLanes(delta.y, offset)),
+            addLanes(base.z, multiplyLanes(delta.z, offset))
+        };
+
+        // Normalize the whole batch with one square root and one division
+        FloatLanes inverseLength = divideLanes(splatLanes(1.0f), sqrtLanes(dotProductLanes(direction, direction)));
+
+        float x[SIMD_LANES], y[SIMD_LANES], z[SIMD_LANES];
+        storeLanes(x, multiplyLanes(direction.x, inverseLength));
+        storeLanes(y, multiplyLanes(direction.y, inverseLength));
+        storeLanes(z, multiplyLanes(direction.z, inverseLength));
+
+        int batch = SDL_min(SIMD_LANES, count - i);
+        for (int lane = 0; lane < batch; lane++)
+        {
+            rays[i + lane].origin = generator->origin;
+            rays[i + lane].direction = (Vector){x[lane], y[lane], z[lane]};
+        }
+    }
+}
+
+void generateRayTile(const RayGenerator* generator, int pixelX, int pixelY, int width, int height, Ray* rays)
+{
+    for (int row = 0; row < height; row++)
+    {
+        generateRayRow(generator, pixelX, pixelY + row, width, &rays[row * width]);
+    }
+}
+
+int projectPointToPixel(const RayGenerator* generator, Vector point, float* imageX, float* imageY, float* depth)
+{
+    // Write the offset as a * deltaX + b * deltaY + c * topLeft (Cramer's rule), then the ray through
+    // image position (a / c, b / c) passes through the point
+    Vector offset = subtractVectors(point, generator->origin);
+    Vector deltaXCrossDeltaY = vectorCrossProduct(generator->deltaX, generator->deltaY);
+    float determinant = dotProduct(generator->topLeft, deltaXCrossDeltaY);
+    if (determinant == 0.0f) return 0;
+
+    float c = dotProduct(offset, deltaXCrossDeltaY) / determinant;
+    if (c <= 1e-6f) return 0;
+
+    float a = dotProduct(offset, vectorCrossProduct(generator->deltaY, generator->topLeft)) / determinant;
+    float b = dotProduct(offset, vectorCrossProduct(generator->topLeft, generator->deltaX)) / determinant;
+
+    *imageX = a / c;
+    *imageY = b / c;
+    *depth = c; // topLeft is one unit ahead of the camera and the deltas are perpendicular to the view
+    return 1;
+}
+
 void moveCameraForward(Camera *camera)
 {
     camera->position = addVectors(camera->position, multiplyVector( camera->direction, 0.1f));    
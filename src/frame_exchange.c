@@ -0,0 +1,60 @@
+#include "frame_exchange.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+int initFrameExchange(FrameExchange* exchange, int width, int height)
+{
+    *exchange = (FrameExchange){0};
+    exchange->pixelsPerRow = width;
+    exchange->maxHeight = height;
+    for (int i = 0; i < FRAME_EXCHANGE_SLOTS; i++)
+    {
+        exchange->frames[i].pixels = calloc((size_t)width * height, sizeof(Uint32));
+        if (exchange->frames[i].pixels == NULL)
+        {
+            printf("Error in creating frame exchange: Memory allocation failed!\n");
+            freeFrameExchange(exchange);
+            return 0;
+        }
+    }
+    exchange->renderSlot = 0;
+    SDL_SetAtomicInt(&exchange->middle, 1);
+    exchange->presentSlot = 2;
+    return 1;
+}
+
+void freeFrameExchange(FrameExchange* exchange)
+{
+    for (int i = 0; i < FRAME_EXCHANGE_SLOTS; i++)
+    {
+        free(exchange->frames[i].pixels);
+        exchange->frames[i].pixels = NULL;
+    }
+}
+
+RenderedFrame* getFrameToRender(FrameExchange* exchange)
+{
+    return &exchange->frames[exchange->renderSlot];
+}
+
+void publishFrame(FrameExchange* exchange)
+{
+    exchange->frames[exchange->renderSlot].frameNumber = ++exchange->published;
+
+    // The exchange is a full barrier: the frame is complete before the presenter can see its slot
+    int previous = SDL_SetAtomicInt(&exchange->middle, exchange->renderSlot | FRAME_EXCHANGE_FRESH);
+    exchange->renderSlot = previous & ~FRAME_EXCHANGE_FRESH;
+}
+
+const RenderedFrame* acquireLatestFrame(FrameExchange* exchange)
+{
+    if (SDL_GetAtomicInt(&exchange->middle) & FRAME_EXCHANGE_FRESH)
+    {
+        int previous = SDL_SetAtomicInt(&exchange->middle, exchange->presentSlot);
+        exchange->presentSlot = previous & ~FRAME_EXCHANGE_FRESH;
+    }
+
+    const RenderedFrame* frame = &exchange->frames[exchange->presentSlot];
+    return frame->frameNumber > 0 ? frame : NULL;
+}
@@ -0,0 +1,68 @@
+#include "frame_governor.h"
+
+void initFrameGovernor(FrameGovernor* governor, float targetMilliseconds, float minScale, int maxSamplesPerPixel)
+{
+    governor->enabled = 1;
+    governor->targetMilliseconds = targetMilliseconds;
+    governor->minScale = SDL_clamp(minScale, GOVERNOR_SCALE_STEP, 1.0f);
+    governor->scale = 1.0f;
+    governor->averageMilliseconds = 0.0f;
+    governor->maxSamplesPerPixel = maxSamplesPerPixel;
+}
+
+// Helper function that rounds a scale to the scale grid and keeps it within [minScale, 1]
+static float snapScale(const FrameGovernor* governor, float scale)
+{
+    scale = SDL_roundf(scale / GOVERNOR_SCALE_STEP) * GOVERNOR_SCALE_STEP;
+    return SDL_clamp(scale, governor->minScale, 1.0f);
+}
+
+int updateFrameGovernor(FrameGovernor* governor, double frameMilliseconds, RenderSettings* settings)
+{
+    if (!governor->enabled) return 0;
+
+    governor->averageMilliseconds = governor->averageMilliseconds > 0.0f
+        ? governor->averageMilliseconds + GOVERNOR_SMOOTHING * ((float)frameMilliseconds - governor->averageMilliseconds)
+        : (float)frameMilliseconds;
+
+    float target = governor->targetMilliseconds;
+    float average = governor->averageMilliseconds;
+    int overBudget = average > target;
+    int underBudget = average < target * (1.0f - GOVERNOR_TOLERANCE);
+    if (!overBudget && !underBudget) return 0;
+
+    float oldScale = governor->scale;
+    int oldSamples = settings->maxSamplesPerPixel;
+
+    if (underBudget && settings->maxSamplesPerPixel < governor->maxSamplesPerPixel)
+    {
+        // Edge samples were the last thing given up, so they come back first
+        settings->maxSamplesPerPixel = SDL_min(settings->maxSamplesPerPixel * 2, governor->maxSamplesPerPixel);
+    }
+    else
+    {
+        // Render cost grows with the pixel count, i.e. with the square of the scale
+        float step = SDL_sqrtf(target / SDL_max(average, 0.001f));
+        step = SDL_clamp(step, 1.0f / GOVERNOR_MAX_STEP, GOVERNOR_MAX_STEP);
+        governor->scale = snapScale(governor, governor->scale * step);
+
+        if (overBudget && governor->scale == oldScale && settings->maxSamplesPerPixel > 1)
+        {
+            // Already at the smallest resolution: trace fewer rays at edges
+            settings->maxSamplesPerPixel /= 2;
+        }
+    }
+
+    if (governor->scale == oldScale && settings->maxSamplesPerPixel == oldSamples) return 0;
+
+    // Frames rendered with the old settings say nothing about the new ones
+    governor->averageMilliseconds = 0.0f;
+    return 1;
+}
+
+void getGovernedResolution(const FrameGovernor* governor, int windowWidth, int windowHeight, int* width, int* height)
+{
+    float scale = governor->enabled ? governor->scale : 1.0f;
+    *width = SDL_max(1, (int)(windowWidth * scale + 0.5f));
+    *height = SDL_max(1, (int)(windowHeight * scale + 0.5f));
+}
@@ -0,0 +1,232 @@
+#include "framebuffer.h"
+#include "simd.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// 4x4 ordered dithering matrix (Bayer), values 0..15
+static const float bayerMatrix[4][4] = {
+    { 0.0f,  8.0f,  2.0f, 10.0f},
+    {12.0f,  4.0f, 14.0f,  6.0f},
+    { 3.0f, 11.0f,  1.0f,  9.0f},
+    {15.0f,  7.0f, 13.0f,  5.0f}
+};
+
+void initFrameBuffer(FrameBuffer* buffer, int width, int height)
+{
+    buffer->width = width;
+    buffer->height = height;
+    buffer->red = calloc((size_t)width * height, sizeof(float));
+    buffer->green = calloc((size_t)width * height, sizeof(float));
+    buffer->blue = calloc((size_t)width * height, sizeof(float));
+
+    if (!buffer->red || !buffer->green || !buffer->blue)
+    {
+        printf("Error in creating frame buffer: Memory allocation failed!\n");
+        freeFrameBuffer(buffer);
+    }
+}
+
+void freeFrameBuffer(FrameBuffer* buffer)
+{
+    free(buffer->red);
+    free(buffer->green);
+    free(buffer->blue);
+    buffer->red = NULL;
+    buffer->green = NULL;
+    buffer->blue = NULL;
+}
+
+void clearFrameBuffer(FrameBuffer* buffer)
+{
+    if (buffer->red == NULL) return;
+
+    size_t size = sizeof(float) * buffer->width * buffer->height;
+    SDL_memset(buffer->red, 0, size);
+    SDL_memset(buffer->green, 0, size);
+    SDL_memset(buffer->blue, 0, size);
+}
+
+void initGBuffer(GBuffer* buffer, int width, int height)
+{
+    buffer->width = width;
+    buffer->height = height;
+    buffer->object = calloc((size_t)width * height, sizeof(const void*));
+    buffer->position = calloc((size_t)width * height, sizeof(Vector));
+    buffer->normal = calloc((size_t)width * height, sizeof(Vector));
+    buffer->material = calloc((size_t)width * height, sizeof(Material));
+    if (!buffer->object || !buffer->position || !buffer->normal || !buffer->material)
+    {
+        printf("Error in creating G-buffer: Memory allocation failed!\n");
+        freeGBuffer(buffer);
+    }
+}
+
+void freeGBuffer(GBuffer* buffer)
+{
+    free((void*)buffer->object);
+    free(buffer->position);
+    free(buffer->normal);
+    free(buffer->material);
+    buffer->object = NULL;
+    buffer->position = NULL;
+    buffer->normal = NULL;
+    buffer->material = NULL;
+}
+
+void writeGBufferHit(GBuffer* buffer, int index, const PixelHit* hit)
+{
+    buffer->object[index] = hit->object;
+    buffer->position[index] = hit->position;
+    buffer->normal[index] = hit->normal;
+    buffer->material[index] = hit->material;
+}
+
+PixelHit readGBufferHit(const GBuffer* buffer, int index)
+{
+    return (PixelHit){buffer->object[index], buffer->position[index], buffer->normal[index], buffer->material[index]};
+}
+
+// Helper function that applies exposure, tone mapping and the optional sRGB curve, returning values in [0, 1]
+static FloatLanes toneMapLanes(FloatLanes value, const ResolveSettings* settings)
+{
+    value = maxLanes(multiplyLanes(value, splatLanes(settings->exposure)), splatLanes(0.0f));
+
+    if (settings->toneMapping == TONE_MAP_REINHARD)
+    {
+        value = divideLanes(value, addLanes(splatLanes(1.0f), value));
+    }
+    value = minLanes(value, splatLanes(1.0f));
+
+    if (settings->encodeSRGB)
+    {
+        // Fit of 1.055 * x^(1/2.4) - 0.055 built from repeated square roots (within half a step of 8-bit output),
+        // with the linear segment near black
+        FloatLanes root2 = sqrtLanes(value);
+        FloatLanes root4 = sqrtLanes(root2);
+        FloatLanes root8 = sqrtLanes(root4);
+        FloatLanes curve = addLanes(addLanes(multiplyLanes(splatLanes(0.662002687f), root2), multiplyLanes(splatLanes(0.684122060f), root4)),
+                                    subtractLanes(multiplyLanes(splatLanes(-0.323583601f), root8), multiplyLanes(splatLanes(0.0225411470f), value)));
+        FloatLanes linear = multiplyLanes(value, splatLanes(12.92f));
+        value = clampLanes(selectLanes(lessThanLanes(value, splatLanes(0.0031308f)), linear, curve), 0.0f, 1.0f);
+    }
+
+    return value;
+}
+
+void resolveFrameBuffer(const FrameBuffer* buffer, int firstRow, int rowCount, Uint32* pixels, int pixelsPerRow, const SDL_PixelFormatDetails* format, const ResolveSettings* settings)
+{
+    if (buffer->red == NULL) return;
+
+    // Largest value of each channel in the target format (255 for 8-bit channels)
+    FloatLanes redScale = splatLanes((float)((1u << format->Rbits) - 1));
+    FloatLanes greenScale = splatLanes((float)((1u << format->Gbits) - 1));
+    FloatLanes blueScale = splatLanes((float)((1u << format->Bbits) - 1));
+    Uint32 alphaBits = format->Amask; // Always fully opaque
+
+    for (int y = firstRow; y < firstRow + rowCount; y++)
+    {
+        const float* red = &buffer->red[y * buffer->width];
+        const float* green = &buffer->green[y * buffer->width];
+        const float* blue = &buffer->blue[y * buffer->width];
+        Uint32* pixelRow = &pixels[y * pixelsPerRow];
+
+        // Rounding offset, or this row's ordered dithering thresholds repeated across the batch
+        float offsets[SIMD_LANES];
+        for (int lane = 0; lane < SIMD_LANES; lane++)
+        {
+            offsets[lane] = settings->dither ? (bayerMatrix[y & 3][lane & 3] + 0.5f) / 16.0f : 0.5f;
+        }
+        FloatLanes offset = loadLanes(offsets);
+
+        for (int x = 0; x < buffer->width; x += SIMD_LANES)
+        {
+            int count = SDL_min(SIMD_LANES, buffer->width - x);
+
+            // The last batch of a row may be partial; copy it into full lanes
+            float redTail[SIMD_LANES] = {0}, greenTail[SIMD_LANES] = {0}, blueTail[SIMD_LANES] = {0};
+            const float* redSource = red + x;
+            const float* greenSource = green + x;
+            const float* blueSource = blue + x;
+            if (count < SIMD_LANES)
+            {
+                SDL_memcpy(redTail, redSource, sizeof(float) * count);
+                SDL_memcpy(greenTail, greenSource, sizeof(float) * count);
+                SDL_memcpy(blueTail, blueSource, sizeof(float) * count);
+                redSource = redTail;
+                greenSource = greenTail;
+                blueSource = blueTail;
+            }
+
+            FloatLanes r = addLanes(multiplyLanes(toneMapLanes(loadLanes(redSource), settings), redScale), offset);
+            FloatLanes g = addLanes(multiplyLanes(toneMapLanes(loadLanes(greenSource), settings), greenScale), offset);
+            FloatLanes b = addLanes(multiplyLanes(toneMapLanes(loadLanes(blueSource), settings), blueScale), offset);
+
+            // The offset stays below 1, so truncation never exceeds the channel maximum
+            if (count == SIMD_LANES)
+            {
+                packPixelLanes(pixelRow + x, r, g, b, alphaBits, format->Rshift, format->Gshift, format->Bshift);
+            }
+            else
+            {
+                Uint32 packed[SIMD_LANES];
+                packPixelLanes(packed, r, g, b, alphaBits, format->Rshift, format->Gshift, format->Bshift);
+                SDL_memcpy(pixelRow + x, packed, sizeof(Uint32) * count);
+            }
+        }
+    }
+}
+
+void initAccumulationBuffer(AccumulationBuffer* buffer, int width, int height)
+{
+    initFrameBuffer(&buffer->sum, width, height);
+    buffer->frameCount = 0;
+}
+
+void freeAccumulationBuffer(AccumulationBuffer* buffer)
+{
+    freeFrameBuffer(&buffer->sum);
+}
+
+void resetAccumulationBuffer(AccumulationBuffer* buffer)
+{
+    buffer->frameCount = 0;
+    clearFrameBuffer(&buffer->sum);
+}
+
+void accumulateFrameBuffer(AccumulationBuffer* buffer, FrameBuffer* frame)
+{
+    if (buffer->sum.red == NULL || frame->red == NULL)
+    {
+        return; // Allocation failed, show the raw frame
+    }
+
+    // Average over the completed frames plus the one being rendered
+    FloatLanes scale = splatLanes(1.0f / (buffer->frameCount + 1));
+    float* sums[3] = {buffer->sum.red, buffer->sum.green, buffer->sum.blue};
+    float* values[3] = {frame->red, frame->green, frame->blue};
+    int count = frame->width * frame->height;
+
+    for (int channel = 0; channel < 3; channel++)
+    {
+        float* sum = sums[channel];
+        float* value = values[channel];
+        int i = 0;
+        for (; i + SIMD_LANES <= count; i += SIMD_LANES)
+        {
+            FloatLanes total = addLanes(loadLanes(sum + i), loadLanes(value + i));
+            storeLanes(sum + i, total);
+            storeLanes(value + i, multiplyLanes(total, scale));
+        }
+        for (; i < count; i++)
+        {
+            sum[i] += value[i];
+            value[i] = sum[i] / (buffer->frameCount + 1);
+        }
+    }
+}
+
+void finishAccumulationFrame(AccumulationBuffer* buffer)
+{
+    buffer->frameCount++;
+}
@@ -1,10 +1,12 @@
 #include "illumination.h"
+#include "light_buffer.h"
+#include "light_bvh.h"
 
-float computePointLightDiffuse(PointLight *light, Vector point, Vector normal, Scene *scene)
-{
-    // Check if the point is in shadow from this light source
-    if (isPointInShadow(point, light, scene)) return 0.0f;
+#include <stdlib.h>
 
+// Helper function that computes the diffuse light of a point light before the shadow test
+static float pointLightDiffuseUnshadowed(PointLight *light, Vector point, Vector normal)
+{
     // Compute light intensity at the given point
     float lightIntensity = computePointLightIntensity(light, point);
 
@@ -21,16 +23,22 @@ float computePointLightDiffuse(PointLight *light, Vector point, Vector normal, S
     if (diffuseFactor <= 0.0f) return 0.0f;
 
     // Compute the final diffuse contribution, clamping the result between 0 and 1
-    float diffuseLight = SDL_clamp(diffuseFactor, 0.0f, 1.0f) * lightIntensity;
+    return SDL_clamp(diffuseFactor, 0.0f, 1.0f) * lightIntensity;
+}
+
+float computePointLightDiffuse(PointLight *light, Vector point, Vector normal, Scene *scene)
+{
+    float diffuseLight = pointLightDiffuseUnshadowed(light, point, normal);
+
+    // Only trace the shadow ray once the light is known to contribute
+    if (diffuseLight <= 0.0f || isPointInShadow(point, light, scene)) return 0.0f;
 
     return diffuseLight;
 }
 
-float computeDirectionalLightDiffuse(DirectionalLight *light, Vector point, Vector normal, Scene* scene)
+// Helper function that computes the diffuse light of a directional light before the shadow test
+static float directionalLightDiffuseUnshadowed(DirectionalLight *light, Vector normal)
 {
-    // Check if the point is in shadow from this light source
-    if (isPointInShadowDir(point, light, scene)) return 0.0f;
-
     // Compute light intensity at the given point
     float lightIntensity = computeDirectionalLightIntensity(light, normal);
 
@@ -44,11 +52,19 @@ float computeDirectionalLightDiffuse(DirectionalLight *light, Vector point, Vect
     return diffuseFactor * lightIntensity;
 }
 
-float computeSpotLightDiffuse(SpotLight *light, Vector point, Vector normal, Scene* scene)
+float computeDirectionalLightDiffuse(DirectionalLight *light, Vector point, Vector normal, Scene* scene)
 {
-    // Check if the point is in shadow from this light source
-    if (isPointInShadowSpot(point, light, scene)) return 0.0f;
+    float diffuseLight = directionalLightDiffuseUnshadowed(light, normal);
+
+    // Only trace the shadow ray once the light is known to contribute
+    if (diffuseLight <= 0.0f || isPointInShadowDir(point, light, scene)) return 0.0f;
 
+    return diffuseLight;
+}
+
+// Helper function that computes the diffuse light of a spotlight before the shadow test
+static float spotLightDiffuseUnshadowed(SpotLight *light, Vector point, Vector normal)
+{
     // Compute light intensity at the given point
     float lightIntensity = computeSpotLightIntensity(light, point, normal);
 
@@ -63,16 +79,22 @@ float computeSpotLightDiffuse(SpotLight *light, Vector point, Vector normal, Sce
     if (diffuseFactor <= 0.0f) return 0.0f;
 
     // Compute the final diffuse contribution, clamping the result between 0 and 1
-    float diffuseLight = SDL_clamp(diffuseFactor, 0.0f, 1.0f) * lightIntensity;
+    return SDL_clamp(diffuseFactor, 0.0f, 1.0f) * lightIntensity;
+}
+
+float computeSpotLightDiffuse(SpotLight *light, Vector point, Vector normal, Scene* scene)
+{
+    float diffuseLight = spotLightDiffuseUnshadowed(light, point, normal);
+
+    // Only trace the shadow ray once the light is known to contribute
+    if (diffuseLight <= 0.0f || isPointInShadowSpot(point, light, scene)) return 0.0f;
 
     return diffuseLight;
 }
 
-float computePointLightSpecular(PointLight *light, Vector point, Vector normal, Vector viewDirection, float shininess, Scene* scene)
+// Helper function that computes the specular light of a point light before the shadow test
+static float pointLightSpecularUnshadowed(PointLight *light, Vector point, Vector normal, Vector viewDirection, float shininess)
 {
-    // Check if the point is in shadow from this light source
-    if (isPointInShadow(point, light, scene)) return 0.0f;
-
     // Compute light intensity at the given point
     float lightIntensity = computePointLightIntensity(light, point);
 
@@ -96,16 +118,22 @@ float computePointLightSpecular(PointLight *light, Vector point, Vector normal,
     float specular = SDL_powf(specularFactor, shininess);
 
     // Compute the final specular contribution, clamping between 0 and 1
-    float specularLight = SDL_clamp(specular * lightIntensity, 0.0f, 1.0f);
-    
-    return specularLight;
+    return SDL_clamp(specular * lightIntensity, 0.0f, 1.0f);
 }
 
-float computeDirectionalLightSpecular(DirectionalLight *light, Vector point, Vector normal, Vector viewDirection, float shininess, Scene* scene)
+float computePointLightSpecular(PointLight *light, Vector point, Vector normal, Vector viewDirection, float shininess, Scene* scene)
 {
-    // Check if the point is in shadow from this light source
-    if (isPointInShadowDir(point, light, scene)) return 0.0f;
+    float specularLight = pointLightSpecularUnshadowed(light, point, normal, viewDirection, shininess);
 
+    // Only trace the shadow ray once the light is known to contribute
+    if (specularLight <= 0.0f || isPointInShadow(point, light, scene)) return 0.0f;
+
+    return specularLight;
+}
+
+// Helper function that computes the specular light of a directional light before the shadow test
+static float directionalLightSpecularUnshadowed(DirectionalLight *light, Vector normal, Vector viewDirection, float shininess)
+{
     // Compute light intensity at the given point
     float lightIntensity = computeDirectionalLightIntensity(light, normal);
 
@@ -126,16 +154,22 @@ float computeDirectionalLightSpecular(DirectionalLight *light, Vector point, Vec
     float specular = SDL_powf(specularFactor, shininess);
 
     // Compute the final specular contribution, clamping between 0 and 1
-    float specularLight = SDL_clamp(specular * lightIntensity, 0.0f, 1.0f);
-    
-    return specularLight;
+    return SDL_clamp(specular * lightIntensity, 0.0f, 1.0f);
 }
 
-float computeSpotLightSpecular(SpotLight *light, Vector point, Vector normal, Vector viewDirection, float shininess, Scene* scene)
+float computeDirectionalLightSpecular(DirectionalLight *light, Vector point, Vector normal, Vector viewDirection, float shininess, Scene* scene)
 {
-    // Check if the point is in shadow from this light source
-    if (isPointInShadowSpot(point, light, scene)) return 0.0f;
+    float specularLight = directionalLightSpecularUnshadowed(light, normal, viewDirection, shininess);
+
+    // Only trace the shadow ray once the light is known to contribute
+    if (specularLight <= 0.0f || isPointInShadowDir(point, light, scene)) return 0.0f;
 
+    return specularLight;
+}
+
+// Helper function that computes the specular light of a spotlight before the shadow test
+static float spotLightSpecularUnshadowed(SpotLight *light, Vector point, Vector normal, Vector viewDirection, float shininess)
+{
     // Compute light intensity at the given point
     float lightIntensity = computeSpotLightIntensity(light, point, normal);
 
@@ -159,101 +193,790 @@ float computeSpotLightSpecular(SpotLight *light, Vector point, Vector normal, Ve
     float specular = SDL_powf(specularFactor, shininess);
 
     // Compute the final specular contribution, clamping between 0 and 1
-    float specularLight = SDL_clamp(specular * lightIntensity, 0.0f, 1.0f);
-    
+    return SDL_clamp(specular * lightIntensity, 0.0f, 1.0f);
+}
+
+float computeSpotLightSpecular(SpotLight *light, Vector point, Vector normal, Vector viewDirection, float shininess, Scene* scene)
+{
+    float specularLight = spotLightSpecularUnshadowed(light, point, normal, viewDirection, shininess);
+
+    // Only trace the shadow ray once the light is known to contribute
+    if (specularLight <= 0.0f || isPointInShadowSpot(point, light, scene)) return 0.0f;
+
     return specularLight;
 }
 
-SDL_Color computeSurfaceColor(Scene *scene, Vector point, Vector normal, Vector viewDirection, Material material)
+// Helper function that accumulates the diffuse and specular contribution of every directional light
+static void accumulateDirectionalLights(Scene *scene, Vector point, Vector normal, Vector viewDirection, float shininess, float diffuse[3], float specular[3])
 {
-    // Final computed color values
-    float finalRed = 0.0f, finalGreen = 0.0f, finalBlue = 0.0f;
-    float diffuseRed = 0.0f, diffuseGreen = 0.0f, diffuseBlue = 0.0f;
-    float specularRed = 0.0f, specularGreen = 0.0f, specularBlue = 0.0f;
+    for (int i = 0; i < scene->lights.directionalLightCount; i++)
+    {
+        float diffuseLight = computeDirectionalLightDiffuse(&scene->lights.directionalLights[i], point, normal, scene);
+        float specularLight = computeDirectionalLightSpecular(&scene->lights.directionalLights[i], point, normal, viewDirection, shininess, scene);
+
+        float lightRed = scene->lights.directionalLights[i].material.color.r / 255.0f;
+        float lightGreen = scene->lights.directionalLights[i].material.color.g / 255.0f;
+        float lightBlue = scene->lights.directionalLights[i].material.color.b / 255.0f;
+
+        diffuse[0] += lightRed * diffuseLight;
+        diffuse[1] += lightGreen * diffuseLight;
+        diffuse[2] += lightBlue * diffuseLight;
 
+        specular[0] += lightRed * specularLight;
+        specular[1] += lightGreen * specularLight;
+        specular[2] += lightBlue * specularLight;
+    }
+}
+
+// Helper function that applies the material color to the summed light and adds the ambient term, without
+// clamping the sums (estimates that are averaged over frames must stay unclamped until the average is taken)
+static FloatColor combineSurfaceColorUnclamped(Scene *scene, Material material, const float diffuse[3], const float specular[3])
+{
     // Extract ambient lighting properties
     float ambientIntensity = scene->lights.ambientLight.material.intensity;
     float ambientRed = (scene->lights.ambientLight.material.color.r / 255.0f) * ambientIntensity;
     float ambientGreen = (scene->lights.ambientLight.material.color.g / 255.0f) * ambientIntensity;
     float ambientBlue = (scene->lights.ambientLight.material.color.b / 255.0f) * ambientIntensity;
 
+    // Compute final color, ensuring material color affects diffuse component
+    FloatColor resultColor;
+    resultColor.r = ambientRed + (material.color.r / 255.0f) * diffuse[0] + specular[0];
+    resultColor.g = ambientGreen + (material.color.g / 255.0f) * diffuse[1] + specular[1];
+    resultColor.b = ambientBlue + (material.color.b / 255.0f) * diffuse[2] + specular[2];
+
+    return resultColor;
+}
+
+// Helper function that clamps the summed light, applies the material color and adds the ambient term
+static FloatColor combineSurfaceColor(Scene *scene, Material material, const float diffuse[3], const float specular[3])
+{
+    // Clamp diffuse and specular values
+    float clampedDiffuse[3];
+    float clampedSpecular[3];
+    for (int channel = 0; channel < 3; channel++)
+    {
+        clampedDiffuse[channel] = SDL_clamp(diffuse[channel], 0.0f, 1.0f);
+        clampedSpecular[channel] = SDL_clamp(specular[channel], 0.0f, 1.0f);
+    }
+
+    return combineSurfaceColorUnclamped(scene, material, clampedDiffuse, clampedSpecular);
+}
+
+// Helper function that clamps a float color and converts it to SDL_Color with the material's alpha
+static SDL_Color toSDLColor(FloatColor color, Uint8 alpha)
+{
+    SDL_Color resultColor = {0}; // Initialize the color struct
+    resultColor.a = alpha;
+    resultColor.r = (Uint8)SDL_clamp(color.r * 255.0f, 0, 255);
+    resultColor.g = (Uint8)SDL_clamp(color.g * 255.0f, 0, 255);
+    resultColor.b = (Uint8)SDL_clamp(color.b * 255.0f, 0, 255);
+
+    return resultColor;
+}
+
+// Helper function that shades every light one by one (reference path for the batched and sampled versions)
+static FloatColor computeSurfaceRadiance(Scene *scene, Vector point, Vector normal, Vector viewDirection, Material material)
+{
+    float diffuse[3] = {0.0f, 0.0f, 0.0f};
+    float specular[3] = {0.0f, 0.0f, 0.0f};
+
     // Process each point light
     for (int i = 0; i < scene->lights.pointLightCount; i++)
     {
-        float diffuse = computePointLightDiffuse(&scene->lights.pointLights[i], point, normal, scene);
-        float specular = computePointLightSpecular(&scene->lights.pointLights[i], point, normal, viewDirection, material.shininess, scene);
+        float diffuseLight = computePointLightDiffuse(&scene->lights.pointLights[i], point, normal, scene);
+        float specularLight = computePointLightSpecular(&scene->lights.pointLights[i], point, normal, viewDirection, material.shininess, scene);
 
         float lightRed = scene->lights.pointLights[i].material.color.r / 255.0f;
         float lightGreen = scene->lights.pointLights[i].material.color.g / 255.0f;
         float lightBlue = scene->lights.pointLights[i].material.color.b / 255.0f;
 
-        diffuseRed += lightRed * diffuse;
-        diffuseGreen += lightGreen * diffuse;
-        diffuseBlue += lightBlue * diffuse;
+        diffuse[0] += lightRed * diffuseLight;
+        diffuse[1] += lightGreen * diffuseLight;
+        diffuse[2] += lightBlue * diffuseLight;
 
-        specularRed += lightRed * specular;
-        specularGreen += lightGreen * specular;
-        specularBlue += lightBlue * specular;
+        specular[0] += lightRed * specularLight;
+        specular[1] += lightGreen * specularLight;
+        specular[2] += lightBlue * specularLight;
     }
 
     // Process each directional light
-    for (int i = 0; i < scene->lights.directionalLightCount; i++)
-    {
-        float diffuse = computeDirectionalLightDiffuse(&scene->lights.directionalLights[i], point, normal, scene);
-        float specular = computeDirectionalLightSpecular(&scene->lights.directionalLights[i], point, normal, viewDirection, material.shininess, scene);
-
-        float lightRed = scene->lights.directionalLights[i].material.color.r / 255.0f;
-        float lightGreen = scene->lights.directionalLights[i].material.color.g / 255.0f;
-        float lightBlue = scene->lights.directionalLights[i].material.color.b / 255.0f;
-
-        diffuseRed += lightRed * diffuse;
-        diffuseGreen += lightGreen * diffuse;
-        diffuseBlue += lightBlue * diffuse;
-
-        specularRed += lightRed * specular;
-        specularGreen += lightGreen * specular;
-        specularBlue += lightBlue * specular;
-    }
+    accumulateDirectionalLights(scene, point, normal, viewDirection, material.shininess, diffuse, specular);
 
     // Process each spotlight
     for (int i = 0; i < scene->lights.spotLightCount; i++)
     {
-        float diffuse = computeSpotLightDiffuse(&scene->lights.spotLights[i], point, normal, scene);
-        float specular = computeSpotLightSpecular(&scene->lights.spotLights[i], point, normal, viewDirection, material.shininess, scene);
+        float diffuseLight = computeSpotLightDiffuse(&scene->lights.spotLights[i], point, normal, scene);
+        float specularLight = computeSpotLightSpecular(&scene->lights.spotLights[i], point, normal, viewDirection, material.shininess, scene);
 
         float lightRed = scene->lights.spotLights[i].material.color.r / 255.0f;
         float lightGreen = scene->lights.spotLights[i].material.color.g / 255.0f;
         float lightBlue = scene->lights.spotLights[i].material.color.b / 255.0f;
 
-        diffuseRed += lightRed * diffuse;
-        diffuseGreen += lightGreen * diffuse;
-        diffuseBlue += lightBlue * diffuse;
+        diffuse[0] += lightRed * diffuseLight;
+        diffuse[1] += lightGreen * diffuseLight;
+        diffuse[2] += lightBlue * diffuseLight;
 
-        specularRed += lightRed * specular;
-        specularGreen += lightGreen * specular;
-        specularBlue += lightBlue * specular;
+        specular[0] += lightRed * specularLight;
+        specular[1] += lightGreen * specularLight;
+        specular[2] += lightBlue * specularLight;
     }
 
-    // Clamp diffuse and specular values
-    specularRed = SDL_clamp(specularRed, 0.0f, 1.0f);
-    specularGreen = SDL_clamp(specularGreen, 0.0f, 1.0f);
-    specularBlue = SDL_clamp(specularBlue, 0.0f, 1.0f);
+    return combineSurfaceColor(scene, material, diffuse, specular);
+}
 
-    diffuseRed = SDL_clamp(diffuseRed, 0.0f, 1.0f);
-    diffuseGreen = SDL_clamp(diffuseGreen, 0.0f, 1.0f);
-    diffuseBlue = SDL_clamp(diffuseBlue, 0.0f, 1.0f);
+SDL_Color computeSurfaceColor(Scene *scene, Vector point, Vector normal, Vector viewDirection, Material material)
+{
+    return toSDLColor(computeSurfaceRadiance(scene, point, normal, viewDirection, material), material.color.a);
+}
 
-    // Compute final color, ensuring material color affects diffuse component
-    finalRed = ambientRed + (material.color.r / 255.0f) * diffuseRed + specularRed;
-    finalGreen = ambientGreen + (material.color.g / 255.0f) * diffuseGreen + specularGreen;
-    finalBlue = ambientBlue + (material.color.b / 255.0f) * diffuseBlue + specularBlue;
+// Helper function that raises every lane to the same exponent.
+// Integer exponents (the usual shininess values) use exponentiation by squaring and stay in SIMD registers.
+static FloatLanes powLanes(FloatLanes base, float exponent)
+{
+    int integerExponent = (int)exponent;
+    if (exponent >= 0.0f && exponent <= 65536.0f && (float)integerExponent == exponent)
+    {
+        FloatLanes result = splatLanes(1.0f);
+        while (integerExponent > 0)
+        {
+            if (integerExponent & 1) result = multiplyLanes(result, base);
+            base = multiplyLanes(base, base);
+            integerExponent >>= 1;
+        }
+        return result;
+    }
 
-    // Clamp the final color values before converting to SDL_Color
-    SDL_Color resultColor = {0}; // Initialize the color struct
-    resultColor.a = material.color.a;
-    resultColor.r = (Uint8)SDL_clamp(finalRed * 255.0f, 0, 255);
-    resultColor.g = (Uint8)SDL_clamp(finalGreen * 255.0f, 0, 255);
-    resultColor.b = (Uint8)SDL_clamp(finalBlue * 255.0f, 0, 255);
+    // Fractional exponents fall back to one SDL_powf per lane
+    float values[SIMD_LANES];
+    storeLanes(values, base);
+    for (int i = 0; i < SIMD_LANES; i++)
+    {
+        values[i] = SDL_powf(values[i], exponent);
+    }
+    return loadLanes(values);
+}
 
-    return resultColor;
-}
\ No newline at end of file
+// Helper function that computes the Phong specular term for a batch of normalized light directions
+static FloatLanes specularLanes(VectorLanes normal, VectorLanes lightDirection, VectorLanes viewDirection, FloatLanes intensity, float shininess)
+{
+    FloatLanes zero = splatLanes(0.0f);
+
+    // Compute the reflection vector using the formula: R = 2 * (N . L) * N - L
+    FloatLanes twoNormalDotLight = multiplyLanes(splatLanes(2.0f), dotProductLanes(normal, lightDirection));
+    VectorLanes reflection = {
+        subtractLanes(multiplyLanes(normal.x, twoNormalDotLight), lightDirection.x),
+        subtractLanes(multiplyLanes(normal.y, twoNormalDotLight), lightDirection.y),
+        subtractLanes(multiplyLanes(normal.z, twoNormalDotLight), lightDirection.z)
+    };
+
+    // Only lanes with a positive reflection/view alignment and some light produce a highlight
+    FloatLanes specularFactor = dotProductLanes(reflection, viewDirection);
+    FloatLanes highlight = andLanes(greaterThanLanes(intensity, zero), greaterThanLanes(specularFactor, zero));
+    FloatLanes specular = clampLanes(multiplyLanes(powLanes(specularFactor, shininess), intensity), 0.0f, 1.0f);
+
+    return selectLanes(highlight, specular, zero);
+}
+
+// Helper function that normalizes a batch of vectors, leaving zero-length lanes at zero
+static VectorLanes normalizeLanes(VectorLanes v, FloatLanes* length)
+{
+    FloatLanes zero = splatLanes(0.0f);
+    *length = sqrtLanes(dotProductLanes(v, v));
+    FloatLanes inverseLength = selectLanes(greaterThanLanes(*length, zero), divideLanes(splatLanes(1.0f), *length), zero);
+    return (VectorLanes){multiplyLanes(v.x, inverseLength), multiplyLanes(v.y, inverseLength), multiplyLanes(v.z, inverseLength)};
+}
+
+// Upper bound on how many lights are ordered together before their shadow rays are traced
+#define LIGHT_CANDIDATE_CAPACITY 64
+
+// A light that passed the range, cone and facing tests and still needs a shadow ray
+typedef struct {
+    LightType type;
+    int index;
+    float diffuse[3];   // Unshadowed diffuse light, already tinted by the light color
+    float specular[3];  // Unshadowed specular light, already tinted by the light color
+    float bound;        // Largest amount this light can add to any channel of the final color
+} LightCandidate;
+
+// State shared by the batch kernels while shading one surface point
+typedef struct {
+    Scene* scene;
+    Vector point;
+    VectorLanes pointLanes;
+    VectorLanes normalLanes;
+    VectorLanes viewLanes;
+    float shininess;
+    float materialColor[3];         // Surface color in [0, 1], scales the diffuse term
+    float ambient[3];               // Ambient term of the final color
+    float diffuse[3];               // Running diffuse sum of the lights found visible
+    float specular[3];              // Running specular sum of the lights found visible
+    float pruned[3];                // Upper bound of the light skipped without a shadow ray
+    int pointIndices[SIMD_LANES];   // Point lights waiting to be shaded
+    int pointCount;
+    int spotIndices[SIMD_LANES];    // Spotlights waiting to be shaded
+    int spotCount;
+    LightCandidate candidates[LIGHT_CANDIDATE_CAPACITY];
+    int candidateCount;
+    int saturated;                  // Set once more light can no longer change the clamped color
+    LightContribution* contributions; // When set, lights are stored here with their shadow rays instead of traced
+    int contributionCount;
+    int contributionCapacity;
+} LightBatchContext;
+
+// Helper function that loads values[indices[i]] into lane i, filling unused lanes with 'fill'
+static FloatLanes gatherLanes(const float* values, const int* indices, int count, float fill)
+{
+    float lanes[SIMD_LANES];
+    for (int i = 0; i < SIMD_LANES; i++)
+    {
+        lanes[i] = i < count ? values[indices[i]] : fill;
+    }
+    return loadLanes(lanes);
+}
+
+// Helper function that returns how much a light can still change each channel of the final color.
+// Diffuse and specular are clamped separately, so light beyond a saturated sum is invisible.
+static void visibleContribution(const LightBatchContext* context, const float diffuse[3], const float specular[3], float contribution[3])
+{
+    for (int c = 0; c < 3; c++)
+    {
+        float diffuseHeadroom = SDL_max(1.0f - context->diffuse[c], 0.0f);
+        float specularHeadroom = SDL_max(1.0f - context->specular[c], 0.0f);
+        contribution[c] = context->materialColor[c] * SDL_min(diffuse[c], diffuseHeadroom) + SDL_min(specular[c], specularHeadroom);
+    }
+}
+
+// qsort comparator that puts the brightest candidates first
+static int compareCandidates(const void* a, const void* b)
+{
+    float boundA = ((const LightCandidate*)a)->bound;
+    float boundB = ((const LightCandidate*)b)->bound;
+    return (boundA < boundB) - (boundA > boundB);
+}
+
+// How a candidate compares against the light accumulated so far
+typedef enum {
+    CANDIDATE_DARK,       // Cannot change the clamped color at all
+    CANDIDATE_NEGLIGIBLE, // Stays under the pruning threshold even when fully visible
+    CANDIDATE_TRACE       // Needs a shadow ray
+} CandidateClass;
+
+// Helper function that classifies a candidate against the current sums and 'pruned', storing how much it can
+// still add to each channel in 'contribution'
+static CandidateClass classifyCandidate(const LightBatchContext* context, const float pruned[3], const LightCandidate* candidate, float contribution[3])
+{
+    visibleContribution(context, candidate->diffuse, candidate->specular, contribution);
+    if (contribution[0] <= 0.0f && contribution[1] <= 0.0f && contribution[2] <= 0.0f) return CANDIDATE_DARK;
+
+    // Skip the shadow ray when even full visibility would stay under the pruning threshold
+    for (int c = 0; c < 3; c++)
+    {
+        float accumulated = context->ambient[c] + context->materialColor[c] * SDL_min(context->diffuse[c], 1.0f) + SDL_min(context->specular[c], 1.0f);
+        if (pruned[c] + contribution[c] >= SDL_min(accumulated, 1.0f) / 255.0f) return CANDIDATE_TRACE;
+    }
+    return CANDIDATE_NEGLIGIBLE;
+}
+
+// Helper function that builds a candidate's shadow ray the way isPointInShadow and isPointInShadowSpot do.
+// Returns 0 without a ray when the point lies outside a spotlight's cone, which counts as shadowed.
+static int makeCandidateShadowRay(const LightBatchContext* context, const LightCandidate* candidate, Ray* shadowRay, float* maxDistance, const void** light)
+{
+    Vector position;
+    if (candidate->type == LIGHT_TYPE_POINT)
+    {
+        PointLight* pointLight = &context->scene->lights.pointLights[candidate->index];
+        position = pointLight->position;
+        *light = pointLight;
+    }
+    else
+    {
+        SpotLight* spotLight = &context->scene->lights.spotLights[candidate->index];
+        position = spotLight->position;
+        *light = spotLight;
+    }
+
+    Vector lightDirection = normalizeVector(subtractVectors(position, context->point));
+    if (candidate->type == LIGHT_TYPE_SPOT)
+    {
+        const SpotLight* spotLight = *light;
+        if (dotProduct(spotLight->direction, lightDirection) < SDL_cosf(spotLight->cutoffAngle * SDL_PI_F / 180)) return 0;
+    }
+
+    *shadowRay = makeShadowRay(context->point, lightDirection);
+    *maxDistance = vectorLength(subtractVectors(position, context->point));
+    return 1;
+}
+
+// Traces shadow rays for the queued candidates, brightest first.
+// A candidate is skipped without a shadow ray when it can no longer change the clamped color, or when it
+// (together with everything skipped before it) stays below 1/255 of the color accumulated so far.
+// The rays of each SIMD_LANES chunk are traced together into a visibility mask using the sums from before the
+// chunk; the mask is then applied in order, and a candidate the chunk did not expect to need is traced alone.
+// Stops early once the pixel is saturated and no further light can change it.
+static void resolveLightCandidates(LightBatchContext* context)
+{
+    qsort(context->candidates, context->candidateCount, sizeof(LightCandidate), compareCandidates);
+
+    for (int first = 0; first < context->candidateCount && !context->saturated; first += SIMD_LANES)
+    {
+        LightCandidate* chunk = &context->candidates[first];
+        int count = SDL_min(SIMD_LANES, context->candidateCount - first);
+
+        // Gather the shadow rays of the chunk's candidates that are not pruned
+        Ray rays[SIMD_LANES];
+        float maxDistances[SIMD_LANES];
+        const void* lights[SIMD_LANES];
+        int rayLanes[SIMD_LANES];
+        int rayCount = 0;
+        int traced = 0;
+        int blocked = 0;
+        float pruned[3] = {context->pruned[0], context->pruned[1], context->pruned[2]};
+        for (int i = 0; i < count; i++)
+        {
+            float contribution[3];
+            CandidateClass candidateClass = classifyCandidate(context, pruned, &chunk[i], contribution);
+            if (candidateClass == CANDIDATE_NEGLIGIBLE)
+            {
+                for (int c = 0; c < 3; c++) pruned[c] += contribution[c];
+            }
+            if (candidateClass != CANDIDATE_TRACE) continue;
+
+            traced |= 1 << i;
+            if (!makeCandidateShadowRay(context, &chunk[i], &rays[rayCount], &maxDistances[rayCount], &lights[rayCount]))
+            {
+                blocked |= 1 << i;
+                continue;
+            }
+            rayLanes[rayCount++] = i;
+        }
+
+        int rayBlocked = traceShadowRays(context->scene, lights, rays, maxDistances, rayCount);
+        for (int r = 0; r < rayCount; r++)
+        {
+            if ((rayBlocked >> r) & 1) blocked |= 1 << rayLanes[r];
+        }
+
+        for (int i = 0; i < count && !context->saturated; i++)
+        {
+            LightCandidate* candidate = &chunk[i];
+
+            float contribution[3];
+            CandidateClass candidateClass = classifyCandidate(context, context->pruned, candidate, contribution);
+            if (candidateClass == CANDIDATE_DARK) continue;
+            if (candidateClass == CANDIDATE_NEGLIGIBLE)
+            {
+                for (int c = 0; c < 3; c++) context->pruned[c] += contribution[c];
+                continue;
+            }
+
+            int inShadow;
+            if ((traced >> i) & 1)
+            {
+                inShadow = (blocked >> i) & 1;
+            }
+            else
+            {
+                inShadow = candidate->type == LIGHT_TYPE_POINT
+                    ? isPointInShadow(context->point, &context->scene->lights.pointLights[candidate->index], context->scene)
+                    : isPointInShadowSpot(context->point, &context->scene->lights.spotLights[candidate->index], context->scene);
+            }
+            if (inShadow) continue;
+
+            for (int c = 0; c < 3; c++)
+            {
+                context->diffuse[c] += candidate->diffuse[c];
+                context->specular[c] += candidate->specular[c];
+            }
+
+            // The pixel is saturated once no channel has headroom left
+            float fullLight[3] = {1.0f, 1.0f, 1.0f};
+            float remaining[3];
+            visibleContribution(context, fullLight, fullLight, remaining);
+            context->saturated = remaining[0] <= 0.0f && remaining[1] <= 0.0f && remaining[2] <= 0.0f;
+        }
+    }
+
+    context->candidateCount = 0;
+}
+
+// Helper function that queues the lanes that can still add light as shadow-ray candidates
+static void queueLightCandidates(LightBatchContext* context, LightType type, const int* indices, int count, FloatLanes diffuseLight, FloatLanes specularLight, VectorLanes color)
+{
+    float diffuse[SIMD_LANES], specular[SIMD_LANES];
+    float red[SIMD_LANES], green[SIMD_LANES], blue[SIMD_LANES];
+    storeLanes(diffuse, diffuseLight);
+    storeLanes(specular, specularLight);
+    storeLanes(red, color.x);
+    storeLanes(green, color.y);
+    storeLanes(blue, color.z);
+
+    for (int lane = 0; lane < count && !context->saturated; lane++)
+    {
+        if (diffuse[lane] <= 0.0f && specular[lane] <= 0.0f) continue;
+
+        if (context->contributions != NULL)
+        {
+            // The caller traces the shadow rays itself
+            if (context->contributionCount < context->contributionCapacity)
+            {
+                Vector lightPosition = type == LIGHT_TYPE_POINT
+                    ? context->scene->lights.pointLights[indices[lane]].position
+                    : context->scene->lights.spotLights[indices[lane]].position;
+                Vector toLight = subtractVectors(lightPosition, context->point);
+
+                LightContribution* contribution = &context->contributions[context->contributionCount++];
+                contribution->light = type == LIGHT_TYPE_POINT
+                    ? (const void*)&context->scene->lights.pointLights[indices[lane]]
+                    : (const void*)&context->scene->lights.spotLights[indices[lane]];
+                contribution->lightIndex = type == LIGHT_TYPE_POINT ? indices[lane] : context->scene->lights.pointLightCount + indices[lane];
+                contribution->shadowRay = makeShadowRay(context->point, normalizeVector(toLight));
+                contribution->maxDistance = vectorLength(toLight);
+                contribution->diffuse[0] = red[lane] * diffuse[lane];
+                contribution->diffuse[1] = green[lane] * diffuse[lane];
+                contribution->diffuse[2] = blue[lane] * diffuse[lane];
+                contribution->specular[0] = red[lane] * specular[lane];
+                contribution->specular[1] = green[lane] * specular[lane];
+                contribution->specular[2] = blue[lane] * specular[lane];
+            }
+            continue;
+        }
+
+        if (context->candidateCount == LIGHT_CANDIDATE_CAPACITY)
+        {
+            resolveLightCandidates(context);
+        }
+
+        LightCandidate* candidate = &context->candidates[context->candidateCount++];
+        float lightColor[3] = {red[lane], green[lane], blue[lane]};
+        candidate->type = type;
+        candidate->index = indices[lane];
+        candidate->bound = 0.0f;
+        for (int c = 0; c < 3; c++)
+        {
+            candidate->diffuse[c] = lightColor[c] * diffuse[lane];
+            candidate->specular[c] = lightColor[c] * specular[lane];
+            candidate->bound = SDL_max(candidate->bound, context->materialColor[c] * candidate->diffuse[c] + candidate->specular[c]);
+        }
+    }
+}
+
+// Shades up to SIMD_LANES point lights at once and queues the lanes that would add light
+static void shadePointLightBatch(LightBatchContext* context, const int* indices, int count)
+{
+    PointLightBuffer* lights = &context->scene->lightBuffer->pointLights;
+    FloatLanes zero = splatLanes(0.0f);
+
+    // Vector from the point to each light
+    VectorLanes toLight = {
+        subtractLanes(gatherLanes(lights->positionX, indices, count, 0.0f), context->pointLanes.x),
+        subtractLanes(gatherLanes(lights->positionY, indices, count, 0.0f), context->pointLanes.y),
+        subtractLanes(gatherLanes(lights->positionZ, indices, count, 0.0f), context->pointLanes.z)
+    };
+    FloatLanes distance;
+    VectorLanes lightDirection = normalizeLanes(toLight, &distance);
+
+    // Inverse square attenuation, zero outside the light's range (see computePointLightIntensity)
+    FloatLanes distanceSquared = multiplyLanes(distance, distance);
+    FloatLanes intensity = divideLanes(gatherLanes(lights->intensity, indices, count, 0.0f), addLanes(splatLanes(0.01f), distanceSquared));
+    intensity = clampLanes(intensity, 0.0f, 1.0f);
+    intensity = selectLanes(greaterThanLanes(distance, gatherLanes(lights->range, indices, count, 0.0f)), zero, intensity);
+
+    // Lambert's cosine law
+    FloatLanes normalDotLight = dotProductLanes(context->normalLanes, lightDirection);
+    FloatLanes facing = andLanes(greaterThanLanes(intensity, zero), greaterThanLanes(normalDotLight, zero));
+    FloatLanes diffuseLight = selectLanes(facing, multiplyLanes(clampLanes(normalDotLight, 0.0f, 1.0f), intensity), zero);
+
+    FloatLanes specularLight = specularLanes(context->normalLanes, lightDirection, context->viewLanes, intensity, context->shininess);
+
+    // Shadow rays are traced later, brightest candidates first
+    VectorLanes color = {
+        gatherLanes(lights->red, indices, count, 0.0f),
+        gatherLanes(lights->green, indices, count, 0.0f),
+        gatherLanes(lights->blue, indices, count, 0.0f)
+    };
+    queueLightCandidates(context, LIGHT_TYPE_POINT, indices, count, diffuseLight, specularLight, color);
+}
+
+// Shades up to SIMD_LANES spotlights at once, mirroring computeSpotLightDiffuse/Specular without the shadow ray
+static void shadeSpotLightBatch(LightBatchContext* context, const int* indices, int count)
+{
+    SpotLightBuffer* lights = &context->scene->lightBuffer->spotLights;
+    FloatLanes zero = splatLanes(0.0f);
+
+    VectorLanes toLight = {
+        subtractLanes(gatherLanes(lights->positionX, indices, count, 0.0f), context->pointLanes.x),
+        subtractLanes(gatherLanes(lights->positionY, indices, count, 0.0f), context->pointLanes.y),
+        subtractLanes(gatherLanes(lights->positionZ, indices, count, 0.0f), context->pointLanes.z)
+    };
+    FloatLanes distance;
+    VectorLanes lightDirection = normalizeLanes(toLight, &distance);
+    VectorLanes spotDirection = {
+        gatherLanes(lights->directionX, indices, count, 0.0f),
+        gatherLanes(lights->directionY, indices, count, 0.0f),
+        gatherLanes(lights->directionZ, indices, count, 0.0f)
+    };
+
+    // Smooth falloff between the inner and outer cutoff cones (see computeSpotLightIntensity).
+    // Unused lanes get an impossible cone so they never pass the cutoff test.
+    FloatLanes angleCosine = dotProductLanes(spotDirection, lightDirection);
+    FloatLanes outerCutoffCosine = gatherLanes(lights->outerCutoffCosine, indices, count, 2.0f);
+    FloatLanes innerCutoffCosine = gatherLanes(lights->innerCutoffCosine, indices, count, 2.0f);
+    FloatLanes maxIntensity = gatherLanes(lights->intensity, indices, count, 0.0f);
+    FloatLanes t = clampLanes(divideLanes(subtractLanes(angleCosine, innerCutoffCosine), subtractLanes(outerCutoffCosine, innerCutoffCosine)), 0.0f, 1.0f);
+    FloatLanes intensity = multiplyLanes(subtractLanes(splatLanes(1.0f), t), maxIntensity);
+    intensity = selectLanes(greaterThanLanes(angleCosine, innerCutoffCosine), maxIntensity, intensity);
+    intensity = selectLanes(lessThanLanes(angleCosine, outerCutoffCosine), zero, intensity);
+
+    // Diffuse term uses the spotlight axis, as in computeSpotLightDiffuse
+    FloatLanes normalDotDirection = dotProductLanes(context->normalLanes, spotDirection);
+    FloatLanes facing = andLanes(greaterThanLanes(intensity, zero), greaterThanLanes(normalDotDirection, zero));
+    FloatLanes diffuseLight = selectLanes(facing, multiplyLanes(clampLanes(normalDotDirection, 0.0f, 1.0f), intensity), zero);
+
+    FloatLanes specularLight = specularLanes(context->normalLanes, lightDirection, context->viewLanes, intensity, context->shininess);
+
+    // Shadow rays are traced later, brightest candidates first
+    VectorLanes color = {
+        gatherLanes(lights->red, indices, count, 0.0f),
+        gatherLanes(lights->green, indices, count, 0.0f),
+        gatherLanes(lights->blue, indices, count, 0.0f)
+    };
+    queueLightCandidates(context, LIGHT_TYPE_SPOT, indices, count, diffuseLight, specularLight, color);
+}
+
+// Light BVH visitor: queues the light and shades the batch once SIMD_LANES lights of a type are waiting
+static void queueLightForBatch(LightType type, int index, void* userData)
+{
+    LightBatchContext* context = userData;
+
+    // Nothing can change a saturated pixel
+    if (context->saturated) return;
+
+    if (type == LIGHT_TYPE_POINT)
+    {
+        context->pointIndices[context->pointCount++] = index;
+        if (context->pointCount == SIMD_LANES)
+        {
+            shadePointLightBatch(context, context->pointIndices, context->pointCount);
+            context->pointCount = 0;
+        }
+    }
+    else
+    {
+        context->spotIndices[context->spotCount++] = index;
+        if (context->spotCount == SIMD_LANES)
+        {
+            shadeSpotLightBatch(context, context->spotIndices, context->spotCount);
+            context->spotCount = 0;
+        }
+    }
+}
+
+FloatColor computeSurfaceRadianceBatched(Scene *scene, Vector point, Vector normal, Vector viewDirection, Material material)
+{
+    // Without a light buffer there is nothing to batch over
+    if (scene->lightBuffer == NULL)
+    {
+        return computeSurfaceRadiance(scene, point, normal, viewDirection, material);
+    }
+
+    LightBatchContext context;
+    context.scene = scene;
+    context.point = point;
+    context.pointLanes = splatVectorLanes(point);
+    context.normalLanes = splatVectorLanes(normal);
+    context.viewLanes = splatVectorLanes(viewDirection);
+    context.shininess = material.shininess;
+    context.pointCount = 0;
+    context.spotCount = 0;
+    context.candidateCount = 0;
+    context.saturated = 0;
+    context.contributions = NULL;
+    context.contributionCount = 0;
+    context.contributionCapacity = 0;
+
+    float ambientIntensity = scene->lights.ambientLight.material.intensity;
+    SDL_Color ambientColor = scene->lights.ambientLight.material.color;
+    context.materialColor[0] = material.color.r / 255.0f;
+    context.materialColor[1] = material.color.g / 255.0f;
+    context.materialColor[2] = material.color.b / 255.0f;
+    context.ambient[0] = ambientColor.r / 255.0f * ambientIntensity;
+    context.ambient[1] = ambientColor.g / 255.0f * ambientIntensity;
+    context.ambient[2] = ambientColor.b / 255.0f * ambientIntensity;
+    for (int c = 0; c < 3; c++)
+    {
+        context.diffuse[c] = 0.0f;
+        context.specular[c] = 0.0f;
+        context.pruned[c] = 0.0f;
+    }
+
+    // Directional lights are few, so they keep the scalar path; shading them first gives the pruning test a baseline
+    accumulateDirectionalLights(scene, point, normal, viewDirection, material.shininess, context.diffuse, context.specular);
+
+    if (scene->lightBvhRoot != NULL)
+    {
+        // Only visit the lights whose range sphere or cone contains the point
+        queryLightBVH(scene->lightBvhRoot, point, queueLightForBatch, &context);
+    }
+    else
+    {
+        // No light BVH: walk every light in order
+        for (int i = 0; i < scene->lightBuffer->pointLights.count; i++)
+        {
+            queueLightForBatch(LIGHT_TYPE_POINT, i, &context);
+        }
+        for (int i = 0; i < scene->lightBuffer->spotLights.count; i++)
+        {
+            queueLightForBatch(LIGHT_TYPE_SPOT, i, &context);
+        }
+    }
+
+    // Shade the partially filled batches, then trace the remaining shadow rays
+    if (context.pointCount > 0) shadePointLightBatch(&context, context.pointIndices, context.pointCount);
+    if (context.spotCount > 0) shadeSpotLightBatch(&context, context.spotIndices, context.spotCount);
+    resolveLightCandidates(&context);
+
+    return combineSurfaceColor(scene, material, context.diffuse, context.specular);
+}
+
+SDL_Color computeSurfaceColorBatched(Scene *scene, Vector point, Vector normal, Vector viewDirection, Material material)
+{
+    return toSDLColor(computeSurfaceRadianceBatched(scene, point, normal, viewDirection, material), material.color.a);
+}
+
+int computeLightContributions(Scene *scene, Vector point, Vector normal, Vector viewDirection, float shininess, LightContribution* contributions, int capacity)
+{
+    int count = 0;
+
+    // Directional lights keep the scalar path, as in computeSurfaceRadianceBatched
+    for (int i = 0; i < scene->lights.directionalLightCount && count < capacity; i++)
+    {
+        DirectionalLight* light = &scene->lights.directionalLights[i];
+        float diffuseLight = directionalLightDiffuseUnshadowed(light, normal);
+        float specularLight = directionalLightSpecularUnshadowed(light, normal, viewDirection, shininess);
+        if (diffuseLight <= 0.0f && specularLight <= 0.0f) continue;
+
+        float lightColor[3] = {light->material.color.r / 255.0f, light->material.color.g / 255.0f, light->material.color.b / 255.0f};
+        LightContribution* contribution = &contributions[count++];
+        contribution->light = light;
+        contribution->lightIndex = scene->lights.pointLightCount + scene->lights.spotLightCount + i;
+        contribution->shadowRay = makeShadowRay(point, light->direction);
+        contribution->maxDistance = __FLT_MAX__;
+        for (int c = 0; c < 3; c++)
+        {
+            contribution->diffuse[c] = lightColor[c] * diffuseLight;
+            contribution->specular[c] = lightColor[c] * specularLight;
+        }
+    }
+
+    if (scene->lightBuffer == NULL) return count;
+
+    LightBatchContext context;
+    context.scene = scene;
+    context.point = point;
+    context.pointLanes = splatVectorLanes(point);
+    context.normalLanes = splatVectorLanes(normal);
+    context.viewLanes = splatVectorLanes(viewDirection);
+    context.shininess = shininess;
+    context.pointCount = 0;
+    context.spotCount = 0;
+    context.candidateCount = 0;
+    context.saturated = 0;
+    context.contributions = contributions;
+    context.contributionCount = count;
+    context.contributionCapacity = capacity;
+
+    if (scene->lightBvhRoot != NULL)
+    {
+        queryLightBVH(scene->lightBvhRoot, point, queueLightForBatch, &context);
+    }
+    else
+    {
+        for (int i = 0; i < scene->lightBuffer->pointLights.count; i++)
+        {
+            queueLightForBatch(LIGHT_TYPE_POINT, i, &context);
+        }
+        for (int i = 0; i < scene->lightBuffer->spotLights.count; i++)
+        {
+            queueLightForBatch(LIGHT_TYPE_SPOT, i, &context);
+        }
+    }
+    if (context.pointCount > 0) shadePointLightBatch(&context, context.pointIndices, context.pointCount);
+    if (context.spotCount > 0) shadeSpotLightBatch(&context, context.spotIndices, context.spotCount);
+
+    return context.contributionCount;
+}
+
+FloatColor combineLightContributions(Scene *scene, Material material, const float diffuse[3], const float specular[3])
+{
+    return combineSurfaceColor(scene, material, diffuse, specular);
+}
+
+FloatColor computeSurfaceRadianceSampled(Scene *scene, Vector point, Vector normal, Vector viewDirection, Material material, int lightSamples, Uint32* randomState)
+{
+    // Sampling needs the light tree; without it shade every light
+    if (scene->lightBvhRoot == NULL || lightSamples <= 0)
+    {
+        return computeSurfaceRadianceBatched(scene, point, normal, viewDirection, material);
+    }
+
+    float diffuse[3] = {0.0f, 0.0f, 0.0f};
+    float specular[3] = {0.0f, 0.0f, 0.0f};
+
+    for (int sample = 0; sample < lightSamples; sample++)
+    {
+        LightType type;
+        int index;
+        float probability;
+        if (!sampleLightBVH(scene->lightBvhRoot, &scene->lights, point, randomState, &type, &index, &probability))
+        {
+            continue; // This sample found no light, it contributes zero
+        }
+
+        // One shadow ray per sample decides both terms, and only for a light that contributes
+        float diffuseLight, specularLight;
+        LightMaterial* lightMaterial;
+        if (type == LIGHT_TYPE_POINT)
+        {
+            PointLight* light = &scene->lights.pointLights[index];
+            diffuseLight = pointLightDiffuseUnshadowed(light, point, normal);
+            specularLight = pointLightSpecularUnshadowed(light, point, normal, viewDirection, material.shininess);
+            lightMaterial = &light->material;
+            if (diffuseLight <= 0.0f && specularLight <= 0.0f) continue;
+            if (isPointInShadow(point, light, scene)) continue;
+        }
+        else
+        {
+            SpotLight* light = &scene->lights.spotLights[index];
+            diffuseLight = spotLightDiffuseUnshadowed(light, point, normal);
+            specularLight = spotLightSpecularUnshadowed(light, point, normal, viewDirection, material.shininess);
+            lightMaterial = &light->material;
+            if (diffuseLight <= 0.0f && specularLight <= 0.0f) continue;
+            if (isPointInShadowSpot(point, light, scene)) continue;
+        }
+
+        // Weight by 1 / (samples * probability) so the expected sum equals the full light loop
+        float weight = 1.0f / (lightSamples * probability);
+        float lightRed = lightMaterial->color.r / 255.0f * weight;
+        float lightGreen = lightMaterial->color.g / 255.0f * weight;
+        float lightBlue = lightMaterial->color.b / 255.0f * weight;
+
+        diffuse[0] += lightRed * diffuseLight;
+        diffuse[1] += lightGreen * diffuseLight;
+        diffuse[2] += lightBlue * diffuseLight;
+
+        specular[0] += lightRed * specularLight;
+        specular[1] += lightGreen * specularLight;
+        specular[2] += lightBlue * specularLight;
+    }
+
+    // Directional lights are always shaded exhaustively
+    accumulateDirectionalLights(scene, point, normal, viewDirection, material.shininess, diffuse, specular);
+
+    // Clamping each estimate would darken the average, so the sums stay unclamped until the frame is resolved
+    return combineSurfaceColorUnclamped(scene, material, diffuse, specular);
+}
+
+SDL_Color computeSurfaceColorSampled(Scene *scene, Vector point, Vector normal, Vector viewDirection, Material material, int lightSamples, Uint32* randomState)
+{
+    return toSDLColor(computeSurfaceRadianceSampled(scene, point, normal, viewDirection, material, lightSamples, randomState), material.color.a);
+}
@@ -0,0 +1,395 @@
+#include "job_system.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// A queued function call; jobs live in their submitting worker's pool and are reused once finished
+typedef struct {
+    JobFunction function;          // Plain job, or NULL for a parallel loop range
+    void* data;
+    ParallelForFunction loopBody;  // Range job of parallelFor()
+    int begin;
+    int end;
+    JobCounter* counter;           // Counter told when the job is done, may be NULL
+    SDL_AtomicInt busy;            // Queued or running, so the pool slot cannot be handed out again
+} Job;
+
+// Chase-Lev work-stealing deque over a fixed ring of job pointers. Indices only grow (wrapping around
+// together), so bottom - top is the number of queued jobs.
+typedef struct {
+    void* slots[JOB_DEQUE_CAPACITY];
+    SDL_AtomicInt top;     // Next job a thief takes
+    SDL_AtomicInt bottom;  // Next free slot of the owner
+} JobDeque;
+
+// A thread that runs jobs
+typedef struct {
+    JobSystem* system;
+    int index;
+    SDL_Thread* thread;      // NULL for worker 0, the thread that created the system
+    JobDeque deque;
+    Job jobs[JOB_DEQUE_CAPACITY];
+    Uint32 nextJob;          // Next pool slot to hand out
+    Uint32 randomState;      // Picks the first worker to steal from
+} JobWorker;
+
+struct JobSystem {
+    JobWorker* workers;
+    int workerCount;
+    SDL_AtomicInt queuedJobs;       // Jobs sitting in any deque
+    SDL_AtomicInt sleepingWorkers;  // Workers waiting on wakeCondition
+    SDL_AtomicInt quit;             // Set when the system shuts down
+    SDL_Mutex* sleepMutex;
+    SDL_Condition* wakeCondition;
+};
+
+// Worker the calling thread runs as (of whichever system it belongs to)
+static _Thread_local JobWorker* currentWorker;
+
+// Helper function that pushes a job at the owner's end; returns 0 when the deque is full
+static int pushJob(JobDeque* deque, Job* job)
+{
+    Uint32 bottom = (Uint32)SDL_GetAtomicInt(&deque->bottom);
+    Uint32 top = (Uint32)SDL_GetAtomicInt(&deque->top);
+    if (bottom - top >= JOB_DEQUE_CAPACITY) return 0;
+
+    SDL_SetAtomicPointer(&deque->slots[bottom & (JOB_DEQUE_CAPACITY - 1)], job);
+    SDL_SetAtomicInt(&deque->bottom, (int)(bottom + 1)); // Publishes the slot to thieves
+    return 1;
+}
+
+// Helper function that pops the newest job at the owner's end; returns NULL when the deque is empty
+static Job* popJob(JobDeque* deque)
+{
+    // Claim the bottom slot first, so a thief that reads the new bottom no longer takes it
+    Uint32 bottom = (Uint32)SDL_GetAtomicInt(&deque->bottom) - 1;
+    SDL_SetAtomicInt(&deque->bottom, (int)bottom);
+    Uint32 top = (Uint32)SDL_GetAtomicInt(&deque->top);
+
+    if ((int)(bottom - top) < 0)
+    {
+        SDL_SetAtomicInt(&deque->bottom, (int)top); // Was already empty
+        return NULL;
+    }
+
+    Job* job = SDL_GetAtomicPointer(&deque->slots[bottom & (JOB_DEQUE_CAPACITY - 1)]);
+    if (bottom != top) return job;
+
+    // Last job: race the thieves for it by moving top past it
+    if (!SDL_CompareAndSwapAtomicInt(&deque->top, (int)top, (int)(top + 1)))
+    {
+        job = NULL;
+    }
+    SDL_SetAtomicInt(&deque->bottom, (int)(top + 1));
+    return job;
+}
+
+// Helper function that steals the oldest job of another worker's deque; returns NULL when it is empty
+// or another thread took the job first
+static Job* stealJob(JobDeque* deque)
+{
+    Uint32 top = (Uint32)SDL_GetAtomicInt(&deque->top);
+    Uint32 bottom = (Uint32)SDL_GetAtomicInt(&deque->bottom);
+    if ((int)(bottom - top) <= 0) return NULL;
+
+    Job* job = SDL_GetAtomicPointer(&deque->slots[top & (JOB_DEQUE_CAPACITY - 1)]);
+    if (!SDL_CompareAndSwapAtomicInt(&deque->top, (int)top, (int)(top + 1))) return NULL;
+    return job;
+}
+
+// Helper function that takes a job from the worker's own deque, or else steals one from another worker
+static Job* findJob(JobWorker* worker)
+{
+    JobSystem* system = worker->system;
+    Job* job = popJob(&worker->deque);
+    if (job == NULL && system->workerCount > 1)
+    {
+        // Start at a random victim so thieves spread over the workers
+        worker->randomState = worker->randomState * 1664525u + 1013904223u;
+        int first = (int)((worker->randomState >> 16) % (Uint32)system->workerCount);
+        for (int i = 0; i < system->workerCount && job == NULL; i++)
+        {
+            int victim = (first + i) % system->workerCount;
+            if (victim != worker->index)
+            {
+                job = stealJob(&system->workers[victim].deque);
+            }
+        }
+    }
+
+    if (job != NULL)
+    {
+        SDL_AddAtomicInt(&system->queuedJobs, -1);
+    }
+    return job;
+}
+
+// Helper function that runs a job, tells its counter and frees its pool slot
+static void runJob(Job* job)
+{
+    if (job->function != NULL)
+    {
+        job->function(job->data);
+    }
+    else
+    {
+        job->loopBody(job->begin, job->end, job->data);
+    }
+
+    JobCounter* counter = job->counter;
+    SDL_SetAtomicInt(&job->busy, 0);
+    if (counter != NULL)
+    {
+        SDL_AddAtomicInt(&counter->pending, -1);
+    }
+}
+
+// Helper function that wakes sleeping workers after jobs were queued
+static void wakeWorkers(JobSystem* system, int all)
+{
+    if (SDL_GetAtomicInt(&system->sleepingWorkers) == 0) return;
+
+    SDL_LockMutex(system->sleepMutex);
+    if (all)
+    {
+        SDL_BroadcastCondition(system->wakeCondition);
+    }
+    else
+    {
+        SDL_SignalCondition(system->wakeCondition);
+    }
+    SDL_UnlockMutex(system->sleepMutex);
+}
+
+// Helper function that queues a job on the calling worker; runs it at once when the worker's pool or deque is full.
+// Returns 1 when the job was queued.
+static int queueJob(JobWorker* worker, const Job* request)
+{
+    Job* job = &worker->jobs[worker->nextJob & (JOB_DEQUE_CAPACITY - 1)];
+    if (SDL_GetAtomicInt(&job->busy) == 0)
+    {
+        worker->nextJob++;
+        job->function = request->function;
+        job->data = request->data;
+        job->loopBody = request->loopBody;
+        job->begin = request->begin;
+        job->end = request->end;
+        job->counter = request->counter;
+        SDL_SetAtomicInt(&job->busy, 1);
+
+        // Count the job as queued before thieves can take it, so the count never drops below zero
+        SDL_AddAtomicInt(&worker->system->queuedJobs, 1);
+        if (pushJob(&worker->deque, job)) return 1;
+
+        SDL_AddAtomicInt(&worker->system->queuedJobs, -1);
+        SDL_SetAtomicInt(&job->busy, 0);
+    }
+
+    Job inlineJob = *request;
+    runJob(&inlineJob);
+    return 0;
+}
+
+// Helper function that returns the calling thread's worker if it belongs to the system
+static JobWorker* getSystemWorker(const JobSystem* system)
+{
+    return system != NULL && currentWorker != NULL && currentWorker->system == system ? currentWorker : NULL;
+}
+
+// Helper function that runs jobs on a worker thread until the system shuts down
+static int runWorker(void* data)
+{
+    JobWorker* worker = (JobWorker*)data;
+    JobSystem* system = worker->system;
+    currentWorker = worker;
+
+    int idleRounds = 0;
+    while (!SDL_GetAtomicInt(&system->quit))
+    {
+        Job* job = findJob(worker);
+        if (job != NULL)
+        {
+            runJob(job);
+            idleRounds = 0;
+            continue;
+        }
+
+        if (++idleRounds < JOB_SPIN_ROUNDS)
+        {
+            SDL_CPUPauseInstruction();
+            continue;
+        }
+
+        // Sleep until jobs are queued; the count is checked under the mutex, so a wake-up cannot be missed
+        SDL_LockMutex(system->sleepMutex);
+        SDL_AddAtomicInt(&system->sleepingWorkers, 1);
+        while (SDL_GetAtomicInt(&system->queuedJobs) <= 0 && !SDL_GetAtomicInt(&system->quit))
+        {
+            SDL_WaitCondition(system->wakeCondition, system->sleepMutex);
+        }
+        SDL_AddAtomicInt(&system->sleepingWorkers, -1);
+        SDL_UnlockMutex(system->sleepMutex);
+        idleRounds = 0;
+    }
+    return 0;
+}
+
+JobSystem* createJobSystem(int workerCount)
+{
+    if (workerCount <= 0)
+    {
+        workerCount = SDL_GetNumLogicalCPUCores();
+    }
+    workerCount = SDL_clamp(workerCount, 1, MAX_JOB_WORKERS);
+
+    JobSystem* system = malloc(sizeof(JobSystem));
+    JobWorker* workers = calloc((size_t)workerCount, sizeof(JobWorker));
+    SDL_Mutex* sleepMutex = SDL_CreateMutex();
+    SDL_Condition* wakeCondition = SDL_CreateCondition();
+    if (!system || !workers || !sleepMutex || !wakeCondition)
+    {
+        printf("Error in creating job system: Memory allocation failed!\n");
+        free(system);
+        free(workers);
+        SDL_DestroyMutex(sleepMutex);
+        SDL_DestroyCondition(wakeCondition);
+        return NULL;
+    }
+
+    system->workers = workers;
+    system->workerCount = workerCount;
+    system->sleepMutex = sleepMutex;
+    system->wakeCondition = wakeCondition;
+    SDL_SetAtomicInt(&system->queuedJobs, 0);
+    SDL_SetAtomicInt(&system->sleepingWorkers, 0);
+    SDL_SetAtomicInt(&system->quit, 0);
+
+    for (int i = 0; i < workerCount; i++)
+    {
+        workers[i].system = system;
+        workers[i].index = i;
+        workers[i].randomState = 0x9E3779B9u * (Uint32)(i + 1);
+    }
+    currentWorker = &workers[0];
+
+    for (int i = 1; i < workerCount; i++)
+    {
+        char name[32];
+        SDL_snprintf(name, sizeof(name), "JobWorker%d", i);
+        workers[i].thread = SDL_CreateThread(runWorker, name, &workers[i]);
+        if (workers[i].thread == NULL)
+        {
+            // Run on the threads that did start; the missing workers' deques simply stay empty
+            printf("Error in creating job worker %d: %s\n", i, SDL_GetError());
+        }
+    }
+    return system;
+}
+
+void destroyJobSystem(JobSystem* system)
+{
+    if (system == NULL) return;
+
+    SDL_LockMutex(system->sleepMutex);
+    SDL_SetAtomicInt(&system->quit, 1);
+    SDL_BroadcastCondition(system->wakeCondition);
+    SDL_UnlockMutex(system->sleepMutex);
+
+    for (int i = 1; i < system->workerCount; i++)
+    {
+        SDL_WaitThread(system->workers[i].thread, NULL);
+    }
+    if (currentWorker != NULL && currentWorker->system == system)
+    {
+        currentWorker = NULL;
+    }
+
+    SDL_DestroyCondition(system->wakeCondition);
+    SDL_DestroyMutex(system->sleepMutex);
+    free(system->workers);
+    free(system);
+}
+
+int getJobWorkerCount(const JobSystem* system)
+{
+    return system != NULL ? system->workerCount : 1;
+}
+
+int getCurrentJobWorker(const JobSystem* system)
+{
+    JobWorker* worker = getSystemWorker(system);
+    return worker != NULL ? worker->index : -1;
+}
+
+void initJobCounter(JobCounter* counter)
+{
+    SDL_SetAtomicInt(&counter->pending, 0);
+}
+
+void submitJob(JobSystem* system, JobFunction function, void* data, JobCounter* counter)
+{
+    Job request = {function, data, NULL, 0, 0, counter, {0}};
+    if (counter != NULL)
+    {
+        SDL_AddAtomicInt(&counter->pending, 1);
+    }
+
+    JobWorker* worker = getSystemWorker(system);
+    if (worker == NULL)
+    {
+        runJob(&request);
+        return;
+    }
+    if (queueJob(worker, &request))
+    {
+        wakeWorkers(system, 0);
+    }
+}
+
+void waitForJobs(JobSystem* system, JobCounter* counter)
+{
+    JobWorker* worker = getSystemWorker(system);
+    while (SDL_GetAtomicInt(&counter->pending) > 0)
+    {
+        Job* job = worker != NULL ? findJob(worker) : NULL;
+        if (job != NULL)
+        {
+            runJob(job);
+        }
+        else
+        {
+            // The remaining jobs are running on other workers
+            SDL_CPUPauseInstruction();
+        }
+    }
+}
+
+void parallelFor(JobSystem* system, int count, int grain, ParallelForFunction body, void* data)
+{
+    if (count <= 0) return;
+    grain = SDL_max(grain, 1);
+
+    JobWorker* worker = getSystemWorker(system);
+    if (worker == NULL || system->workerCount == 1 || count <= grain)
+    {
+        body(0, count, data);
+        return;
+    }
+
+    // Grow the ranges so they fill at most half a deque, leaving room for jobs the ranges submit
+    grain = SDL_max(grain, (count + JOB_DEQUE_CAPACITY / 2 - 1) / (JOB_DEQUE_CAPACITY / 2));
+
+    // Queue the ranges in order: thieves take them from the front, the calling thread pops from the back
+    JobCounter counter;
+    initJobCounter(&counter);
+    for (int begin = 0; begin < count; begin += grain)
+    {
+        Job request = {NULL, data, body, begin, SDL_min(begin + grain, count), &counter, {0}};
+        SDL_AddAtomicInt(&counter.pending, 1);
+        if (queueJob(worker, &request) && begin == 0)
+        {
+            wakeWorkers(system, 1); // Sleeping workers start stealing while the rest is queued
+        }
+    }
+    waitForJobs(system, &counter);
+}
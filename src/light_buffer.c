@@ -0,0 +1,139 @@
+#include "light_buffer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// Helper function that rounds a light count up to a whole number of SIMD batches
+static int padToLanes(int count)
+{
+    return (count + SIMD_LANES - 1) / SIMD_LANES * SIMD_LANES;
+}
+
+// Helper function that allocates a zero-filled float array (zero intensity keeps padding lanes dark)
+static float* allocateLaneArray(int paddedCount)
+{
+    return calloc(paddedCount > 0 ? paddedCount : 1, sizeof(float));
+}
+
+LightBuffer* buildLightBuffer(SceneLights* lights)
+{
+    LightBuffer* buffer = malloc(sizeof(LightBuffer));
+    if (!buffer)
+    {
+        printf("Error in creating light buffer: Memory allocation failed!\n");
+        return NULL;
+    }
+
+    // Allocate point light arrays
+    PointLightBuffer* points = &buffer->pointLights;
+    points->count = lights->pointLightCount;
+    points->paddedCount = padToLanes(points->count);
+    points->positionX = allocateLaneArray(points->paddedCount);
+    points->positionY = allocateLaneArray(points->paddedCount);
+    points->positionZ = allocateLaneArray(points->paddedCount);
+    points->range = allocateLaneArray(points->paddedCount);
+    points->intensity = allocateLaneArray(points->paddedCount);
+    points->red = allocateLaneArray(points->paddedCount);
+    points->green = allocateLaneArray(points->paddedCount);
+    points->blue = allocateLaneArray(points->paddedCount);
+
+    // Allocate spotlight arrays
+    SpotLightBuffer* spots = &buffer->spotLights;
+    spots->count = lights->spotLightCount;
+    spots->paddedCount = padToLanes(spots->count);
+    spots->positionX = allocateLaneArray(spots->paddedCount);
+    spots->positionY = allocateLaneArray(spots->paddedCount);
+    spots->positionZ = allocateLaneArray(spots->paddedCount);
+    spots->directionX = allocateLaneArray(spots->paddedCount);
+    spots->directionY = allocateLaneArray(spots->paddedCount);
+    spots->directionZ = allocateLaneArray(spots->paddedCount);
+    spots->outerCutoffCosine = allocateLaneArray(spots->paddedCount);
+    spots->innerCutoffCosine = allocateLaneArray(spots->paddedCount);
+    spots->intensity = allocateLaneArray(spots->paddedCount);
+    spots->red = allocateLaneArray(spots->paddedCount);
+    spots->green = allocateLaneArray(spots->paddedCount);
+    spots->blue = allocateLaneArray(spots->paddedCount);
+
+    if (!points->positionX || !points->positionY || !points->positionZ || !points->range || !points->intensity
+        || !points->red || !points->green || !points->blue
+        || !spots->positionX || !spots->positionY || !spots->positionZ || !spots->directionX || !spots->directionY
+        || !spots->directionZ || !spots->outerCutoffCosine || !spots->innerCutoffCosine || !spots->intensity
+        || !spots->red || !spots->green || !spots->blue)
+    {
+        printf("Error in creating light buffer: Memory allocation failed!\n");
+        freeLightBuffer(buffer);
+        return NULL;
+    }
+
+    // Transpose point lights into the SoA arrays
+    for (int i = 0; i < points->count; i++)
+    {
+        PointLight* light = &lights->pointLights[i];
+        points->positionX[i] = light->position.x;
+        points->positionY[i] = light->position.y;
+        points->positionZ[i] = light->position.z;
+        points->range[i] = light->range;
+        points->intensity[i] = light->material.intensity;
+        points->red[i] = light->material.color.r / 255.0f;
+        points->green[i] = light->material.color.g / 255.0f;
+        points->blue[i] = light->material.color.b / 255.0f;
+    }
+
+    // Transpose spotlights, converting cutoff angles from degrees to cosine space once
+    for (int i = 0; i < spots->count; i++)
+    {
+        SpotLight* light = &lights->spotLights[i];
+        spots->positionX[i] = light->position.x;
+        spots->positionY[i] = light->position.y;
+        spots->positionZ[i] = light->position.z;
+        spots->directionX[i] = light->direction.x;
+        spots->directionY[i] = light->direction.y;
+        spots->directionZ[i] = light->direction.z;
+        spots->outerCutoffCosine[i] = SDL_cosf(light->cutoffAngle * SDL_PI_F / 180.0f);
+        spots->innerCutoffCosine[i] = SDL_cosf(light->innerCutoffAngle * SDL_PI_F / 180.0f);
+        spots->intensity[i] = light->material.intensity;
+        spots->red[i] = light->material.color.r / 255.0f;
+        spots->green[i] = light->material.color.g / 255.0f;
+        spots->blue[i] = light->material.color.b / 255.0f;
+    }
+
+    // Padding spot lanes get an impossible cone so they never pass the cutoff test
+    for (int i = spots->count; i < spots->paddedCount; i++)
+    {
+        spots->outerCutoffCosine[i] = 2.0f;
+        spots->innerCutoffCosine[i] = 2.0f;
+    }
+
+    return buffer;
+}
+
+void freeLightBuffer(LightBuffer* buffer)
+{
+    if (buffer == NULL) {
+        return;
+    }
+
+    free(buffer->pointLights.positionX);
+    free(buffer->pointLights.positionY);
+    free(buffer->pointLights.positionZ);
+    free(buffer->pointLights.range);
+    free(buffer->pointLights.intensity);
+    free(buffer->pointLights.red);
+    free(buffer->pointLights.green);
+    free(buffer->pointLights.blue);
+
+    free(buffer->spotLights.positionX);
+    free(buffer->spotLights.positionY);
+    free(buffer->spotLights.positionZ);
+    free(buffer->spotLights.directionX);
+    free(buffer->spotLights.directionY);
+    free(buffer->spotLights.directionZ);
+    free(buffer->spotLights.outerCutoffCosine);
+    free(buffer->spotLights.innerCutoffCosine);
+    free(buffer->spotLights.intensity);
+    free(buffer->spotLights.red);
+    free(buffer->spotLights.green);
+    free(buffer->spotLights.blue);
+
+    free(buffer);
+}
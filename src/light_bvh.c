@@ -0,0 +1,362 @@
+#include "light_bvh.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// Helper function that returns the center of an AABB
+static Vector boundsCenter(AABB box)
+{
+    return multiplyVector(addVectors(box.min, box.max), 0.5f);
+}
+
+// Helper function that grows box so that it also contains other
+static AABB mergeBounds(AABB box, AABB other)
+{
+    box.min.x = SDL_min(box.min.x, other.min.x);
+    box.min.y = SDL_min(box.min.y, other.min.y);
+    box.min.z = SDL_min(box.min.z, other.min.z);
+
+    box.max.x = SDL_max(box.max.x, other.max.x);
+    box.max.y = SDL_max(box.max.y, other.max.y);
+    box.max.z = SDL_max(box.max.z, other.max.z);
+    return box;
+}
+
+// Helper function that computes the bounding box of a point light's range sphere
+static AABB computePointLightAABB(PointLight* light)
+{
+    Sphere rangeSphere = {light->position, light->range, {{0, 0, 0, 0}, 0, 0}};
+    return computeSphereAABB(&rangeSphere);
+}
+
+// Helper function that computes the bounding box of a spotlight cone of the given length.
+// Points are lit when the direction from the point to the light lies within cutoffAngle of
+// light->direction, so the cone opens along -direction.
+static AABB computeSpotLightAABB(SpotLight* light, float length)
+{
+    float cutoffCosine = SDL_cosf(light->cutoffAngle * SDL_PI_F / 180.0f);
+
+    // Wide cones are bounded by the sphere around the apex
+    if (cutoffCosine <= 0.0f)
+    {
+        Sphere reach = {light->position, length, {{0, 0, 0, 0}, 0, 0}};
+        return computeSphereAABB(&reach);
+    }
+
+    // Otherwise the cone lies in the hull of its apex and the disc closing its far end
+    Vector axis = multiplyVector(light->direction, -1.0f);
+    Vector discCenter = addVectors(light->position, multiplyVector(axis, length));
+    float discRadius = length * SDL_sqrtf(1.0f - cutoffCosine * cutoffCosine) / cutoffCosine;
+
+    Vector extent;
+    extent.x = discRadius * SDL_sqrtf(SDL_max(0.0f, 1.0f - axis.x * axis.x));
+    extent.y = discRadius * SDL_sqrtf(SDL_max(0.0f, 1.0f - axis.y * axis.y));
+    extent.z = discRadius * SDL_sqrtf(SDL_max(0.0f, 1.0f - axis.z * axis.z));
+
+    AABB box = {light->position, light->position};
+    AABB disc = {subtractVectors(discCenter, extent), addVectors(discCenter, extent)};
+    return mergeBounds(box, disc);
+}
+
+// Helper function that returns the distance from a point to the farthest corner of a box
+static float farthestCornerDistance(Vector point, AABB box)
+{
+    float farthest = 0.0f;
+    for (int corner = 0; corner < 8; corner++)
+    {
+        Vector cornerPoint = {
+            (corner & 1) ? box.max.x : box.min.x,
+            (corner & 2) ? box.max.y : box.min.y,
+            (corner & 4) ? box.max.z : box.min.z
+        };
+        farthest = SDL_max(farthest, vectorLength(subtractVectors(cornerPoint, point)));
+    }
+    return farthest;
+}
+
+// Comparison functions for sorting lights along different axes
+static int compareLightX(const void *a, const void *b)
+{
+    float centerA = boundsCenter(((const LightReference *)a)->bounds).x;
+    float centerB = boundsCenter(((const LightReference *)b)->bounds).x;
+    return (centerA > centerB) - (centerA < centerB);
+}
+
+static int compareLightY(const void *a, const void *b)
+{
+    float centerA = boundsCenter(((const LightReference *)a)->bounds).y;
+    float centerB = boundsCenter(((const LightReference *)b)->bounds).y;
+    return (centerA > centerB) - (centerA < centerB);
+}
+
+static int compareLightZ(const void *a, const void *b)
+{
+    float centerA = boundsCenter(((const LightReference *)a)->bounds).z;
+    float centerB = boundsCenter(((const LightReference *)b)->bounds).z;
+    return (centerA > centerB) - (centerA < centerB);
+}
+
+// Helper function that recursively builds the light BVH over lights[0..count)
+static LightBVHNode* buildLightBVHNode(LightReference* lights, int count)
+{
+    LightBVHNode* node = malloc(sizeof(LightBVHNode));
+    if (!node)
+    {
+        printf("Error in creating light BVH: Memory allocation failed!\n");
+        return NULL;
+    }
+
+    // Compute the bounds of all influence volumes, their centers and the light positions
+    node->bounds = lights[0].bounds;
+    node->positionBounds = (AABB){lights[0].position, lights[0].position};
+    node->power = lights[0].power;
+    AABB centerBounds = {boundsCenter(lights[0].bounds), boundsCenter(lights[0].bounds)};
+    for (int i = 1; i < count; i++)
+    {
+        Vector center = boundsCenter(lights[i].bounds);
+        node->bounds = mergeBounds(node->bounds, lights[i].bounds);
+        node->positionBounds = mergeBounds(node->positionBounds, (AABB){lights[i].position, lights[i].position});
+        node->power += lights[i].power;
+        centerBounds = mergeBounds(centerBounds, (AABB){center, center});
+    }
+
+    // Base case: store a few lights in a leaf node
+    if (count <= LIGHT_BVH_LEAF_SIZE)
+    {
+        node->left = NULL;
+        node->right = NULL;
+        node->lights = malloc(sizeof(LightReference) * count);
+        node->lightCount = count;
+        for (int i = 0; i < count && node->lights; i++)
+        {
+            node->lights[i] = lights[i];
+        }
+        return node;
+    }
+
+    // Split at the median along the longest axis of the light centers
+    Vector size = subtractVectors(centerBounds.max, centerBounds.min);
+    if (size.x >= size.y && size.x >= size.z)
+    {
+        qsort(lights, count, sizeof(LightReference), compareLightX);
+    }
+    else if (size.y >= size.z)
+    {
+        qsort(lights, count, sizeof(LightReference), compareLightY);
+    }
+    else
+    {
+        qsort(lights, count, sizeof(LightReference), compareLightZ);
+    }
+
+    int medianIndex = count / 2;
+    node->lights = NULL;
+    node->lightCount = 0;
+    node->left = buildLightBVHNode(lights, medianIndex);
+    node->right = buildLightBVHNode(lights + medianIndex, count - medianIndex);
+
+    return node;
+}
+
+LightBVHNode* buildLightBVH(SceneLights* lights, const AABB* sceneBounds)
+{
+    int count = lights->pointLightCount + lights->spotLightCount;
+    if (count == 0)
+    {
+        return NULL;
+    }
+
+    LightReference* references = malloc(sizeof(LightReference) * count);
+    if (!references)
+    {
+        printf("Error in creating light BVH: Memory allocation failed!\n");
+        return NULL;
+    }
+
+    // Point lights are bounded by their range sphere
+    for (int i = 0; i < lights->pointLightCount; i++)
+    {
+        PointLight* light = &lights->pointLights[i];
+        references[i].type = LIGHT_TYPE_POINT;
+        references[i].index = i;
+        references[i].position = light->position;
+        references[i].direction = (Vector){0, 0, 0};
+        references[i].radius = light->range;
+        references[i].cutoffCosine = -1.0f;
+        references[i].power = light->material.intensity;
+        references[i].bounds = computePointLightAABB(light);
+    }
+
+    // Spotlights reach as far as the farthest corner of the scene (plus a small margin), or everywhere
+    // when there are no scene bounds to cut their cones off at
+    for (int i = 0; i < lights->spotLightCount; i++)
+    {
+        SpotLight* light = &lights->spotLights[i];
+        LightReference* reference = &references[lights->pointLightCount + i];
+        reference->type = LIGHT_TYPE_SPOT;
+        reference->index = i;
+        reference->position = light->position;
+        reference->direction = light->direction;
+        reference->cutoffCosine = SDL_cosf(light->cutoffAngle * SDL_PI_F / 180.0f);
+        reference->power = light->material.intensity;
+        if (sceneBounds != NULL)
+        {
+            reference->radius = farthestCornerDistance(light->position, *sceneBounds) * 1.001f + 0.001f;
+            reference->bounds = computeSpotLightAABB(light, reference->radius);
+        }
+        else
+        {
+            reference->radius = __FLT_MAX__;
+            reference->bounds = (AABB){{-__FLT_MAX__, -__FLT_MAX__, -__FLT_MAX__}, {__FLT_MAX__, __FLT_MAX__, __FLT_MAX__}};
+        }
+    }
+
+    LightBVHNode* root = buildLightBVHNode(references, count);
+    free(references);
+
+    return root;
+}
+
+// Helper function that checks if a point lies inside a box
+static int isPointInAABB(Vector point, AABB box)
+{
+    return point.x >= box.min.x && point.x <= box.max.x &&
+           point.y >= box.min.y && point.y <= box.max.y &&
+           point.z >= box.min.z && point.z <= box.max.z;
+}
+
+// Helper function that checks if a point lies inside a light's influence volume
+static int isPointInLightVolume(LightReference* light, Vector point)
+{
+    Vector toLight = subtractVectors(light->position, point);
+    float distanceSquared = dotProduct(toLight, toLight);
+
+    if (distanceSquared > light->radius * light->radius) return 0;
+    if (light->type == LIGHT_TYPE_POINT || distanceSquared == 0.0f) return 1;
+
+    // Same cone test as computeSpotLightIntensity, written without the normalization
+    float alignment = dotProduct(light->direction, toLight);
+    return alignment >= light->cutoffCosine * SDL_sqrtf(distanceSquared);
+}
+
+void queryLightBVH(LightBVHNode* node, Vector point, LightVisitor visit, void* userData)
+{
+    if (node == NULL || !isPointInAABB(point, node->bounds))
+    {
+        return;
+    }
+
+    // Leaf node: run the exact sphere/cone test on every light
+    if (node->left == NULL && node->right == NULL)
+    {
+        for (int i = 0; i < node->lightCount; i++)
+        {
+            if (isPointInLightVolume(&node->lights[i], point))
+            {
+                visit(node->lights[i].type, node->lights[i].index, userData);
+            }
+        }
+        return;
+    }
+
+    queryLightBVH(node->left, point, visit, userData);
+    queryLightBVH(node->right, point, visit, userData);
+}
+
+// Helper function that estimates how much a subtree can contribute at a point.
+// The estimate is zero only when no light below the node can reach the point.
+static float estimateNodeImportance(LightBVHNode* node, Vector point)
+{
+    if (node == NULL || !isPointInAABB(point, node->bounds)) return 0.0f;
+
+    // Distance from the point to the closest light position in the node, same falloff as the point lights
+    Vector closest = {
+        SDL_clamp(point.x, node->positionBounds.min.x, node->positionBounds.max.x),
+        SDL_clamp(point.y, node->positionBounds.min.y, node->positionBounds.max.y),
+        SDL_clamp(point.z, node->positionBounds.min.z, node->positionBounds.max.z)
+    };
+    Vector offset = subtractVectors(closest, point);
+
+    return node->power / (0.01f + dotProduct(offset, offset));
+}
+
+// Helper function that computes the exact unshadowed intensity of a single light at a point
+static float estimateLightContribution(LightReference* light, SceneLights* lights, Vector point)
+{
+    if (!isPointInLightVolume(light, point)) return 0.0f;
+
+    if (light->type == LIGHT_TYPE_POINT)
+    {
+        return computePointLightIntensity(&lights->pointLights[light->index], point);
+    }
+
+    // The normal is not used by the spotlight falloff
+    return computeSpotLightIntensity(&lights->spotLights[light->index], point, (Vector){0, 0, 0});
+}
+
+int sampleLightBVH(LightBVHNode* root, SceneLights* lights, Vector point, Uint32* randomState, LightType* type, int* index, float* probability)
+{
+    LightBVHNode* node = root;
+    float pathProbability = 1.0f;
+
+    if (estimateNodeImportance(node, point) <= 0.0f) return 0;
+
+    // Descend, picking each child in proportion to its estimated importance
+    while (node->left != NULL || node->right != NULL)
+    {
+        float leftImportance = estimateNodeImportance(node->left, point);
+        float rightImportance = estimateNodeImportance(node->right, point);
+        float totalImportance = leftImportance + rightImportance;
+        if (totalImportance <= 0.0f) return 0;
+
+        float leftProbability = leftImportance / totalImportance;
+        if (randomFloat(randomState) < leftProbability)
+        {
+            node = node->left;
+            pathProbability *= leftProbability;
+        }
+        else
+        {
+            node = node->right;
+            pathProbability *= 1.0f - leftProbability;
+        }
+    }
+
+    // In the leaf, pick a light in proportion to its exact contribution
+    float weights[LIGHT_BVH_LEAF_SIZE];
+    float totalWeight = 0.0f;
+    for (int i = 0; i < node->lightCount; i++)
+    {
+        weights[i] = estimateLightContribution(&node->lights[i], lights, point);
+        totalWeight += weights[i];
+    }
+    if (totalWeight <= 0.0f) return 0;
+
+    float target = randomFloat(randomState) * totalWeight;
+    int chosen = 0;
+    while (chosen < node->lightCount - 1 && (target >= weights[chosen] || weights[chosen] <= 0.0f))
+    {
+        target -= weights[chosen];
+        chosen++;
+    }
+    if (weights[chosen] <= 0.0f) return 0;
+
+    *type = node->lights[chosen].type;
+    *index = node->lights[chosen].index;
+    *probability = pathProbability * weights[chosen] / totalWeight;
+    return 1;
+}
+
+void freeLightBVH(LightBVHNode* node)
+{
+    if (node == NULL) {
+        return;
+    }
+
+    // Recursively free left and right child nodes
+    freeLightBVH(node->left);
+    freeLightBVH(node->right);
+
+    free(node->lights);
+    free(node);
+}
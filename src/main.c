@@ -4,22 +4,177 @@
 
 #include "render_functions.h"
 #include "illumination.h"
+#include "frame_governor.h"
+#include "frame_exchange.h"
+#include "scene_store.h"
 
 #include <stdlib.h>
 
 #define WINDOW_WIDTH 1280
 #define WINDOW_HEIGHT 720
 
+#define STOCHASTIC_LIGHT_SAMPLES 4 // Lights sampled per shading point when stochastic mode is on
+
+#define GOVERNOR_MIN_SCALE 0.25f // Smallest fraction of the window size the governor renders at
+
+#define REFLECTION_BOUNCES 3 // Mirror reflections followed per pixel while reflections are on (B key)
+
+#define LIGHT_ORBIT_STEP 15.0f // Degrees the L key moves the first point light around the vertical axis
+
+/* Render requests the event thread hands to the render thread next to the camera and settings */
+#define REQUEST_RESTART 1          /* The view or the shading mode changed: restartRendering() */
+#define REQUEST_DISCARD_HISTORY 2  /* The previous frame was shaded another way and cannot be reused */
+#define REQUEST_RESET_TIMING 4     /* Time the current tile order from scratch */
+#define REQUEST_CYCLE_GOVERNOR 8   /* Step the frame time target: 33 ms -> 16 ms -> off (full resolution) -> 33 ms */
+
+#define RENDER_IDLE_WAIT_MS 100 /* Longest sleep of the render thread once the image has converged */
+
 /* We will use this renderer to draw into this window every frame. */
 static SDL_Window *window = NULL;
 static SDL_Renderer *renderer = NULL;
-
-static SDL_Surface* surface = NULL;
-static Uint32* pixels = NULL;
+static SDL_Texture *texture = NULL;
 static const SDL_PixelFormatDetails *formatDetails;
 
+/* Owned by the main thread, which handles events and presents frames */
 static Camera camera;
-static Scene scene;
+static RenderSettings settings = {1, 0, TILE_ORDER_COST, {1.0f, TONE_MAP_CLAMP, 0, 1}, 8, 0.1f, 16.0f, MOTION_REPROJECT, REFLECTION_BOUNCES, 0, DEFAULT_RAY_SORT_BATCH, 1};
+static const RenderedFrame* shownFrame = NULL;
+static Uint64 uploadedFrameNumber = 0;
+static Vector orbitingLightPosition; /* Where the L key has sent the first point light so far */
+static int hasOrbitingLight = 0;
+
+/* Versions of the scene: edits from any thread are queued, the render thread publishes them between frames */
+static SceneStore sceneStore;
+
+/* Owned by the render thread once it runs */
+static Camera renderCamera;
+static RenderSettings renderSettings;
+static RenderState renderState;
+static JobSystem* jobs = NULL;
+static FrameGovernor governor;
+
+/* Handed from the main thread to the render thread, which picks them up at the start of every frame */
+static SDL_SpinLock viewLock = 0;
+static Camera pendingCamera;
+static RenderSettings pendingSettings;
+static int pendingRequests = 0; /* REQUEST_* flags */
+
+static FrameExchange frames;
+static SDL_Thread* renderThread = NULL;
+static SDL_Semaphore* renderWake = NULL; /* Signaled on input, so a converged render thread starts again */
+static SDL_AtomicInt quitRendering;
+
+/* Hands the camera, the settings and the given requests to the render thread; the next frame starts with all of them */
+static void postViewUpdate(int requests)
+{
+    SDL_LockSpinlock(&viewLock);
+    pendingCamera = camera;
+    pendingSettings = settings;
+    pendingRequests |= requests;
+    SDL_UnlockSpinlock(&viewLock);
+    SDL_SignalSemaphore(renderWake);
+}
+
+/* Render thread: steps the frame time target and resizes the render buffers to match */
+static void cycleFrameGovernor(void)
+{
+    if (!governor.enabled) {
+        initFrameGovernor(&governor, 33.0f, GOVERNOR_MIN_SCALE, governor.maxSamplesPerPixel);
+        SDL_Log("Frame governor: %.0f ms target", governor.targetMilliseconds);
+    } else if (governor.targetMilliseconds > 20.0f) {
+        governor.targetMilliseconds = 16.0f;
+        SDL_Log("Frame governor: %.0f ms target", governor.targetMilliseconds);
+    } else {
+        governor.enabled = 0;
+        renderSettings.maxSamplesPerPixel = governor.maxSamplesPerPixel;
+        SDL_Log("Frame governor: off");
+    }
+    int width, height;
+    getGovernedResolution(&governor, WINDOW_WIDTH, WINDOW_HEIGHT, &width, &height);
+    setRenderResolution(&renderState, width, height);
+}
+
+/* Render thread: takes over everything the main thread posted since the last frame in one step, so a frame never mixes two views */
+static void applyViewUpdates(void)
+{
+    int governedSamples = renderSettings.maxSamplesPerPixel;
+
+    SDL_LockSpinlock(&viewLock);
+    renderCamera = pendingCamera;
+    renderSettings = pendingSettings;
+    int requests = pendingRequests;
+    pendingRequests = 0;
+    SDL_UnlockSpinlock(&viewLock);
+
+    /* The governor owns the sample count while it runs */
+    if (governor.enabled) {
+        renderSettings.maxSamplesPerPixel = governedSamples;
+    }
+    if (requests & REQUEST_DISCARD_HISTORY) {
+        renderState.historyValid = 0;
+    }
+    if (requests & REQUEST_RESET_TIMING) {
+        renderState.timedFrames = 0;
+        renderState.timedMilliseconds = 0.0;
+    }
+
+    if (requests & REQUEST_CYCLE_GOVERNOR) {
+        cycleFrameGovernor();
+    }
+    if (requests & REQUEST_RESTART) {
+        restartRendering(&renderState);
+    }
+}
+
+/* Render thread: renders frames into the frame exchange until the program quits, independent of event handling and presentation */
+static int renderThreadMain(void *data)
+{
+    initRenderState(&renderState, WINDOW_WIDTH, WINDOW_HEIGHT, &renderSettings);
+
+    /* Render the tiles on every core; the job system is created here because its first worker is the thread that renders */
+    jobs = createJobSystem(0);
+    if (jobs != NULL && setRenderJobSystem(&renderState, jobs)) {
+        SDL_Log("Rendering on %d threads", getJobWorkerCount(jobs));
+    }
+
+    /* Aim for 30 frames per second; G switches between 33 ms, 16 ms and full resolution */
+    initFrameGovernor(&governor, 33.0f, GOVERNOR_MIN_SCALE, renderSettings.maxSamplesPerPixel);
+
+    while (!SDL_GetAtomicInt(&quitRendering)) {
+        applyViewUpdates();
+
+        /* Publish the queued scene edits, then trace whichever version is current for the whole frame */
+        commitSceneEdits(&sceneStore);
+        SceneVersion* version = acquireSceneVersion(&sceneStore);
+
+        RenderedFrame* frame = getFrameToRender(&frames);
+        int traced = renderFrame(&renderState, &renderCamera, &version->scene, &renderSettings, frame->pixels, frames.pixelsPerRow, formatDetails);
+        releaseSceneVersion(version);
+        if (!traced) {
+            /* Converged: nothing changes until the next input */
+            SDL_WaitSemaphoreTimeout(renderWake, RENDER_IDLE_WAIT_MS);
+            continue;
+        }
+        frame->width = renderState.width;
+        frame->height = renderState.height;
+        frame->stats = renderState.stats;
+        frame->renderMilliseconds = renderState.lastFrameMilliseconds;
+        frame->timedFrames = renderState.timedFrames;
+        frame->timedMilliseconds = renderState.timedMilliseconds;
+        publishFrame(&frames);
+
+        /* Pick the resolution of the next frame from the render time of complete frames (previews are cheaper) */
+        if (renderState.stats.spacing == 1 && updateFrameGovernor(&governor, renderState.lastFrameMilliseconds, &renderSettings)) {
+            int width, height;
+            getGovernedResolution(&governor, WINDOW_WIDTH, WINDOW_HEIGHT, &width, &height);
+            setRenderResolution(&renderState, width, height);
+        }
+    }
+
+    freeRenderState(&renderState);
+    destroyJobSystem(jobs);
+    return 0;
+}
 
 /* This function runs once at startup. */
 SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[])
@@ -36,13 +191,37 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[])
         return SDL_APP_FAILURE;
     }
 
-    surface = SDL_CreateSurface(WINDOW_WIDTH, WINDOW_HEIGHT,SDL_PIXELFORMAT_RGBA32);
-    SDL_LockSurface(surface);
-    pixels = (Uint32*)surface->pixels;
-    formatDetails = SDL_GetPixelFormatDetails(surface->format);
-    SDL_UnlockSurface(surface);
+    /* Present at the display's pace; the render thread delivers frames at its own */
+    SDL_SetRenderVSync(renderer, 1);
+    texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STREAMING, WINDOW_WIDTH, WINDOW_HEIGHT);
+    if (texture == NULL) {
+        SDL_Log("Couldn't create texture: %s", SDL_GetError());
+        return SDL_APP_FAILURE;
+    }
+    SDL_SetTextureScaleMode(texture, SDL_SCALEMODE_LINEAR);
+    formatDetails = SDL_GetPixelFormatDetails(SDL_PIXELFORMAT_RGBA32);
 
+    Scene scene;
     initialize_scene(WINDOW_WIDTH, WINDOW_HEIGHT, &camera, &scene);
+    if (scene.lights.pointLightCount > 0) {
+        orbitingLightPosition = scene.lights.pointLights[0].position;
+        hasOrbitingLight = 1;
+    }
+    if (!initSceneStore(&sceneStore, &scene)) {
+        return SDL_APP_FAILURE;
+    }
+    renderCamera = pendingCamera = camera;
+    renderSettings = pendingSettings = settings;
+
+    renderWake = SDL_CreateSemaphore(0);
+    if (renderWake == NULL || !initFrameExchange(&frames, WINDOW_WIDTH, WINDOW_HEIGHT)) {
+        return SDL_APP_FAILURE;
+    }
+    renderThread = SDL_CreateThread(renderThreadMain, "render", NULL);
+    if (renderThread == NULL) {
+        SDL_Log("Couldn't create render thread: %s", SDL_GetError());
+        return SDL_APP_FAILURE;
+    }
 
     return SDL_APP_CONTINUE;  /* carry on with the program! */
 }
@@ -55,6 +234,7 @@ SDL_AppResult SDL_AppEvent(void *appstate, SDL_Event *event)
     }
 
     if (event->type == SDL_EVENT_KEY_DOWN) {
+        int requests = REQUEST_RESTART;
         switch (event->key.key) { 
             case SDLK_W:
                 /* Move forward */
@@ -90,9 +270,76 @@ SDL_AppResult SDL_AppEvent(void *appstate, SDL_Event *event)
             case SDLK_P:
                 rotateCameraDown(&camera);
                 break;
+            case SDLK_M:
+                /* Toggle stochastic many-light sampling */
+                settings.lightSamples = settings.lightSamples ? 0 : STOCHASTIC_LIGHT_SAMPLES;
+                requests |= REQUEST_DISCARD_HISTORY;
+                break;
+            case SDLK_L:
+                /* Orbit the first point light around the vertical axis; only the shading has to be redone */
+                if (hasOrbitingLight) {
+                    Vector position = orbitingLightPosition;
+                    float angle = LIGHT_ORBIT_STEP * (SDL_PI_F / 180.0f);
+                    orbitingLightPosition = (Vector){position.x * SDL_cosf(angle) - position.z * SDL_sinf(angle), position.y,
+                                                     position.x * SDL_sinf(angle) + position.z * SDL_cosf(angle)};
+                    SceneEdit edit = {SCENE_EDIT_MOVE_POINT_LIGHT, .movePointLight = {0, orbitingLightPosition}};
+                    queueSceneEdit(&sceneStore, &edit);
+                }
+                requests = 0;
+                break;
+            case SDLK_B:
+                /* Toggle mirror reflections */
+                settings.maxBounces = settings.maxBounces ? 0 : REFLECTION_BOUNCES;
+                requests |= REQUEST_DISCARD_HISTORY;
+                SDL_Log("Reflections: %s", settings.maxBounces ? "on" : "off");
+                break;
+            case SDLK_K:
+                /* Toggle wavefront tracing; the image stays the same, so only the timing starts over */
+                settings.wavefront = !settings.wavefront;
+                SDL_Log("Wavefront tracing: %s", settings.wavefront ? "on" : "off");
+                requests = REQUEST_RESET_TIMING;
+                break;
+            case SDLK_V:
+                /* Cycle how frames are rendered while the camera moves */
+                settings.motionMode = (MotionMode)((settings.motionMode + 1) % MOTION_MODE_COUNT);
+                SDL_Log("Motion rendering: %s", getMotionModeName(settings.motionMode));
+                break;
+            case SDLK_T:
+                /* Report the current tile order's frame time from the frame on screen, then switch to the next order */
+                if (shownFrame != NULL) {
+                    const RenderStats* stats = &shownFrame->stats;
+                    if (shownFrame->timedFrames > 0) {
+                        SDL_Log("%s tile order: %.2f ms per frame over %d frames", getTileOrderName(settings.tileOrder),
+                                shownFrame->timedMilliseconds / shownFrame->timedFrames, (int)shownFrame->timedFrames);
+                    }
+                    SDL_Log("Last frame: %d primary rays, %d extra rays over %d edge pixels, %d reprojected pixels", (int)stats->primaryRays,
+                            (int)stats->extraRays, (int)stats->refinedPixels, (int)stats->reusedPixels);
+                    if (stats->shadowRays > 0) {
+                        SDL_Log("  shadow rays: %d, %.1f%% answered by the occluder cache", (int)stats->shadowRays,
+                                100.0 * stats->shadowCacheHits / stats->shadowRays);
+                    }
+                    if (stats->shadowPackets > 0) {
+                        SDL_Log("  shadow packets: %d, %.2f rays per packet", (int)stats->shadowPackets,
+                                (double)stats->shadowRays / stats->shadowPackets);
+                    }
+                    SDL_Log("  scratch memory: %d KB per worker at most", (int)((stats->scratchBytes + 1023) / 1024));
+                    for (int bounces = 0; bounces <= settings.maxBounces && bounces <= MAX_REFLECTION_BOUNCES; bounces++) {
+                        SDL_Log("  paths with %d reflections: %d", bounces, (int)stats->bounceHistogram[bounces]);
+                    }
+                }
+                settings.tileOrder = (TileOrder)((settings.tileOrder + 1) % TILE_ORDER_COUNT);
+                SDL_Log("Switched to %s tile order", getTileOrderName(settings.tileOrder));
+                break;
+            case SDLK_G:
+                /* Cycle the frame time target: 33 ms -> 16 ms -> off (full resolution) -> 33 ms */
+                requests |= REQUEST_CYCLE_GOVERNOR;
+                break;
             default:
                 break;
         }
+
+        /* The view or the shading mode may have changed: the next frame renders as the motion mode says, then refines and accumulates again */
+        postViewUpdate(requests);
     }
 
     return SDL_APP_CONTINUE;  /* Carry on with the program! */
@@ -104,25 +351,19 @@ SDL_AppResult SDL_AppIterate(void *appstate)
     SDL_SetRenderDrawColor(renderer, 0, 0, 0, SDL_ALPHA_OPAQUE);  /* black, full alpha */
     SDL_RenderClear(renderer);  /* start with a blank canvas. */
 
-    SDL_LockSurface(surface);
-
-    int x, y;
-    SDL_Color pixelColor;
-    for(x = 0; x< WINDOW_WIDTH;x++)
-    {
-        for(y = 0; y< WINDOW_HEIGHT;y++)
-        {
-            pixelColor = computePixelColor(WINDOW_WIDTH, WINDOW_HEIGHT, x, y, &camera, &scene);
-            pixels[y * WINDOW_WIDTH + x] = SDL_MapRGBA(formatDetails, NULL, pixelColor.r, pixelColor.g, pixelColor.b, pixelColor.a); 
+    /* Show the newest frame the render thread finished; until the next one arrives the last one stays up */
+    shownFrame = acquireLatestFrame(&frames);
+    if (shownFrame != NULL) {
+        if (shownFrame->frameNumber != uploadedFrameNumber) {
+            SDL_Rect area = {0, 0, shownFrame->width, shownFrame->height};
+            SDL_UpdateTexture(texture, &area, shownFrame->pixels, frames.pixelsPerRow * (int)sizeof(Uint32));
+            uploadedFrameNumber = shownFrame->frameNumber;
         }
-    }
 
-    SDL_UnlockSurface(surface);
-
-    SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
-    SDL_RenderTexture(renderer, texture, NULL, NULL);
-
-    SDL_DestroyTexture(texture);
+        /* Stretch the rendered area over the whole window with bilinear filtering */
+        SDL_FRect renderedArea = {0.0f, 0.0f, (float)shownFrame->width, (float)shownFrame->height};
+        SDL_RenderTexture(renderer, texture, &renderedArea, NULL);
+    }
 
     SDL_RenderPresent(renderer);  /* put it all on the screen! */
 
@@ -132,7 +373,16 @@ SDL_AppResult SDL_AppIterate(void *appstate)
 /* This function runs once at shutdown. */
 void SDL_AppQuit(void *appstate, SDL_AppResult result)
 {
+    /* Let the render thread finish its frame and free what it owns */
+    if (renderThread != NULL) {
+        SDL_SetAtomicInt(&quitRendering, 1);
+        SDL_SignalSemaphore(renderWake);
+        SDL_WaitThread(renderThread, NULL);
+    }
+    SDL_DestroySemaphore(renderWake);
+    freeFrameExchange(&frames);
+    freeSceneStore(&sceneStore);
+
     /* SDL will clean up the window/renderer for us. */
-    SDL_DestroySurface(surface);
+    SDL_DestroyTexture(texture);
 }
-
@@ -1,4 +1,8 @@
 #include "render_functions.h"
+#include "wavefront.h"
+
+#include <float.h>
+#include <stdio.h>
 
 // Initializes the scene with default objects and lighting.
 void initialize_scene(int WINDOW_WIDTH, int WINDOW_HEIGHT, Camera* camera, Scene* scene)
@@ -46,24 +50,954 @@ void initialize_scene(int WINDOW_WIDTH, int WINDOW_HEIGHT, Camera* camera, Scene
     addTriangle(scene, p1, p2, p3, triangleMaterial);
 
     scene->bvhRoot = buildBVH(&scene->objects);
+
+    // Build the SoA light buffer and the light BVH used by the batched shading path.
+    updateSceneLightStructures(scene);
+}
+
+// Paths of the calling thread by the number of reflection rays they traced
+static _Thread_local Uint64 bounceHistogram[MAX_REFLECTION_BOUNCES + 1];
+
+// Helper function that computes the light a surface point sends along -viewDirection, without reflections
+static FloatColor shadeSurface(Vector point, Vector normal, Vector viewDirection, Material material, Scene* scene, RenderSettings* settings, Uint32* randomState)
+{
+    if (settings->lightSamples > 0)
+    {
+        // Stochastic mode: a few lights picked by importance, converged by accumulating frames.
+        return computeSurfaceRadianceSampled(scene, point, normal, viewDirection, material, settings->lightSamples, randomState);
+    }
+
+    return computeSurfaceRadianceBatched(scene, point, normal, viewDirection, material);
 }
 
-// Computes the color of a pixel by tracing a ray from the camera through the scene.
-SDL_Color computePixelColor(int WINDOW_WIDTH, int WINDOW_HEIGHT, int x, int y, Camera* camera, Scene* scene)
+// Helper function that shades a primary hit seen along viewDirection, following its mirror reflections
+// in a loop; misses show the black background.
+// Each reflection adds the next surface's light weighted by the product of the reflectivities so far (the
+// throughput). A path ends after settings->maxBounces reflections, when the throughput drops below
+// MIN_PATH_THROUGHPUT, or by Russian roulette after RUSSIAN_ROULETTE_DEPTH reflections.
+static FloatColor shadePixelHit(const PixelHit* hit, Vector viewDirection, Scene* scene, RenderSettings* settings, Uint32 randomSeed)
+{
+    if (hit->object == NULL)
+    {
+        return (FloatColor){0.0f, 0.0f, 0.0f};
+    }
+
+    Uint32 randomState = randomSeed;
+    FloatColor color = shadeSurface(hit->position, hit->normal, viewDirection, hit->material, scene, settings, &randomState);
+
+    Vector point = hit->position;
+    Vector normal = hit->normal;
+    Vector direction = viewDirection;
+    float throughput = hit->material.reflectivity;
+    int maxBounces = SDL_min(settings->maxBounces, MAX_REFLECTION_BOUNCES);
+    int bounces = 0;
+
+    while (bounces < maxBounces && throughput >= MIN_PATH_THROUGHPUT)
+    {
+        if (bounces >= RUSSIAN_ROULETTE_DEPTH)
+        {
+            // Continue with probability equal to the throughput and compensate the survivors
+            float survival = SDL_min(throughput, 1.0f);
+            if (randomFloat(&randomState) >= survival) break;
+            throughput /= survival;
+        }
+
+        // Mirror the incoming direction around the normal; the start is nudged off the surface
+        direction = subtractVectors(direction, multiplyVector(normal, 2.0f * dotProduct(direction, normal)));
+        Ray reflectedRay = {addVectors(point, multiplyVector(direction, REFLECTION_RAY_OFFSET)), direction};
+        bounces++;
+
+        ObjectIntersection next;
+        if (scene->bvhRoot == NULL || !intersectBVH(reflectedRay, scene->bvhRoot, &next)) break;
+
+        FloatColor reflected = shadeSurface(next.point, next.normal, direction, next.material, scene, settings, &randomState);
+        color.r += throughput * reflected.r;
+        color.g += throughput * reflected.g;
+        color.b += throughput * reflected.b;
+
+        throughput *= next.material.reflectivity;
+        point = next.point;
+        normal = next.normal;
+    }
+
+    countPathBounces(bounces);
+    return color;
+}
+
+void getBounceHistogram(Uint64 histogram[MAX_REFLECTION_BOUNCES + 1])
+{
+    SDL_memcpy(histogram, bounceHistogram, sizeof(bounceHistogram));
+}
+
+void resetBounceHistogram(void)
+{
+    SDL_memset(bounceHistogram, 0, sizeof(bounceHistogram));
+}
+
+void countPathBounces(int bounces)
+{
+    bounceHistogram[bounces]++;
+}
+
+// Helper function that computes the color seen along a primary ray that can only hit objects below the given BVH nodes
+static FloatColor computePixelColorInNodes(Ray viewRay, BVHNode* const* nodes, int nodeCount, Scene* scene, RenderSettings* settings, Uint32 randomSeed, PixelHit* pixelHit)
 {
-    Ray viewRay;
-    SDL_Color pixelColor;
     ObjectIntersection closestIntersection;
+    closestIntersection.objectType = -1;
+    closestIntersection.object = NULL;
     closestIntersection.material = (Material){{0, 0, 0, 0}, 0, 0};
 
-    // Map the pixel coordinates to a ray.
-    viewRay = mapPixelToRay(camera, x, y, WINDOW_WIDTH, WINDOW_HEIGHT);
-
     // Find the closest intersection of the ray with objects in the scene.
-    intersectBVH(viewRay, scene->bvhRoot, &closestIntersection);
+    int hit = intersectBVHNodes(viewRay, nodes, nodeCount, &closestIntersection) && closestIntersection.objectType >= 0;
+
+    PixelHit localHit;
+    if (pixelHit == NULL) pixelHit = &localHit;
+    if (hit)
+    {
+        *pixelHit = (PixelHit){closestIntersection.object, closestIntersection.point, closestIntersection.normal, closestIntersection.material};
+    }
+    else
+    {
+        // The background is treated as a surface far along the ray, so it reprojects like one
+        *pixelHit = (PixelHit){NULL, addVectors(viewRay.origin, multiplyVector(viewRay.direction, BACKGROUND_DISTANCE)), {0.0f, 0.0f, 0.0f}, closestIntersection.material};
+    }
+
+    return shadePixelHit(pixelHit, viewRay.direction, scene, settings, randomSeed);
+}
+
+FloatColor computePixelColor(Ray viewRay, Scene* scene, RenderSettings* settings, Uint32 randomSeed, PixelHit* pixelHit)
+{
+    return computePixelColorInNodes(viewRay, &scene->bvhRoot, scene->bvhRoot != NULL, scene, settings, randomSeed, pixelHit);
+}
+
+int cullTileBVH(const RayGenerator* rayGenerator, const Tile* tile, BVHNode* root, BVHNode** nodes)
+{
+    // Corner rays half a pixel outside the tile, so jittered and rounded rays stay inside the frustum
+    Vector corners[4] = {
+        generateRay(rayGenerator, tile->x - 0.5f, tile->y - 0.5f).direction,
+        generateRay(rayGenerator, tile->x + tile->width + 0.5f, tile->y - 0.5f).direction,
+        generateRay(rayGenerator, tile->x + tile->width + 0.5f, tile->y + tile->height + 0.5f).direction,
+        generateRay(rayGenerator, tile->x - 0.5f, tile->y + tile->height + 0.5f).direction
+    };
+    BVHFrustum frustum;
+    initBVHFrustum(&frustum, rayGenerator->origin, corners);
+    return cullBVHFrustum(root, &frustum, nodes, BVH_FRUSTUM_MAX_NODES);
+}
+
+// Helper function that frees tile workers and their buffers
+static void freeTileWorkers(TileWorker* workers, int count)
+{
+    if (workers == NULL) return;
+    for (int i = 0; i < count; i++)
+    {
+        free(workers[i].tileRays);
+        freeArena(&workers[i].scratch);
+        if (workers[i].wavefront != NULL)
+        {
+            freeWavefrontQueues(workers[i].wavefront);
+            free(workers[i].wavefront);
+        }
+    }
+    free(workers);
+}
+
+// Helper function that allocates 'count' tile workers with their ray buffers and scratch arenas; returns NULL (after printing an error) when that fails
+static TileWorker* createTileWorkers(int count)
+{
+    TileWorker* workers = calloc((size_t)count, sizeof(TileWorker));
+    for (int i = 0; workers != NULL && i < count; i++)
+    {
+        workers[i].tileRays = malloc(sizeof(Ray) * DEFAULT_TILE_SIZE * DEFAULT_TILE_SIZE);
+        if (workers[i].tileRays == NULL || !initArena(&workers[i].scratch, RENDER_SCRATCH_BYTES, 0))
+        {
+            freeTileWorkers(workers, i + 1);
+            workers = NULL;
+        }
+    }
+    if (workers == NULL)
+    {
+        printf("Error in creating tile workers: Memory allocation failed!\n");
+    }
+    return workers;
+}
+
+// Helper function that adds the ray counts a worker collected to the frame's
+static void addRenderStats(RenderStats* total, const RenderStats* worker)
+{
+    total->primaryRays += worker->primaryRays;
+    total->extraRays += worker->extraRays;
+    total->refinedPixels += worker->refinedPixels;
+    total->reusedPixels += worker->reusedPixels;
+    total->reshadedPixels += worker->reshadedPixels;
+    total->shadowRays += worker->shadowRays;
+    total->shadowCacheHits += worker->shadowCacheHits;
+    total->shadowPackets += worker->shadowPackets;
+    for (int bounces = 0; bounces <= MAX_REFLECTION_BOUNCES; bounces++)
+    {
+        total->bounceHistogram[bounces] += worker->bounceHistogram[bounces];
+    }
+}
+
+void initRenderState(RenderState* state, int width, int height, RenderSettings* settings)
+{
+    state->width = width;
+    state->height = height;
+    state->maxWidth = width;
+    state->maxHeight = height;
+    state->frameIndex = 0;
+    state->timedFrames = 0;
+    state->timedMilliseconds = 0.0;
+    state->lastFrameMilliseconds = 0.0;
+    state->previewSpacing = 1;
+    state->tracedSpacing = 0;
+    state->historyValid = 0;
+    state->viewChanged = 0;
+    state->geometryRevision = 0;
+    state->lightsRevision = 0;
+
+    buildTileSchedule(&state->schedule, width, height, DEFAULT_TILE_SIZE, settings->tileOrder);
+    initFrameBuffer(&state->frameBuffer, width, height);
+    initAccumulationBuffer(&state->accumulation, width, height);
+    initGBuffer(&state->gBuffer, width, height);
+    initFrameBuffer(&state->history, width, height);
+    initGBuffer(&state->historyGBuffer, width, height);
+    state->stats = (RenderStats){.spacing = 1};
+
+    state->jobs = NULL;
+    state->workers = createTileWorkers(1);
+    state->workerCount = state->workers != NULL ? 1 : 0;
+    state->refineMask = malloc((size_t)width * height);
+    state->splatDepth = malloc(sizeof(float) * width * height);
+    if (!state->workers || !state->refineMask || !state->splatDepth)
+    {
+        printf("Error in creating render state: Memory allocation failed!\n");
+    }
+}
+
+void freeRenderState(RenderState* state)
+{
+    freeTileSchedule(&state->schedule);
+    freeFrameBuffer(&state->frameBuffer);
+    freeAccumulationBuffer(&state->accumulation);
+    freeGBuffer(&state->gBuffer);
+    freeFrameBuffer(&state->history);
+    freeGBuffer(&state->historyGBuffer);
+    freeTileWorkers(state->workers, state->workerCount);
+    free(state->refineMask);
+    free(state->splatDepth);
+    state->workers = NULL;
+    state->workerCount = 0;
+    state->refineMask = NULL;
+    state->splatDepth = NULL;
+}
+
+int setRenderJobSystem(RenderState* state, JobSystem* jobs)
+{
+    int count = getJobWorkerCount(jobs);
+    TileWorker* workers = createTileWorkers(count);
+    if (workers == NULL) return 0;
+
+    freeTileWorkers(state->workers, state->workerCount);
+    state->workers = workers;
+    state->workerCount = count;
+    state->jobs = jobs;
+    return 1;
+}
+
+void setRenderResolution(RenderState* state, int width, int height)
+{
+    width = SDL_clamp(width, 1, state->maxWidth);
+    height = SDL_clamp(height, 1, state->maxHeight);
+    if (width == state->width && height == state->height) return;
+
+    state->width = width;
+    state->height = height;
+
+    // The buffers keep their allocation for the largest resolution; only the row stride and extent change
+    state->frameBuffer.width = width;
+    state->frameBuffer.height = height;
+    state->accumulation.sum.width = width;
+    state->accumulation.sum.height = height;
+    state->gBuffer.width = width;
+    state->gBuffer.height = height;
+    state->history.width = width;
+    state->history.height = height;
+    state->historyGBuffer.width = width;
+    state->historyGBuffer.height = height;
+    state->historyValid = 0; // The old hits are stored with the old row stride
+    restartRendering(state);
+
+    freeTileSchedule(&state->schedule);
+    buildTileSchedule(&state->schedule, width, height, DEFAULT_TILE_SIZE, state->schedule.order);
+    state->timedFrames = 0;
+    state->timedMilliseconds = 0.0;
+}
+
+void restartRendering(RenderState* state)
+{
+    resetAccumulationBuffer(&state->accumulation);
+    state->viewChanged = 1;
+}
+
+const char* getMotionModeName(MotionMode mode)
+{
+    switch (mode)
+    {
+        case MOTION_FULL: return "full";
+        case MOTION_PREVIEW: return "coarse-to-fine preview";
+        case MOTION_REPROJECT: return "reprojection";
+        default: return "unknown";
+    }
+}
+
+// Helper function that stores the center sample of a pixel in the frame buffer and the G-buffer
+static void storeSample(RenderState* state, int index, FloatColor color, const PixelHit* hit)
+{
+    state->frameBuffer.red[index] = color.r;
+    state->frameBuffer.green[index] = color.g;
+    state->frameBuffer.blue[index] = color.b;
+    if (state->gBuffer.object != NULL)
+    {
+        writeGBufferHit(&state->gBuffer, index, hit);
+    }
+}
+
+// Helper function that traces the center ray of every pixel of one tile row by row into the float frame buffer
+static void renderTile(TileWorker* worker, RenderState* state, Tile* tile, RayGenerator* rayGenerator, Scene* scene, RenderSettings* settings)
+{
+    FrameBuffer* frameBuffer = &state->frameBuffer;
+    generateRayTile(rayGenerator, tile->x, tile->y, tile->width, tile->height, worker->tileRays);
+
+    // Only the subtrees inside the tile's frustum are traversed by its rays
+    BVHNode* nodes[BVH_FRUSTUM_MAX_NODES];
+    int nodeCount = cullTileBVH(rayGenerator, tile, scene->bvhRoot, nodes);
+
+    for (int row = 0; row < tile->height; row++)
+    {
+        int y = tile->y + row;
+        Ray* rowRays = &worker->tileRays[row * tile->width];
+
+        for (int column = 0; column < tile->width; column++)
+        {
+            int x = tile->x + column;
+            int index = y * frameBuffer->width + x;
+
+            PixelHit hit;
+            FloatColor pixelColor = computePixelColorInNodes(rowRays[column], nodes, nodeCount, scene, settings, pixelSeed(x, y, state->frameIndex), &hit);
+            storeSample(state, index, pixelColor, &hit);
+        }
+    }
+
+    worker->stats.primaryRays += (Uint64)tile->width * tile->height;
+}
+
+// Helper function that allocates the wavefront queues of every worker the first time they are needed; returns 0 when that fails
+static int prepareWavefront(RenderState* state)
+{
+    for (int i = 0; i < state->workerCount; i++)
+    {
+        TileWorker* worker = &state->workers[i];
+        if (worker->wavefront != NULL) continue;
+
+        worker->wavefront = malloc(sizeof(WavefrontQueues));
+        if (worker->wavefront == NULL || !initWavefrontQueues(worker->wavefront, DEFAULT_TILE_SIZE * DEFAULT_TILE_SIZE))
+        {
+            free(worker->wavefront);
+            worker->wavefront = NULL;
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Everything the tiles or rows of a pass need, shared by the workers that render them
+typedef struct {
+    RenderState* state;
+    RayGenerator* rayGenerator;
+    Scene* scene;
+    RenderSettings* settings;
+    int wavefront;      // Render the tiles through the wavefront stages
+    int spacing;        // Grid spacing of a preview pass
+    int tracedSpacing;  // Grid spacing an earlier preview pass already traced, 0 when none
+    int callingWorker;  // Worker of the thread running renderFrame, whose thread-local counters renderFrame reads itself
+} TilePass;
+
+// Thread-local counters of a worker at the start of a job range
+typedef struct {
+    int collect;        // Set on threads other than the one running renderFrame
+    Uint64 bounces[MAX_REFLECTION_BOUNCES + 1];
+    ShadowCacheStats shadow;
+} RangeCounters;
+
+// Helper function that returns the worker running a job range and notes its thread-local counters
+static TileWorker* beginPassRange(const TilePass* pass, RangeCounters* counters)
+{
+    int workerIndex = SDL_max(getCurrentJobWorker(pass->state->jobs), 0);
+
+    // Bounce and shadow cache counts are thread-local; other threads hand over what this range added to them
+    counters->collect = workerIndex != pass->callingWorker;
+    if (counters->collect)
+    {
+        getBounceHistogram(counters->bounces);
+        counters->shadow = getShadowCacheStats();
+    }
+    return &pass->state->workers[workerIndex];
+}
+
+// Helper function that adds what a job range added to the thread-local counters to its worker's stats
+static void endPassRange(TileWorker* worker, const RangeCounters* counters)
+{
+    if (!counters->collect) return;
+
+    Uint64 bouncesAfter[MAX_REFLECTION_BOUNCES + 1];
+    getBounceHistogram(bouncesAfter);
+    for (int bounces = 0; bounces <= MAX_REFLECTION_BOUNCES; bounces++)
+    {
+        worker->stats.bounceHistogram[bounces] += bouncesAfter[bounces] - counters->bounces[bounces];
+    }
+    ShadowCacheStats shadowAfter = getShadowCacheStats();
+    worker->stats.shadowCacheHits += shadowAfter.hits - counters->shadow.hits;
+    worker->stats.shadowRays += (shadowAfter.hits - counters->shadow.hits) + (shadowAfter.misses - counters->shadow.misses);
+}
+
+// Helper function that renders tiles [begin, end) of the schedule on the calling worker and times each of them
+static void renderTileRange(int begin, int end, void* data)
+{
+    TilePass* pass = (TilePass*)data;
+    RenderState* state = pass->state;
+    RangeCounters counters;
+    TileWorker* worker = beginPassRange(pass, &counters);
 
-    // Compute the color of the surface at the intersection point.
-    pixelColor = computeSurfaceColor(scene, closestIntersection.point, closestIntersection.normal, viewRay.direction, closestIntersection.material);
+    for (int i = begin; i < end; i++)
+    {
+        Tile* tile = &state->schedule.tiles[i];
+        Uint64 tileStart = SDL_GetPerformanceCounter();
+        resetArena(&worker->scratch);
+        if (pass->wavefront)
+        {
+            renderTileWavefront(worker, state, tile, pass->rayGenerator, pass->scene, pass->settings);
+        }
+        else
+        {
+            renderTile(worker, state, tile, pass->rayGenerator, pass->scene, pass->settings);
+        }
+        recordTileCost(&state->schedule, i, SDL_GetPerformanceCounter() - tileStart);
+    }
 
-    return pixelColor;
-}
\ No newline at end of file
+    endPassRange(worker, &counters);
+}
+
+// Rows of the image one resolve job converts; also the grain of the passes that only copy or compare pixels
+#define RESOLVE_ROWS_PER_JOB 16
+
+// Rows of the image one job traces or shades again
+#define TRACE_ROWS_PER_JOB 4
+
+// Arguments of resolveFrameBuffer() shared by the resolve jobs
+typedef struct {
+    const FrameBuffer* buffer;
+    Uint32* pixels;
+    int pixelsPerRow;
+    const SDL_PixelFormatDetails* format;
+    const ResolveSettings* settings;
+} ResolvePass;
+
+// Helper function that resolves rows [begin, end) of the frame buffer
+static void resolveRowRange(int begin, int end, void* data)
+{
+    ResolvePass* pass = (ResolvePass*)data;
+    resolveFrameBuffer(pass->buffer, begin, end - begin, pass->pixels, pass->pixelsPerRow, pass->format, pass->settings);
+}
+
+// Helper function that traces the pixels of a tile on the grid of the given spacing, skipping the ones an
+// earlier, coarser pass already traced (those on the tracedSpacing grid)
+static void renderTilePreview(TileWorker* worker, RenderState* state, Tile* tile, RayGenerator* rayGenerator, Scene* scene, RenderSettings* settings, int spacing, int tracedSpacing)
+{
+    // Tiles start on multiples of the tile size, which the spacings divide, so the grid starts at the tile corner
+    for (int y = tile->y; y < tile->y + tile->height; y += spacing)
+    {
+        for (int x = tile->x; x < tile->x + tile->width; x += spacing)
+        {
+            if (tracedSpacing > 0 && x % tracedSpacing == 0 && y % tracedSpacing == 0) continue;
+
+            PixelHit hit;
+            Ray ray = generateRay(rayGenerator, x + 0.5f, y + 0.5f);
+            FloatColor pixelColor = computePixelColor(ray, scene, settings, pixelSeed(x, y, state->frameIndex), &hit);
+            storeSample(state, y * state->frameBuffer.width + x, pixelColor, &hit);
+            worker->stats.primaryRays++;
+        }
+    }
+}
+
+// Helper function that runs a preview pass over tiles [begin, end) of the schedule on the calling worker
+static void renderPreviewTileRange(int begin, int end, void* data)
+{
+    TilePass* pass = (TilePass*)data;
+    RangeCounters counters;
+    TileWorker* worker = beginPassRange(pass, &counters);
+
+    for (int i = begin; i < end; i++)
+    {
+        renderTilePreview(worker, pass->state, &pass->state->schedule.tiles[i], pass->rayGenerator, pass->scene, pass->settings, pass->spacing, pass->tracedSpacing);
+    }
+
+    endPassRange(worker, &counters);
+}
+
+// Helper function that copies every traced sample of a preview pass in rows [begin, end) over the block of
+// pixels to its right and below. Only pixels on the traced grid are read and they are never written, so
+// row ranges can be filled in parallel.
+static void fillPreviewBlocks(int begin, int end, void* data)
+{
+    TilePass* pass = (TilePass*)data;
+    RenderState* state = pass->state;
+    FrameBuffer* frameBuffer = &state->frameBuffer;
+    int spacing = pass->spacing;
+    for (int y = begin; y < end; y++)
+    {
+        int sourceRow = (y - y % spacing) * frameBuffer->width;
+        for (int x = 0; x < state->width; x++)
+        {
+            int index = y * frameBuffer->width + x;
+            int source = sourceRow + x - x % spacing;
+            if (source == index) continue;
+
+            frameBuffer->red[index] = frameBuffer->red[source];
+            frameBuffer->green[index] = frameBuffer->green[source];
+            frameBuffer->blue[index] = frameBuffer->blue[source];
+        }
+    }
+}
+
+// Helper function that keeps or traces each pixel of rows [begin, end) of a reprojected frame
+static void reprojectRowRange(int begin, int end, void* data)
+{
+    TilePass* pass = (TilePass*)data;
+    RenderState* state = pass->state;
+    RangeCounters counters;
+    TileWorker* worker = beginPassRange(pass, &counters);
+
+    int width = state->width;
+    int height = state->height;
+    const Uint8* hasSample = state->refineMask;
+
+    for (int y = begin; y < end; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            int index = y * width + x;
+            int reuse = hasSample[index] && (x + 3 * y + state->frameIndex) % REPROJECTION_REFRESH_PERIOD != 0;
+
+            // Disocclusion check against the nearest sample in the 3x3 neighbourhood
+            if (reuse)
+            {
+                float nearest = state->splatDepth[index];
+                for (int neighbourY = SDL_max(y - 1, 0); neighbourY <= SDL_min(y + 1, height - 1); neighbourY++)
+                {
+                    for (int neighbourX = SDL_max(x - 1, 0); neighbourX <= SDL_min(x + 1, width - 1); neighbourX++)
+                    {
+                        nearest = SDL_min(nearest, state->splatDepth[neighbourY * width + neighbourX]);
+                    }
+                }
+                reuse = state->splatDepth[index] <= nearest * (1.0f + DISOCCLUSION_DEPTH_TOLERANCE);
+            }
+
+            if (reuse)
+            {
+                worker->stats.reusedPixels++;
+                continue;
+            }
+
+            PixelHit hit;
+            Ray ray = generateRay(pass->rayGenerator, x + 0.5f, y + 0.5f);
+            FloatColor pixelColor = computePixelColor(ray, pass->scene, pass->settings, pixelSeed(x, y, state->frameIndex), &hit);
+            storeSample(state, index, pixelColor, &hit);
+            worker->stats.primaryRays++;
+        }
+    }
+
+    endPassRange(worker, &counters);
+}
+
+// Helper function that renders the first frame after a camera move from the previous one. Every hit of the
+// previous frame is projected into the new view and lands in the pixel that contains it, the nearest hit
+// winning. Samples far behind their neighbours are surfaces seen through gaps of the splatted foreground and
+// are dropped; the pixels left without a sample, plus a rotating subset, are traced.
+// The splat scatters into arbitrary pixels with a depth test, so it runs on the calling thread; the rows
+// are then checked and traced in parallel.
+static void reprojectFrame(TilePass* pass)
+{
+    RenderState* state = pass->state;
+
+    // The current frame becomes the history, and the frame is rebuilt in the other buffers
+    FrameBuffer frame = state->history;
+    state->history = state->frameBuffer;
+    state->frameBuffer = frame;
+    GBuffer hits = state->historyGBuffer;
+    state->historyGBuffer = state->gBuffer;
+    state->gBuffer = hits;
+
+    int width = state->width;
+    int height = state->height;
+    FrameBuffer* history = &state->history;
+    GBuffer* historyHits = &state->historyGBuffer;
+    FrameBuffer* frameBuffer = &state->frameBuffer;
+    Uint8* hasSample = state->refineMask;
+
+    for (int i = 0; i < width * height; i++)
+    {
+        state->splatDepth[i] = FLT_MAX;
+        hasSample[i] = 0;
+    }
+
+    // Forward splat with a depth test
+    for (int i = 0; i < width * height; i++)
+    {
+        float imageX, imageY, depth;
+        if (!projectPointToPixel(pass->rayGenerator, historyHits->position[i], &imageX, &imageY, &depth)) continue;
+        if (imageX < 0.0f || imageY < 0.0f || imageX >= width || imageY >= height) continue;
+
+        int index = (int)imageY * width + (int)imageX;
+        if (depth >= state->splatDepth[index]) continue;
+
+        state->splatDepth[index] = depth;
+        frameBuffer->red[index] = history->red[i];
+        frameBuffer->green[index] = history->green[i];
+        frameBuffer->blue[index] = history->blue[i];
+        PixelHit hit = readGBufferHit(historyHits, i);
+        writeGBufferHit(&state->gBuffer, index, &hit);
+        hasSample[index] = 1;
+    }
+
+    parallelFor(state->jobs, height, TRACE_ROWS_PER_JOB, reprojectRowRange, pass);
+}
+
+// Helper function that shades every pixel of rows [begin, end) again from the G-buffer after only the lights
+// changed; the camera and the objects are unchanged, so the hits of the last frame are still what each pixel sees
+static void reshadeRowRange(int begin, int end, void* data)
+{
+    TilePass* pass = (TilePass*)data;
+    RenderState* state = pass->state;
+    RangeCounters counters;
+    TileWorker* worker = beginPassRange(pass, &counters);
+
+    FrameBuffer* frameBuffer = &state->frameBuffer;
+    for (int y = begin; y < end; y++)
+    {
+        for (int x = 0; x < state->width; x++)
+        {
+            int index = y * state->width + x;
+            PixelHit hit = readGBufferHit(&state->gBuffer, index);
+            Vector viewDirection = normalizeVector(subtractVectors(hit.position, pass->rayGenerator->origin));
+
+            FloatColor color = shadePixelHit(&hit, viewDirection, pass->scene, pass->settings, pixelSeed(x, y, state->frameIndex));
+            frameBuffer->red[index] = color.r;
+            frameBuffer->green[index] = color.g;
+            frameBuffer->blue[index] = color.b;
+        }
+    }
+
+    worker->stats.reshadedPixels += (Uint64)state->width * (end - begin);
+    endPassRange(worker, &counters);
+}
+
+// Helper function that checks whether two samples see different primitives or, when checkColor is set,
+// differ by more than the threshold in any channel
+static int samplesDiffer(const void* objectA, FloatColor colorA, const void* objectB, FloatColor colorB, int checkColor, float threshold)
+{
+    if (objectA != objectB) return 1;
+    if (!checkColor) return 0;
+
+    float difference = SDL_max(SDL_fabsf(colorA.r - colorB.r), SDL_max(SDL_fabsf(colorA.g - colorB.g), SDL_fabsf(colorA.b - colorB.b)));
+    return difference > threshold;
+}
+
+// Helper function that reads a pixel of the float frame buffer
+static FloatColor readPixel(const FrameBuffer* buffer, int index)
+{
+    return (FloatColor){buffer->red[index], buffer->green[index], buffer->blue[index]};
+}
+
+// Helper function that marks the pixels of rows [begin, end) that differ from a horizontal or vertical
+// neighbour. Each pixel only writes its own mark, so row ranges can be marked in parallel.
+static void markEdgeRows(int begin, int end, void* data)
+{
+    TilePass* pass = (TilePass*)data;
+    RenderState* state = pass->state;
+    const FrameBuffer* frameBuffer = &state->frameBuffer;
+    const void** objects = state->gBuffer.object;
+    float threshold = pass->settings->adaptiveThreshold;
+    int width = state->width;
+    int height = state->height;
+
+    // Stochastic light sampling makes neighbouring colors noisy, so only primitive edges count then
+    int checkColor = pass->settings->lightSamples == 0;
+
+    for (int y = begin; y < end; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            int index = y * width + x;
+            const void* object = objects[index];
+            FloatColor color = readPixel(frameBuffer, index);
+
+            state->refineMask[index] =
+                (x > 0 && samplesDiffer(object, color, objects[index - 1], readPixel(frameBuffer, index - 1), checkColor, threshold)) ||
+                (x + 1 < width && samplesDiffer(object, color, objects[index + 1], readPixel(frameBuffer, index + 1), checkColor, threshold)) ||
+                (y > 0 && samplesDiffer(object, color, objects[index - width], readPixel(frameBuffer, index - width), checkColor, threshold)) ||
+                (y + 1 < height && samplesDiffer(object, color, objects[index + width], readPixel(frameBuffer, index + width), checkColor, threshold));
+        }
+    }
+}
+
+// Helper function that supersamples the marked pixels of rows [begin, end).
+// Each marked pixel adds sub-pixel rays at Halton offsets and stores the average of all its samples.
+static void refineEdgeRows(int begin, int end, void* data)
+{
+    TilePass* pass = (TilePass*)data;
+    RenderState* state = pass->state;
+    RenderSettings* settings = pass->settings;
+    RangeCounters counters;
+    TileWorker* worker = beginPassRange(pass, &counters);
+
+    FrameBuffer* frameBuffer = &state->frameBuffer;
+    const void** objects = state->gBuffer.object;
+    int checkColor = settings->lightSamples == 0;
+    int width = state->width;
+
+    for (int y = begin; y < end; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            int index = y * width + x;
+            if (!state->refineMask[index]) continue;
+
+            FloatColor center = readPixel(frameBuffer, index);
+            FloatColor sum = center;
+            int sampleCount = 1;
+            int agree = 1;
+            Uint32 seed = pixelSeed(x, y, state->frameIndex);
+
+            for (int sample = 1; sample < settings->maxSamplesPerPixel; sample++)
+            {
+                float offsetX = radicalInverse(sample, 2) - 0.5f;
+                float offsetY = radicalInverse(sample, 3) - 0.5f;
+                Ray ray = generateRay(pass->rayGenerator, x + 0.5f + offsetX, y + 0.5f + offsetY);
+
+                PixelHit hit;
+                FloatColor color = computePixelColor(ray, pass->scene, settings, hashUint32(seed + sample), &hit);
+                sum.r += color.r;
+                sum.g += color.g;
+                sum.b += color.b;
+                sampleCount++;
+
+                // Pixels marked only because a neighbour differs are often uniform inside; stop once
+                // the first few extra rays all match the center ray
+                agree = agree && !samplesDiffer(objects[index], center, hit.object, color, checkColor, settings->adaptiveThreshold);
+                if (sample == ADAPTIVE_EARLY_OUT_SAMPLES && agree) break;
+            }
+
+            float scale = 1.0f / sampleCount;
+            frameBuffer->red[index] = sum.r * scale;
+            frameBuffer->green[index] = sum.g * scale;
+            frameBuffer->blue[index] = sum.b * scale;
+
+            worker->stats.extraRays += sampleCount - 1;
+            worker->stats.refinedPixels++;
+        }
+    }
+
+    endPassRange(worker, &counters);
+}
+
+// Helper function that supersamples the pixels on edges between primitives or sharp color changes.
+// Every pixel is marked before any is refined, since refining changes the colors the marks compare.
+static void refineEdges(TilePass* pass)
+{
+    RenderState* state = pass->state;
+    if (pass->settings->maxSamplesPerPixel <= 1 || state->gBuffer.object == NULL || state->refineMask == NULL) return;
+
+    parallelFor(state->jobs, state->height, RESOLVE_ROWS_PER_JOB, markEdgeRows, pass);
+    parallelFor(state->jobs, state->height, TRACE_ROWS_PER_JOB, refineEdgeRows, pass);
+}
+
+int renderFrame(RenderState* state, Camera* camera, Scene* scene, RenderSettings* settings, Uint32* pixels, int pixelsPerRow, const SDL_PixelFormatDetails* format)
+{
+    if (state->workers == NULL || state->frameBuffer.red == NULL) return 0;
+
+    // Switching the tile order restarts the timing so orders can be compared
+    if (state->schedule.order != settings->tileOrder || state->schedule.tiles == NULL)
+    {
+        freeTileSchedule(&state->schedule);
+        buildTileSchedule(&state->schedule, state->width, state->height, DEFAULT_TILE_SIZE, settings->tileOrder);
+        state->timedFrames = 0;
+        state->timedMilliseconds = 0.0;
+    }
+
+    // In TILE_ORDER_COST the tiles that took longest last frame go first
+    Arena* frameScratch = &state->workers[SDL_max(getCurrentJobWorker(state->jobs), 0)].scratch;
+    resetArena(frameScratch);
+    scheduleTilesByCost(&state->schedule, frameScratch);
+
+    // After an edit to the objects nothing rendered before is valid; after an edit to the lights the hits
+    // in the G-buffer still are, only their shading is stale
+    updateSceneBVH(scene);
+    updateSceneLightStructures(scene);
+    int geometryChanged = scene->geometryRevision != state->geometryRevision;
+    int lightsChanged = scene->lightsRevision != state->lightsRevision;
+    if (geometryChanged || lightsChanged)
+    {
+        resetAccumulationBuffer(&state->accumulation);
+        if (geometryChanged || state->viewChanged)
+        {
+            state->historyValid = 0;
+        }
+        state->geometryRevision = scene->geometryRevision;
+        state->lightsRevision = scene->lightsRevision;
+    }
+
+    int accumulate = settings->progressive || settings->lightSamples > 0;
+    if (accumulate && state->accumulation.frameCount >= PROGRESSIVE_MAX_FRAMES)
+    {
+        return 0; // Converged: the pixels already hold the final image
+    }
+
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    // Precompute the ray basis once, then step rays across each tile
+    RayGenerator rayGenerator;
+    initRayGenerator(&rayGenerator, camera, state->width, state->height);
+
+    // The first frame after a change samples pixel centers, so interaction looks the same as without
+    // accumulation; later frames move every ray along a Halton sequence inside its pixel
+    int accumulatedFrames = state->accumulation.frameCount;
+    if (settings->progressive && accumulatedFrames > 0)
+    {
+        setRayGeneratorJitter(&rayGenerator, radicalInverse(accumulatedFrames, 2) - 0.5f, radicalInverse(accumulatedFrames, 3) - 0.5f);
+    }
+
+    // Pick how the first frame after a camera move or a light edit is rendered
+    int reproject = 0;
+    int reshade = 0;
+    if (state->viewChanged)
+    {
+        state->viewChanged = 0;
+        state->previewSpacing = settings->motionMode == MOTION_PREVIEW ? PREVIEW_START_SPACING : 1;
+        state->tracedSpacing = 0;
+        reproject = settings->motionMode == MOTION_REPROJECT && state->historyValid && state->splatDepth != NULL
+            && state->history.red != NULL && state->gBuffer.object != NULL && state->historyGBuffer.object != NULL;
+    }
+    else if (lightsChanged)
+    {
+        reshade = state->historyValid && state->gBuffer.object != NULL;
+    }
+
+    state->stats = (RenderStats){.spacing = reproject || reshade ? 0 : state->previewSpacing};
+    resetBounceHistogram();
+    resetShadowCacheStats();
+    for (int i = 0; i < state->workerCount; i++)
+    {
+        state->workers[i].stats = (RenderStats){0};
+    }
+    int completed = !reproject && !reshade;
+    TilePass pass = {.state = state, .rayGenerator = &rayGenerator, .scene = scene, .settings = settings,
+                     .callingWorker = SDL_max(getCurrentJobWorker(state->jobs), 0)};
+    if (reproject)
+    {
+        reprojectFrame(&pass);
+    }
+    else if (reshade)
+    {
+        parallelFor(state->jobs, state->height, TRACE_ROWS_PER_JOB, reshadeRowRange, &pass);
+
+        // The G-buffer only holds the center hits, so edge pixels are supersampled again under the new lights
+        refineEdges(&pass);
+        if (accumulate)
+        {
+            // The reshaded hits are a valid sample of the new lighting, so they start the new average
+            accumulateFrameBuffer(&state->accumulation, &state->frameBuffer);
+        }
+    }
+
+    while (completed && state->previewSpacing > 1)
+    {
+        // Preview pass: trace the next finer grid, keep the samples of the coarser ones, fill the gaps
+        Uint64 passStart = SDL_GetPerformanceCounter();
+        int spacing = state->previewSpacing;
+        pass.spacing = spacing;
+        pass.tracedSpacing = state->tracedSpacing;
+        parallelFor(state->jobs, state->schedule.count, 1, renderPreviewTileRange, &pass);
+        parallelFor(state->jobs, state->height, RESOLVE_ROWS_PER_JOB, fillPreviewBlocks, &pass);
+        state->tracedSpacing = spacing;
+        state->previewSpacing = spacing / 2;
+
+        // The next pass traces three times as many pixels as this one; run it now if it fits the budget
+        Uint64 now = SDL_GetPerformanceCounter();
+        double elapsed = (now - start) * 1000.0 / SDL_GetPerformanceFrequency();
+        double passTime = (now - passStart) * 1000.0 / SDL_GetPerformanceFrequency();
+        if (elapsed + 3.0 * passTime > settings->previewBudgetMilliseconds)
+        {
+            completed = 0;
+            break;
+        }
+    }
+
+    if (completed)
+    {
+        if (state->tracedSpacing > 0)
+        {
+            // Last preview pass: the pixels between the existing samples complete the image
+            pass.spacing = 1;
+            pass.tracedSpacing = state->tracedSpacing;
+            parallelFor(state->jobs, state->schedule.count, 1, renderPreviewTileRange, &pass);
+            state->tracedSpacing = 0;
+        }
+        else
+        {
+            // Every tile on whichever worker is free, streamed through the wavefront stages if they are on
+            pass.wavefront = settings->wavefront && settings->lightSamples == 0 && prepareWavefront(state);
+            parallelFor(state->jobs, state->schedule.count, 1, renderTileRange, &pass);
+        }
+
+        // Spend extra rays only where the center rays disagree with their neighbours
+        refineEdges(&pass);
+
+        if (accumulate)
+        {
+            // Average the jittered or noisy frames rendered from this view
+            accumulateFrameBuffer(&state->accumulation, &state->frameBuffer);
+        }
+    }
+
+    // Convert the whole float image to the target pixel format in one pass
+    ResolvePass resolvePass = {&state->frameBuffer, pixels, pixelsPerRow, format, &settings->resolve};
+    parallelFor(state->jobs, state->height, RESOLVE_ROWS_PER_JOB, resolveRowRange, &resolvePass);
+
+    if (accumulate && (completed || reshade))
+    {
+        finishAccumulationFrame(&state->accumulation);
+    }
+
+    // Preview frames leave gaps in the G-buffer, so only the other frames can be reprojected or reshaded
+    state->historyValid = completed || reproject || reshade;
+    getBounceHistogram(state->stats.bounceHistogram);
+    ShadowCacheStats shadowStats = getShadowCacheStats();
+    state->stats.shadowRays += shadowStats.hits + shadowStats.misses; // Packet rays were counted as they were traced
+    state->stats.shadowCacheHits = shadowStats.hits;
+    for (int i = 0; i < state->workerCount; i++)
+    {
+        addRenderStats(&state->stats, &state->workers[i].stats);
+        const Arena* scratch = &state->workers[i].scratch;
+        state->stats.scratchBytes = SDL_max(state->stats.scratchBytes, SDL_max(scratch->highWater, scratch->used));
+    }
+    state->frameIndex++;
+
+    state->lastFrameMilliseconds = (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+    if (state->stats.spacing == 1)
+    {
+        // Only complete frames are comparable between tile orders
+        state->timedFrames++;
+        state->timedMilliseconds += state->lastFrameMilliseconds;
+    }
+    return 1;
+}
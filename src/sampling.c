@@ -0,0 +1,39 @@
+#include "sampling.h"
+
+// PCG-style output permutation of a 32-bit integer
+Uint32 hashUint32(Uint32 value)
+{
+    Uint32 state = value * 747796405u + 2891336453u;
+    Uint32 word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
+
+Uint32 pixelSeed(int x, int y, Uint32 frameIndex)
+{
+    return hashUint32((Uint32)x ^ hashUint32((Uint32)y ^ hashUint32(frameIndex)));
+}
+
+float randomFloat(Uint32* state)
+{
+    // Counter-based stream: step the state by the golden ratio and hash it
+    *state += 0x9E3779B9u;
+    Uint32 bits = hashUint32(*state);
+
+    // Use the top 24 bits so the result is exactly representable and strictly below 1
+    return (bits >> 8) * (1.0f / 16777216.0f);
+}
+
+float radicalInverse(Uint32 index, Uint32 base)
+{
+    // Mirror the digits of the index around the radix point
+    float inverseBase = 1.0f / base;
+    float digitWeight = inverseBase;
+    float result = 0.0f;
+    while (index > 0)
+    {
+        result += (index % base) * digitWeight;
+        index /= base;
+        digitWeight *= inverseBase;
+    }
+    return result;
+}
@@ -1,10 +1,29 @@
 #include "scene.h"
+#include "bvh.h"
+#include "light_buffer.h"
+#include "light_bvh.h"
+#include "simd.h"
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 
 #define EPSILON 0.001 // small offset
 
+#define SHADOW_CACHE_SIZE 32 // Number of lights each thread remembers an occluder for
+
+// Last object that blocked a shadow ray towards a light
+typedef struct {
+    const Scene* scene;  // Scene the occluder belongs to (NULL for an empty slot)
+    const void* light;   // Light the shadow ray was traced towards
+    int objectType;      // 0 = sphere, 1 = plane, 2 = triangle
+    int objectIndex;     // Index into the scene's array of that type
+} ShadowCacheEntry;
+
+// Every rendering thread keeps its own cache and counters, so no locking is needed
+static _Thread_local ShadowCacheEntry shadowCache[SHADOW_CACHE_SIZE];
+static _Thread_local ShadowCacheStats shadowCacheStats;
+
 void initScene(Scene* scene, int maxSpheres, int maxPlanes, int maxTriangles, int maxPointLights, int maxDirectionalLights, int maxSpotLights)
 {
     scene->objects.sphereCount = 0;
@@ -14,6 +33,16 @@ void initScene(Scene* scene, int maxSpheres, int maxPlanes, int maxTriangles, in
     scene->lights.directionalLightCount = 0;
     scene->lights.pointLightCount = 0;
     scene->lights.spotLightCount = 0;
+    scene->lights.ambientLight.material = (LightMaterial){{0, 0, 0, 255}, 0.0f};
+
+    scene->bvhRoot = NULL;
+    scene->lightBuffer = NULL;
+    scene->lightBvhRoot = NULL;
+    scene->geometryRevision = 0;
+    scene->lightsRevision = 0;
+    scene->bvhRevision = 0;
+    scene->lightStructuresRevision = 0;
+    scene->lightStructuresGeometryRevision = 0;
 
     // Allocate memory dynamically
     scene->objects.spheres = malloc(maxSpheres * sizeof(Sphere));
@@ -50,6 +79,18 @@ void freeScene(Scene* scene)
     free(scene->lights.directionalLights);
     free(scene->lights.pointLights);
     free(scene->lights.spotLights);
+    scene->objects.spheres = NULL;
+    scene->objects.planes = NULL;
+    scene->objects.triangles = NULL;
+    scene->lights.directionalLights = NULL;
+    scene->lights.pointLights = NULL;
+    scene->lights.spotLights = NULL;
+
+    freeLightBuffer(scene->lightBuffer);
+    scene->lightBuffer = NULL;
+
+    freeLightBVH(scene->lightBvhRoot);
+    scene->lightBvhRoot = NULL;
 }
 
 void addSphere(Scene* scene, Vector position, float radius, Material material)
@@ -60,6 +101,7 @@ void addSphere(Scene* scene, Vector position, float radius, Material material)
         scene->objects.spheres[scene->objects.sphereCount].radius = radius;
         scene->objects.spheres[scene->objects.sphereCount].material = material;
         scene->objects.sphereCount++;
+        scene->geometryRevision++;
     }
     else
     {
@@ -89,6 +131,7 @@ void addPlane(Scene* scene, Vector position, Vector normal, float width, float h
         plane->v = vectorCrossProduct(plane->surfaceNormal, plane->u);  // Second tangent vector (already normalized)
 
         scene->objects.planeCount++;
+        scene->geometryRevision++;
     } 
     else 
     {
@@ -106,6 +149,7 @@ void addTriangle(Scene* scene, Vector v1, Vector v2, Vector v3, Material materia
         scene->objects.triangles[scene->objects.triangleCount].v3 = v3;
         scene->objects.triangles[scene->objects.triangleCount].material = material;
         scene->objects.triangleCount++;
+        scene->geometryRevision++;
     }
     else
     {
@@ -113,6 +157,32 @@ void addTriangle(Scene* scene, Vector v1, Vector v2, Vector v3, Material materia
     }
 }
 
+void moveSphere(Scene* scene, int index, Vector position)
+{
+    if (index < 0 || index >= scene->objects.sphereCount)
+    {
+        printf("Cannot move sphere %d, no such sphere!\n", index);
+        return;
+    }
+
+    scene->objects.spheres[index].position = position;
+    scene->geometryRevision++;
+}
+
+void moveTriangle(Scene* scene, int index, Vector v1, Vector v2, Vector v3)
+{
+    if (index < 0 || index >= scene->objects.triangleCount)
+    {
+        printf("Cannot move triangle %d, no such triangle!\n", index);
+        return;
+    }
+
+    scene->objects.triangles[index].v1 = v1;
+    scene->objects.triangles[index].v2 = v2;
+    scene->objects.triangles[index].v3 = v3;
+    scene->geometryRevision++;
+}
+
 void addPointLight(Scene *scene, LightMaterial material, Vector position, float range)
 {
     if(scene->lights.pointLightCount < scene->lights.maxPointLights)
@@ -121,6 +191,7 @@ void addPointLight(Scene *scene, LightMaterial material, Vector position, float
         scene->lights.pointLights[scene->lights.pointLightCount].material = material;
         scene->lights.pointLights[scene->lights.pointLightCount].range = range;
         scene->lights.pointLightCount++;
+        scene->lightsRevision++;
     }
     else
     {
@@ -136,6 +207,7 @@ void addDirectionalLight(Scene *scene, LightMaterial material, Vector position,
         scene->lights.directionalLights[scene->lights.directionalLightCount].material = material;
         scene->lights.directionalLights[scene->lights.directionalLightCount].direction = normalizeVector(direction);
         scene->lights.directionalLightCount++;
+        scene->lightsRevision++;
     }
     else
     {
@@ -153,6 +225,7 @@ void addSpotLight(Scene *scene, LightMaterial material, Vector position, Vector
         scene->lights.spotLights[scene->lights.spotLightCount].cutoffAngle = cutOffAngle;
         scene->lights.spotLights[scene->lights.spotLightCount].innerCutoffAngle = innerCutoffAngle;
         scene->lights.spotLightCount++;
+        scene->lightsRevision++;
     }
     else
     {
@@ -163,100 +236,183 @@ void addSpotLight(Scene *scene, LightMaterial material, Vector position, Vector
 void setAmbientLight(Scene *scene, LightMaterial material)
 {
     scene->lights.ambientLight.material = material;
+    scene->lightsRevision++;
 }
 
-int isPointInShadow(Vector point, PointLight *light, Scene *scene)
+void movePointLight(Scene *scene, int index, Vector position)
 {
-    // Compute the direction from the point to the light source
-    Vector lightDirection = normalizeVector(subtractVectors(light->position, point));
-
-    // Apply a small offset to prevent self-shadowing artifacts (avoid floating-point errors)
-    Vector offset = multiplyVector(lightDirection, EPSILON);
-    
-    // Create a shadow ray that starts just above the surface and points toward the light
-    Ray shadowRay = {addVectors(point, offset), lightDirection};
-
-    // Compute the maximum possible distance the shadow ray can travel before reaching the light
-    float maxDistance = vectorLength(subtractVectors(light->position, point));
+    if (index < 0 || index >= scene->lights.pointLightCount)
+    {
+        printf("Cannot move point light %d, no such light!\n", index);
+        return;
+    }
 
-    float distance; // Variable to store the intersection distance
+    scene->lights.pointLights[index].position = position;
+    scene->lightsRevision++;
+}
 
-    // Check for intersection with all spheres in the scene
-    for (int i = 0; i < scene->objects.sphereCount; i++)
+void updateSceneBVH(Scene *scene)
+{
+    if (scene->bvhRevision == scene->geometryRevision)
     {
-        // If the shadow ray hits a sphere and the hit is before the light, the point is in shadow
-        if (intersectRaySphere(shadowRay, scene->objects.spheres[i], &distance) && 
-            distance > 0 && distance < maxDistance) 
-        {
-            return 1; // The point is in shadow
-        }
+        return;
     }
 
-    // Check for intersection with all planes in the scene
-    for (int i = 0; i < scene->objects.planeCount; i++)
+    // Objects are never removed, so the same count means they only moved and the leaves still match them
+    int objectCount = scene->objects.planeCount + scene->objects.sphereCount + scene->objects.triangleCount;
+    if (scene->bvhRoot != NULL && countBVHObjects(scene->bvhRoot) == objectCount)
     {
-        if (intersectRayPlane(shadowRay, scene->objects.planes[i], &distance) && 
-            distance > 0 && distance < maxDistance) 
-        {
-            return 1; // The point is in shadow
-        }
+        refitBVH(scene->bvhRoot, &scene->objects);
+        rebuildDegradedBVH(scene->bvhRoot, BVH_REBUILD_COST_RATIO);
     }
-
-    // Check for intersection with all triangles in the scene
-    for (int i = 0; i < scene->objects.triangleCount; i++)
+    else
     {
-        if (intersectRayTriangle(shadowRay, scene->objects.triangles[i], &distance) && 
-            distance > 0 && distance < maxDistance) 
-        {
-            return 1; // The point is in shadow
-        }
+        freeBVH(scene->bvhRoot);
+        scene->bvhRoot = buildBVH(&scene->objects);
     }
 
-    // If no object is blocking the light, the point is fully illuminated
-    return 0;
+    scene->bvhRevision = scene->geometryRevision;
 }
 
-int isPointInShadowDir(Vector point, DirectionalLight *light, Scene *scene)
-{        
-    // Create a small offset in the direction of the light to prevent self-shadowing
-    Ray shadowRay = {addVectors(point, multiplyVector(light->direction, EPSILON)),light->direction};
+void updateSceneLightStructures(Scene *scene)
+{
+    if (scene->lightStructuresRevision == scene->lightsRevision && scene->lightBuffer != NULL &&
+        scene->lightStructuresGeometryRevision == scene->geometryRevision)
+    {
+        return;
+    }
+
+    freeLightBuffer(scene->lightBuffer);
+    freeLightBVH(scene->lightBvhRoot);
+
+    // Build the SoA light buffer used by the batched shading path.
+    scene->lightBuffer = buildLightBuffer(&scene->lights);
+
+    // Build the light BVH so shading only visits lights that can reach the point; spotlight cones end at the
+    // scene bounds, or nowhere while the scene has no objects.
+    scene->lightBvhRoot = buildLightBVH(&scene->lights, scene->bvhRoot ? &scene->bvhRoot->bounds : NULL);
+
+    scene->lightStructuresRevision = scene->lightsRevision;
+    scene->lightStructuresGeometryRevision = scene->geometryRevision;
+}
 
+// Helper function that tests one scene object against a shadow ray (0 = sphere, 1 = plane, 2 = triangle)
+static int occludesShadowRay(Scene *scene, Ray shadowRay, int objectType, int objectIndex, float maxDistance)
+{
     float distance; // Variable to store the intersection distance
+    int hit = 0;
 
-    // Check for intersection with all spheres in the scene
-    for (int i = 0; i < scene->objects.sphereCount; i++)
+    switch (objectType)
     {
-        // If the shadow ray intersects a sphere, the point is in shadow
-        if (intersectRaySphere(shadowRay, scene->objects.spheres[i], &distance))
-        {
-            return 1; // The point is in shadow
-        }
+        case 0:
+            hit = objectIndex < scene->objects.sphereCount && intersectRaySphere(shadowRay, scene->objects.spheres[objectIndex], &distance);
+            break;
+        case 1:
+            hit = objectIndex < scene->objects.planeCount && intersectRayPlane(shadowRay, scene->objects.planes[objectIndex], &distance);
+            break;
+        case 2:
+            hit = objectIndex < scene->objects.triangleCount && intersectRayTriangle(shadowRay, scene->objects.triangles[objectIndex], &distance);
+            break;
     }
 
-    // Check for intersection with all planes in the scene
-    for (int i = 0; i < scene->objects.planeCount; i++)
+    // Only hits between the surface and the light block it
+    return hit && distance > 0 && distance < maxDistance;
+}
+
+// Helper function that returns the cache slot for a light (direct-mapped on the light's address)
+static ShadowCacheEntry *shadowCacheSlot(const void *light)
+{
+    uintptr_t key = (uintptr_t)light;
+    return &shadowCache[(key ^ (key >> 7)) % SHADOW_CACHE_SIZE];
+}
+
+// The last occluder found for this light is tested first; adjacent points are usually blocked by the same object.
+int traceShadowRay(Scene *scene, const void *light, Ray shadowRay, float maxDistance)
+{
+    ShadowCacheEntry *entry = shadowCacheSlot(light);
+    if (entry->scene == scene && entry->light == light)
     {
-        // If the shadow ray intersects a plane, the point is in shadow
-        if (intersectRayPlane(shadowRay, scene->objects.planes[i], &distance))
+        if (occludesShadowRay(scene, shadowRay, entry->objectType, entry->objectIndex, maxDistance))
         {
-            return 1; // The point is in shadow
+            shadowCacheStats.hits++;
+            return 1; // The cached occluder still blocks the light
         }
     }
+    shadowCacheStats.misses++;
 
-    // Check for intersection with all triangles in the scene
-    for (int i = 0; i < scene->objects.triangleCount; i++)
+    // Check every object of every type, starting with spheres, then planes and triangles
+    int counts[3] = {scene->objects.sphereCount, scene->objects.planeCount, scene->objects.triangleCount};
+    for (int type = 0; type < 3; type++)
     {
-        // If the shadow ray intersects a triangle, the point is in shadow
-        if (intersectRayTriangle(shadowRay, scene->objects.triangles[i], &distance))
+        for (int i = 0; i < counts[type]; i++)
         {
-            return 1; // The point is in shadow
+            if (occludesShadowRay(scene, shadowRay, type, i, maxDistance))
+            {
+                // Remember the occluder for the next point shaded by this light on this thread
+                entry->scene = scene;
+                entry->light = light;
+                entry->objectType = type;
+                entry->objectIndex = i;
+                return 1; // The point is in shadow
+            }
         }
     }
-    
+
     // If no object is blocking the light, the point is fully illuminated
     return 0;
 }
 
+int traceShadowRays(Scene *scene, const void *const *lights, const Ray *shadowRays, const float *maxDistances, int count)
+{
+    count = SDL_min(count, SIMD_LANES);
+    if (count <= 0) return 0;
+
+    // A stale BVH could miss moved objects, so it is only used once it matches the geometry
+    if (scene->bvhRoot != NULL && scene->bvhRevision == scene->geometryRevision)
+    {
+        shadowCacheStats.misses += (Uint64)count;
+        return traceShadowPacketBVH(scene->bvhRoot, shadowRays, maxDistances, count);
+    }
+
+    int blocked = 0;
+    for (int i = 0; i < count; i++)
+    {
+        if (traceShadowRay(scene, lights[i], shadowRays[i], maxDistances[i])) blocked |= 1 << i;
+    }
+    return blocked;
+}
+
+Ray makeShadowRay(Vector point, Vector lightDirection)
+{
+    // Apply a small offset to prevent self-shadowing artifacts (avoid floating-point errors)
+    Vector offset = multiplyVector(lightDirection, EPSILON);
+
+    // The shadow ray starts just above the surface and points toward the light
+    return (Ray){addVectors(point, offset), lightDirection};
+}
+
+int isPointInShadow(Vector point, PointLight *light, Scene *scene)
+{
+    // Compute the direction from the point to the light source
+    Vector lightDirection = normalizeVector(subtractVectors(light->position, point));
+
+    // Create a shadow ray that starts just above the surface and points toward the light
+    Ray shadowRay = makeShadowRay(point, lightDirection);
+
+    // Compute the maximum possible distance the shadow ray can travel before reaching the light
+    float maxDistance = vectorLength(subtractVectors(light->position, point));
+
+    return traceShadowRay(scene, light, shadowRay, maxDistance);
+}
+
+int isPointInShadowDir(Vector point, DirectionalLight *light, Scene *scene)
+{        
+    // Create a small offset in the direction of the light to prevent self-shadowing
+    Ray shadowRay = makeShadowRay(point, light->direction);
+
+    // Directional lights are infinitely far away, so any hit blocks them
+    return traceShadowRay(scene, light, shadowRay, __FLT_MAX__);
+}
 
 int isPointInShadowSpot(Vector point, SpotLight *light, Scene *scene)
 {
@@ -269,48 +425,22 @@ int isPointInShadowSpot(Vector point, SpotLight *light, Scene *scene)
     // If the point is outside the spotlight cone, it's in shadow
     if (cosAngle < SDL_cosf(light->cutoffAngle * SDL_PI_F / 180)) return 1;
 
-    // Apply a small offset to prevent self-shadowing artifacts (avoid floating-point errors)
-    Vector offset = multiplyVector(lightDirection, EPSILON);
-    
     // Create a shadow ray that starts just above the surface and points toward the light
-    Ray shadowRay = {addVectors(point, offset), lightDirection};
+    Ray shadowRay = makeShadowRay(point, lightDirection);
 
     // Compute the maximum possible distance the shadow ray can travel before reaching the light
     float maxDistance = vectorLength(subtractVectors(light->position, point));
 
-    float distance; // Variable to store the intersection distance
-
-    // Check for intersection with all spheres in the scene
-    for (int i = 0; i < scene->objects.sphereCount; i++)
-    {
-        // If the shadow ray hits a sphere and the hit is before the light, the point is in shadow
-        if (intersectRaySphere(shadowRay, scene->objects.spheres[i], &distance) && 
-            distance > 0 && distance < maxDistance) 
-        {
-            return 1; // The point is in shadow
-        }
-    }
-
-    // Check for intersection with all planes in the scene
-    for (int i = 0; i < scene->objects.planeCount; i++)
-    {
-        if (intersectRayPlane(shadowRay, scene->objects.planes[i], &distance) && 
-            distance > 0 && distance < maxDistance) 
-        {
-            return 1; // The point is in shadow
-        }
-    }
+    return traceShadowRay(scene, light, shadowRay, maxDistance);
+}
 
-    // Check for intersection with all triangles in the scene
-    for (int i = 0; i < scene->objects.triangleCount; i++)
-    {
-        if (intersectRayTriangle(shadowRay, scene->objects.triangles[i], &distance) && 
-            distance > 0 && distance < maxDistance) 
-        {
-            return 1; // The point is in shadow
-        }
-    }
+ShadowCacheStats getShadowCacheStats(void)
+{
+    return shadowCacheStats;
+}
 
-    // If no object is blocking the light, the point is fully illuminated
-    return 0;
+void resetShadowCacheStats(void)
+{
+    shadowCacheStats.hits = 0;
+    shadowCacheStats.misses = 0;
 }
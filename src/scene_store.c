@@ -0,0 +1,282 @@
+#include "scene_store.h"
+#include "bvh.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// Edits that add objects (and so need a new BVH) come first in SceneEditType, then edits that move them
+#define SCENE_EDIT_LAST_ADDITION SCENE_EDIT_ADD_TRIANGLE
+#define SCENE_EDIT_LAST_GEOMETRY SCENE_EDIT_MOVE_TRIANGLE
+
+int initSceneStore(SceneStore* store, Scene* scene)
+{
+    *store = (SceneStore){0};
+    store->commitMutex = SDL_CreateMutex();
+    SceneVersion* version = malloc(sizeof(SceneVersion));
+    if (store->commitMutex == NULL || version == NULL)
+    {
+        printf("Error in creating scene store: Memory allocation failed!\n");
+        SDL_DestroyMutex(store->commitMutex);
+        free(version);
+        store->commitMutex = NULL;
+        return 0;
+    }
+
+    version->scene = *scene;
+    version->number = 1;
+    version->bvhOwner = version;
+    version->store = store;
+    SDL_SetAtomicInt(&version->references, 1);
+    updateSceneBVH(&version->scene); // Readers must never have to build anything
+    updateSceneLightStructures(&version->scene);
+
+    store->current = version;
+    SDL_SetAtomicInt(&store->liveVersions, 1);
+    return 1;
+}
+
+void freeSceneStore(SceneStore* store)
+{
+    if (store->current != NULL)
+    {
+        releaseSceneVersion(store->current);
+        store->current = NULL;
+    }
+    free(store->edits);
+    store->edits = NULL;
+    store->editCount = 0;
+    store->editCapacity = 0;
+    freeBVH(SDL_SetAtomicPointer((void**)&store->spareBVH, NULL));
+    SDL_DestroyMutex(store->commitMutex);
+    store->commitMutex = NULL;
+}
+
+int queueSceneEdit(SceneStore* store, const SceneEdit* edit)
+{
+    int queued = 1;
+    SDL_LockSpinlock(&store->editLock);
+    if (store->editCount == store->editCapacity)
+    {
+        int capacity = store->editCapacity > 0 ? store->editCapacity * 2 : 16;
+        SceneEdit* edits = realloc(store->edits, sizeof(SceneEdit) * capacity);
+        if (edits != NULL)
+        {
+            store->edits = edits;
+            store->editCapacity = capacity;
+        }
+    }
+    if (store->editCount < store->editCapacity)
+    {
+        store->edits[store->editCount++] = *edit;
+    }
+    else
+    {
+        queued = 0;
+    }
+    SDL_UnlockSpinlock(&store->editLock);
+
+    if (!queued)
+    {
+        printf("Error in queueing scene edit: Memory allocation failed!\n");
+    }
+    return queued;
+}
+
+// Helper function that applies one edit through the scene function it stands for
+static void applySceneEdit(Scene* scene, const SceneEdit* edit)
+{
+    switch (edit->type)
+    {
+        case SCENE_EDIT_ADD_SPHERE:
+            addSphere(scene, edit->sphere.position, edit->sphere.radius, edit->sphere.material);
+            break;
+        case SCENE_EDIT_ADD_PLANE:
+            addPlane(scene, edit->plane.position, edit->plane.normal, edit->plane.width, edit->plane.height, edit->plane.material);
+            break;
+        case SCENE_EDIT_ADD_TRIANGLE:
+            addTriangle(scene, edit->triangle.v1, edit->triangle.v2, edit->triangle.v3, edit->triangle.material);
+            break;
+        case SCENE_EDIT_MOVE_SPHERE:
+            moveSphere(scene, edit->moveSphere.index, edit->moveSphere.position);
+            break;
+        case SCENE_EDIT_MOVE_TRIANGLE:
+            moveTriangle(scene, edit->moveTriangle.index, edit->moveTriangle.v1, edit->moveTriangle.v2, edit->moveTriangle.v3);
+            break;
+        case SCENE_EDIT_ADD_POINT_LIGHT:
+            addPointLight(scene, edit->pointLight.material, edit->pointLight.position, edit->pointLight.range);
+            break;
+        case SCENE_EDIT_ADD_DIRECTIONAL_LIGHT:
+            addDirectionalLight(scene, edit->directionalLight.material, edit->directionalLight.position, edit->directionalLight.direction);
+            break;
+        case SCENE_EDIT_ADD_SPOT_LIGHT:
+            addSpotLight(scene, edit->spotLight.material, edit->spotLight.position, edit->spotLight.direction,
+                         edit->spotLight.cutOffAngle, edit->spotLight.innerCutoffAngle);
+            break;
+        case SCENE_EDIT_SET_AMBIENT_LIGHT:
+            setAmbientLight(scene, edit->ambientLight);
+            break;
+        case SCENE_EDIT_MOVE_POINT_LIGHT:
+            movePointLight(scene, edit->movePointLight.index, edit->movePointLight.position);
+            break;
+    }
+}
+
+// Helper function that copies a version's scene into a new version with room for the edits, applies them
+// and builds what they invalidated; returns NULL (after printing an error) when memory runs out
+static SceneVersion* createSceneVersion(SceneVersion* base, const SceneEdit* edits, int editCount)
+{
+    const Scene* source = &base->scene;
+    int added[SCENE_EDIT_ADD_SPOT_LIGHT + 1] = {0};
+    int objectsAdded = 0;
+    int geometryEdited = 0;
+    for (int i = 0; i < editCount; i++)
+    {
+        if (edits[i].type <= SCENE_EDIT_ADD_SPOT_LIGHT) added[edits[i].type]++;
+        objectsAdded |= edits[i].type <= SCENE_EDIT_LAST_ADDITION;
+        geometryEdited |= edits[i].type <= SCENE_EDIT_LAST_GEOMETRY;
+    }
+
+    SceneVersion* version = malloc(sizeof(SceneVersion));
+    if (version == NULL)
+    {
+        printf("Error in creating scene version: Memory allocation failed!\n");
+        return NULL;
+    }
+
+    // Grow the arrays past the old limits only as far as the queued additions need
+    Scene* scene = &version->scene;
+    initScene(scene,
+              SDL_max(source->objects.maxSpheres, source->objects.sphereCount + added[SCENE_EDIT_ADD_SPHERE]),
+              SDL_max(source->objects.maxPlanes, source->objects.planeCount + added[SCENE_EDIT_ADD_PLANE]),
+              SDL_max(source->objects.maxTriangles, source->objects.triangleCount + added[SCENE_EDIT_ADD_TRIANGLE]),
+              SDL_max(source->lights.maxPointLights, source->lights.pointLightCount + added[SCENE_EDIT_ADD_POINT_LIGHT]),
+              SDL_max(source->lights.maxDirectionalLights, source->lights.directionalLightCount + added[SCENE_EDIT_ADD_DIRECTIONAL_LIGHT]),
+              SDL_max(source->lights.maxSpotLights, source->lights.spotLightCount + added[SCENE_EDIT_ADD_SPOT_LIGHT]));
+    if (scene->objects.spheres == NULL) // initScene() printed the error and freed the arrays
+    {
+        free(version);
+        return NULL;
+    }
+
+    SDL_memcpy(scene->objects.spheres, source->objects.spheres, sizeof(Sphere) * source->objects.sphereCount);
+    SDL_memcpy(scene->objects.planes, source->objects.planes, sizeof(Plane) * source->objects.planeCount);
+    SDL_memcpy(scene->objects.triangles, source->objects.triangles, sizeof(Triangle) * source->objects.triangleCount);
+    SDL_memcpy(scene->lights.pointLights, source->lights.pointLights, sizeof(PointLight) * source->lights.pointLightCount);
+    SDL_memcpy(scene->lights.directionalLights, source->lights.directionalLights, sizeof(DirectionalLight) * source->lights.directionalLightCount);
+    SDL_memcpy(scene->lights.spotLights, source->lights.spotLights, sizeof(SpotLight) * source->lights.spotLightCount);
+    scene->objects.sphereCount = source->objects.sphereCount;
+    scene->objects.planeCount = source->objects.planeCount;
+    scene->objects.triangleCount = source->objects.triangleCount;
+    scene->lights.pointLightCount = source->lights.pointLightCount;
+    scene->lights.directionalLightCount = source->lights.directionalLightCount;
+    scene->lights.spotLightCount = source->lights.spotLightCount;
+    scene->lights.ambientLight = source->lights.ambientLight;
+
+    // The edits raise the revisions further, which is how renderers notice the new version
+    scene->geometryRevision = source->geometryRevision;
+    scene->lightsRevision = source->lightsRevision;
+    for (int i = 0; i < editCount; i++)
+    {
+        applySceneEdit(scene, &edits[i]);
+    }
+
+    version->number = base->number + 1;
+    version->store = base->store;
+    SDL_SetAtomicInt(&version->references, 1);
+    if (geometryEdited)
+    {
+        // Moves keep the tree's shape: refit the spare tree of a freed version, or a copy of the base's when
+        // there is none, which costs O(n) instead of a full build. Objects are never removed, so a spare with
+        // fewer objects was built before an addition and can never be refit again.
+        BVHNode* spare = SDL_SetAtomicPointer((void**)&version->store->spareBVH, NULL);
+        int objectCount = scene->objects.sphereCount + scene->objects.planeCount + scene->objects.triangleCount;
+        if (spare != NULL && (objectsAdded || countBVHObjects(spare) != objectCount))
+        {
+            freeBVH(spare);
+            spare = NULL;
+        }
+        scene->bvhRoot = objectsAdded ? NULL : spare != NULL ? spare : copyBVH(source->bvhRoot);
+        if (scene->bvhRoot != NULL)
+        {
+            refitBVH(scene->bvhRoot, &scene->objects);
+            rebuildDegradedBVH(scene->bvhRoot, BVH_REBUILD_COST_RATIO);
+        }
+        else
+        {
+            scene->bvhRoot = buildBVH(&scene->objects);
+        }
+        version->bvhOwner = version;
+    }
+    else
+    {
+        // Only lights changed: trace the base's BVH and keep its owner alive as long as this version
+        scene->bvhRoot = source->bvhRoot;
+        version->bvhOwner = base->bvhOwner;
+        SDL_AddAtomicInt(&version->bvhOwner->references, 1);
+    }
+    scene->bvhRevision = scene->geometryRevision; // Keeps renderFrame() from refitting a BVH other versions trace
+    updateSceneLightStructures(scene);
+    SDL_AddAtomicInt(&version->store->liveVersions, 1);
+    return version;
+}
+
+int commitSceneEdits(SceneStore* store)
+{
+    SDL_LockMutex(store->commitMutex);
+
+    // Take the queue as it is; edits queued from now on go to the next commit
+    SDL_LockSpinlock(&store->editLock);
+    SceneEdit* edits = store->edits;
+    int editCount = store->editCount;
+    store->edits = NULL;
+    store->editCount = 0;
+    store->editCapacity = 0;
+    SDL_UnlockSpinlock(&store->editLock);
+
+    // Only commits replace 'current', so it can be read without the reader lock here
+    SceneVersion* version = editCount > 0 ? createSceneVersion(store->current, edits, editCount) : NULL;
+    free(edits);
+    if (version != NULL)
+    {
+        SDL_LockSpinlock(&store->currentLock);
+        SceneVersion* previous = store->current;
+        store->current = version;
+        SDL_UnlockSpinlock(&store->currentLock);
+
+        // Frames still tracing the previous version hold their own references
+        releaseSceneVersion(previous);
+    }
+
+    SDL_UnlockMutex(store->commitMutex);
+    return version != NULL;
+}
+
+SceneVersion* acquireSceneVersion(SceneStore* store)
+{
+    SDL_LockSpinlock(&store->currentLock);
+    SceneVersion* version = store->current;
+    SDL_AddAtomicInt(&version->references, 1);
+    SDL_UnlockSpinlock(&store->currentLock);
+    return version;
+}
+
+void releaseSceneVersion(SceneVersion* version)
+{
+    if (SDL_AddAtomicInt(&version->references, -1) != 1) return;
+
+    SceneStore* store = version->store;
+    SceneVersion* bvhOwner = version->bvhOwner != version ? version->bvhOwner : NULL;
+    if (bvhOwner == NULL && !SDL_CompareAndSwapAtomicPointer((void**)&store->spareBVH, NULL, version->scene.bvhRoot))
+    {
+        freeBVH(version->scene.bvhRoot); // A spare is already waiting for the next move
+    }
+    version->scene.bvhRoot = NULL;
+    freeScene(&version->scene);
+    free(version);
+    SDL_AddAtomicInt(&store->liveVersions, -1);
+
+    if (bvhOwner != NULL)
+    {
+        releaseSceneVersion(bvhOwner);
+    }
+}
@@ -0,0 +1,243 @@
+#include "tile_order.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// Helper function that spreads the low 16 bits of a value so there is a zero bit between each of them
+static Uint32 spreadBits(Uint32 value)
+{
+    value &= 0x0000FFFFu;
+    value = (value | (value << 8)) & 0x00FF00FFu;
+    value = (value | (value << 4)) & 0x0F0F0F0Fu;
+    value = (value | (value << 2)) & 0x33333333u;
+    value = (value | (value << 1)) & 0x55555555u;
+    return value;
+}
+
+Uint32 mortonIndex(Uint32 x, Uint32 y)
+{
+    return spreadBits(x) | (spreadBits(y) << 1);
+}
+
+Uint32 hilbertIndex(Uint32 gridSize, Uint32 x, Uint32 y)
+{
+    Uint32 index = 0;
+    for (Uint32 s = gridSize / 2; s > 0; s /= 2)
+    {
+        Uint32 rx = (x & s) > 0;
+        Uint32 ry = (y & s) > 0;
+        index += s * s * ((3 * rx) ^ ry);
+
+        // Rotate the quadrant so the curve inside it starts and ends at the right corners
+        if (ry == 0)
+        {
+            if (rx == 1)
+            {
+                x = s - 1 - x;
+                y = s - 1 - y;
+            }
+            Uint32 temp = x;
+            x = y;
+            y = temp;
+        }
+    }
+    return index;
+}
+
+// Tile together with its position along the chosen curve
+typedef struct {
+    Uint32 key;
+    Tile tile;
+} KeyedTile;
+
+// Comparison function for sorting tiles along the curve
+static int compareKeyedTiles(const void* a, const void* b)
+{
+    Uint32 keyA = ((const KeyedTile*)a)->key;
+    Uint32 keyB = ((const KeyedTile*)b)->key;
+    return (keyA > keyB) - (keyA < keyB);
+}
+
+void buildTileSchedule(TileSchedule* schedule, int width, int height, int tileSize, TileOrder order)
+{
+    int tilesX = (width + tileSize - 1) / tileSize;
+    int tilesY = (height + tileSize - 1) / tileSize;
+
+    schedule->tileSize = tileSize;
+    schedule->order = order;
+    schedule->count = 0;
+    schedule->width = width;
+    schedule->height = height;
+    schedule->tilesX = tilesX;
+    schedule->tilesY = tilesY;
+
+    // Splitting hot tiles turns one tile into up to four
+    int tileCapacity = order == TILE_ORDER_COST ? 4 * tilesX * tilesY : tilesX * tilesY;
+    schedule->tiles = malloc(sizeof(Tile) * tileCapacity);
+    schedule->tileCost = calloc((size_t)tileCapacity, sizeof(Uint64));
+    schedule->cellCost = malloc(sizeof(Uint64) * tilesX * tilesY);
+    KeyedTile* keyed = malloc(sizeof(KeyedTile) * tilesX * tilesY);
+    if (!schedule->tiles || !schedule->tileCost || !schedule->cellCost || !keyed)
+    {
+        printf("Error in creating tile schedule: Memory allocation failed!\n");
+        free(schedule->tiles);
+        free(schedule->tileCost);
+        free(schedule->cellCost);
+        free(keyed);
+        schedule->tiles = NULL;
+        schedule->tileCost = NULL;
+        schedule->cellCost = NULL;
+        return;
+    }
+
+    // The space-filling curves cover the smallest power-of-two grid around the tiles
+    Uint32 gridSize = 1;
+    while (gridSize < (Uint32)tilesX || gridSize < (Uint32)tilesY)
+    {
+        gridSize *= 2;
+    }
+
+    for (int ty = 0; ty < tilesY; ty++)
+    {
+        for (int tx = 0; tx < tilesX; tx++)
+        {
+            KeyedTile* entry = &keyed[ty * tilesX + tx];
+            entry->tile.x = tx * tileSize;
+            entry->tile.y = ty * tileSize;
+            entry->tile.width = SDL_min(tileSize, width - entry->tile.x);
+            entry->tile.height = SDL_min(tileSize, height - entry->tile.y);
+
+            switch (order)
+            {
+                case TILE_ORDER_MORTON:
+                    entry->key = mortonIndex(tx, ty);
+                    break;
+                case TILE_ORDER_HILBERT:
+                case TILE_ORDER_COST:
+                    entry->key = hilbertIndex(gridSize, tx, ty);
+                    break;
+                default:
+                    entry->key = (Uint32)(ty * tilesX + tx);
+                    break;
+            }
+        }
+    }
+
+    qsort(keyed, tilesX * tilesY, sizeof(KeyedTile), compareKeyedTiles);
+
+    for (int i = 0; i < tilesX * tilesY; i++)
+    {
+        schedule->tiles[i] = keyed[i].tile;
+    }
+    schedule->count = tilesX * tilesY;
+
+    free(keyed);
+}
+
+void recordTileCost(TileSchedule* schedule, int tileIndex, Uint64 ticks)
+{
+    if (schedule->tileCost != NULL)
+    {
+        schedule->tileCost[tileIndex] = ticks;
+    }
+}
+
+// Tile with the cost it is expected to take and its position in the previous order
+typedef struct {
+    Uint64 cost;
+    int position;
+    Tile tile;
+} CostedTile;
+
+// Comparison function for sorting tiles by cost, largest first; equal costs keep their previous order
+static int compareCostedTiles(const void* a, const void* b)
+{
+    const CostedTile* tileA = (const CostedTile*)a;
+    const CostedTile* tileB = (const CostedTile*)b;
+    if (tileA->cost != tileB->cost) return tileA->cost < tileB->cost ? 1 : -1;
+    return (tileA->position > tileB->position) - (tileA->position < tileB->position);
+}
+
+void scheduleTilesByCost(TileSchedule* schedule, Arena* scratch)
+{
+    if (schedule->order != TILE_ORDER_COST || schedule->tiles == NULL) return;
+
+    // Add up the tiles of every grid cell (a split cell has up to four)
+    int cellCount = schedule->tilesX * schedule->tilesY;
+    int tileSize = schedule->tileSize;
+    Uint64 totalCost = 0;
+    SDL_memset(schedule->cellCost, 0, sizeof(Uint64) * cellCount);
+    for (int i = 0; i < schedule->count; i++)
+    {
+        const Tile* tile = &schedule->tiles[i];
+        schedule->cellCost[(tile->y / tileSize) * schedule->tilesX + tile->x / tileSize] += schedule->tileCost[i];
+        totalCost += schedule->tileCost[i];
+    }
+    if (totalCost == 0) return; // No tile was timed since the last call
+
+    CostedTile* costed = arenaAlloc(scratch, sizeof(CostedTile) * 4 * cellCount);
+    if (costed == NULL) return;
+    Uint64 splitCost = TILE_SPLIT_COST_FACTOR * totalCost / cellCount;
+
+    // Walk the previous order and rebuild every grid cell once, at its top-left tile
+    int count = 0;
+    int half = tileSize / 2;
+    for (int i = 0; i < schedule->count; i++)
+    {
+        Tile first = schedule->tiles[i];
+        if (first.x % tileSize != 0 || first.y % tileSize != 0) continue; // Another quadrant of a split cell
+
+        Tile cell = {first.x, first.y, SDL_min(tileSize, schedule->width - first.x), SDL_min(tileSize, schedule->height - first.y)};
+        Uint64 cost = schedule->cellCost[(cell.y / tileSize) * schedule->tilesX + cell.x / tileSize];
+        if (cost <= splitCost || half == 0)
+        {
+            costed[count] = (CostedTile){cost, count, cell};
+            count++;
+            continue;
+        }
+
+        // Hot cell: its quadrants can run in parallel, each expected to take its share of the pixels
+        for (int quadrant = 0; quadrant < 4; quadrant++)
+        {
+            int offsetX = (quadrant & 1) * half;
+            int offsetY = (quadrant >> 1) * half;
+            Tile tile = {cell.x + offsetX, cell.y + offsetY, SDL_min(half, cell.width - offsetX), SDL_min(half, cell.height - offsetY)};
+            if (tile.width <= 0 || tile.height <= 0) continue;
+            Uint64 share = cost * (Uint64)(tile.width * tile.height) / (Uint64)(cell.width * cell.height);
+            costed[count] = (CostedTile){share, count, tile};
+            count++;
+        }
+    }
+
+    qsort(costed, count, sizeof(CostedTile), compareCostedTiles);
+    for (int i = 0; i < count; i++)
+    {
+        schedule->tiles[i] = costed[i].tile;
+    }
+    schedule->count = count;
+
+    SDL_memset(schedule->tileCost, 0, sizeof(Uint64) * 4 * cellCount);
+}
+
+void freeTileSchedule(TileSchedule* schedule)
+{
+    free(schedule->tiles);
+    free(schedule->tileCost);
+    free(schedule->cellCost);
+    schedule->tiles = NULL;
+    schedule->tileCost = NULL;
+    schedule->cellCost = NULL;
+    schedule->count = 0;
+}
+
+const char* getTileOrderName(TileOrder order)
+{
+    switch (order)
+    {
+        case TILE_ORDER_SCANLINE: return "scanline";
+        case TILE_ORDER_MORTON: return "Morton";
+        case TILE_ORDER_HILBERT: return "Hilbert";
+        case TILE_ORDER_COST: return "cost (largest first)";
+        default: return "unknown";
+    }
+}
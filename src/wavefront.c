@@ -0,0 +1,618 @@
+#include "wavefront.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// Helper function that allocates the arrays of a ray queue; returns 0 when an allocation fails
+static int initRayQueue(RayQueue* queue, int capacity)
+{
+    queue->originX = malloc(sizeof(float) * capacity);
+    queue->originY = malloc(sizeof(float) * capacity);
+    queue->originZ = malloc(sizeof(float) * capacity);
+    queue->directionX = malloc(sizeof(float) * capacity);
+    queue->directionY = malloc(sizeof(float) * capacity);
+    queue->directionZ = malloc(sizeof(float) * capacity);
+    queue->weight = malloc(sizeof(float) * capacity);
+    queue->randomState = malloc(sizeof(Uint32) * capacity);
+    queue->pixel = malloc(sizeof(int) * capacity);
+    queue->count = 0;
+    queue->capacity = capacity;
+
+    return queue->originX && queue->originY && queue->originZ && queue->directionX && queue->directionY
+        && queue->directionZ && queue->weight && queue->randomState && queue->pixel;
+}
+
+static void freeRayQueue(RayQueue* queue)
+{
+    free(queue->originX);
+    free(queue->originY);
+    free(queue->originZ);
+    free(queue->directionX);
+    free(queue->directionY);
+    free(queue->directionZ);
+    free(queue->weight);
+    free(queue->randomState);
+    free(queue->pixel);
+    *queue = (RayQueue){0};
+}
+
+// Helper function that allocates the arrays of a hit queue; returns 0 when an allocation fails
+static int initHitQueue(HitQueue* queue, int capacity)
+{
+    queue->object = malloc(sizeof(void*) * capacity);
+    queue->pointX = malloc(sizeof(float) * capacity);
+    queue->pointY = malloc(sizeof(float) * capacity);
+    queue->pointZ = malloc(sizeof(float) * capacity);
+    queue->normalX = malloc(sizeof(float) * capacity);
+    queue->normalY = malloc(sizeof(float) * capacity);
+    queue->normalZ = malloc(sizeof(float) * capacity);
+    queue->material = malloc(sizeof(Material) * capacity);
+    queue->diffuse = malloc(sizeof(float) * 3 * capacity);
+    queue->specular = malloc(sizeof(float) * 3 * capacity);
+
+    return queue->object && queue->pointX && queue->pointY && queue->pointZ && queue->normalX && queue->normalY
+        && queue->normalZ && queue->material && queue->diffuse && queue->specular;
+}
+
+static void freeHitQueue(HitQueue* queue)
+{
+    free(queue->object);
+    free(queue->pointX);
+    free(queue->pointY);
+    free(queue->pointZ);
+    free(queue->normalX);
+    free(queue->normalY);
+    free(queue->normalZ);
+    free(queue->material);
+    free(queue->diffuse);
+    free(queue->specular);
+    *queue = (HitQueue){0};
+}
+
+static void freeShadowQueue(ShadowQueue* queue)
+{
+    free(queue->originX);
+    free(queue->originY);
+    free(queue->originZ);
+    free(queue->directionX);
+    free(queue->directionY);
+    free(queue->directionZ);
+    free(queue->maxDistance);
+    free(queue->light);
+    free(queue->hit);
+    free(queue->lightIndex);
+    free(queue->order);
+    free(queue->diffuse);
+    free(queue->specular);
+    *queue = (ShadowQueue){0};
+}
+
+// Helper function that makes room for at least 'capacity' shadow rays (the queue is empty when it grows).
+// Returns 0 when an allocation fails.
+static int reserveShadowQueue(ShadowQueue* queue, int capacity)
+{
+    if (capacity <= queue->capacity) return 1;
+
+    freeShadowQueue(queue);
+    queue->originX = malloc(sizeof(float) * capacity);
+    queue->originY = malloc(sizeof(float) * capacity);
+    queue->originZ = malloc(sizeof(float) * capacity);
+    queue->directionX = malloc(sizeof(float) * capacity);
+    queue->directionY = malloc(sizeof(float) * capacity);
+    queue->directionZ = malloc(sizeof(float) * capacity);
+    queue->maxDistance = malloc(sizeof(float) * capacity);
+    queue->light = malloc(sizeof(void*) * capacity);
+    queue->hit = malloc(sizeof(int) * capacity);
+    queue->lightIndex = malloc(sizeof(int) * capacity);
+    queue->order = malloc(sizeof(int) * capacity);
+    queue->diffuse = malloc(sizeof(float) * 3 * capacity);
+    queue->specular = malloc(sizeof(float) * 3 * capacity);
+    queue->capacity = capacity;
+
+    if (!queue->originX || !queue->originY || !queue->originZ || !queue->directionX || !queue->directionY || !queue->directionZ
+        || !queue->maxDistance || !queue->light || !queue->hit || !queue->lightIndex || !queue->order || !queue->diffuse || !queue->specular)
+    {
+        printf("Error in creating shadow ray queue: Memory allocation failed!\n");
+        freeShadowQueue(queue);
+        return 0;
+    }
+    return 1;
+}
+
+int initWavefrontQueues(WavefrontQueues* queues, int pathCapacity)
+{
+    *queues = (WavefrontQueues){0};
+    if (!initRayQueue(&queues->rays, pathCapacity) || !initRayQueue(&queues->nextRays, pathCapacity)
+        || !initHitQueue(&queues->hits, pathCapacity))
+    {
+        printf("Error in creating wavefront queues: Memory allocation failed!\n");
+        freeWavefrontQueues(queues);
+        return 0;
+    }
+    return 1;
+}
+
+void freeWavefrontQueues(WavefrontQueues* queues)
+{
+    freeRayQueue(&queues->rays);
+    freeRayQueue(&queues->nextRays);
+    freeHitQueue(&queues->hits);
+    freeShadowQueue(&queues->shadows);
+    free(queues->lights);
+    free(queues->lightStart);
+    queues->lights = NULL;
+    queues->lightStart = NULL;
+    queues->lightCapacity = 0;
+    queues->sortEntries = NULL;
+}
+
+// Helper function that spreads the low 10 bits of a value so there are two zero bits between each of them
+static Uint32 spreadBits3(Uint32 value)
+{
+    value &= 0x000003FFu;
+    value = (value | (value << 16)) & 0x030000FFu;
+    value = (value | (value << 8)) & 0x0300F00Fu;
+    value = (value | (value << 4)) & 0x030C30C3u;
+    value = (value | (value << 2)) & 0x09249249u;
+    return value;
+}
+
+// Helper function that maps a coordinate to one of 2^9 cells along an axis of the bounds
+static Uint32 cellCoordinate(float value, float low, float high)
+{
+    float extent = high - low;
+    if (!(extent > 0.0f)) return 0;
+    return (Uint32)SDL_clamp((value - low) / extent * 511.0f, 0.0f, 511.0f);
+}
+
+Uint32 rayBinKey(Vector origin, Vector direction, const AABB* bounds)
+{
+    // 3 octant bits above a 27-bit Morton index of the origin cell
+    Uint32 octant = (direction.x < 0.0f) | ((direction.y < 0.0f) << 1) | ((direction.z < 0.0f) << 2);
+    Uint32 cell = spreadBits3(cellCoordinate(origin.x, bounds->min.x, bounds->max.x))
+                | (spreadBits3(cellCoordinate(origin.y, bounds->min.y, bounds->max.y)) << 1)
+                | (spreadBits3(cellCoordinate(origin.z, bounds->min.z, bounds->max.z)) << 2);
+    return (octant << 27) | cell;
+}
+
+// Bits of the key sorted by one radix pass; three passes cover the 30-bit keys
+#define RAY_SORT_RADIX_BITS 10
+
+// Helper function that sorts entries by key with a stable LSD radix sort, using 'scratch' (count entries) as the second buffer
+static void radixSortRayEntries(RaySortEntry* entries, RaySortEntry* scratch, int count)
+{
+    int offsets[1 << RAY_SORT_RADIX_BITS];
+    for (int shift = 0; shift < 30; shift += RAY_SORT_RADIX_BITS)
+    {
+        SDL_memset(offsets, 0, sizeof(offsets));
+        for (int i = 0; i < count; i++)
+        {
+            offsets[(entries[i].key >> shift) & ((1 << RAY_SORT_RADIX_BITS) - 1)]++;
+        }
+
+        // Turn the digit counts into the first output position of each digit
+        int position = 0;
+        for (int digit = 0; digit < (1 << RAY_SORT_RADIX_BITS); digit++)
+        {
+            int digitCount = offsets[digit];
+            offsets[digit] = position;
+            position += digitCount;
+        }
+
+        for (int i = 0; i < count; i++)
+        {
+            scratch[offsets[(entries[i].key >> shift) & ((1 << RAY_SORT_RADIX_BITS) - 1)]++] = entries[i];
+        }
+
+        RaySortEntry* swap = entries;
+        entries = scratch;
+        scratch = swap;
+    }
+
+    // An odd number of passes leaves the result in the scratch buffer
+    if ((30 / RAY_SORT_RADIX_BITS) % 2 == 1)
+    {
+        SDL_memcpy(scratch, entries, sizeof(RaySortEntry) * count);
+    }
+}
+
+// Helper function that fills the sort entries for 'count' rays given as SoA arrays and sorts them in
+// batches of batchSize, in the scratch arena. Returns 0 (leaving the rays in queue order) when the entries cannot be allocated.
+static int sortRayBatches(WavefrontQueues* queues, const float* originX, const float* originY, const float* originZ,
+                          const float* directionX, const float* directionY, const float* directionZ, int count, int batchSize, const AABB* bounds)
+{
+    queues->sortEntries = arenaAlloc(queues->scratch, sizeof(RaySortEntry) * 2 * count); // Second half is the radix sort buffer
+    if (queues->sortEntries == NULL) return 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        Vector origin = {originX[i], originY[i], originZ[i]};
+        Vector direction = {directionX[i], directionY[i], directionZ[i]};
+        queues->sortEntries[i] = (RaySortEntry){rayBinKey(origin, direction, bounds), i};
+    }
+    for (int first = 0; first < count; first += batchSize)
+    {
+        radixSortRayEntries(&queues->sortEntries[first], &queues->sortEntries[count + first], SDL_min(batchSize, count - first));
+    }
+    return 1;
+}
+
+// Helper function that reads ray i of a queue
+static Ray readQueuedRay(const RayQueue* queue, int i)
+{
+    return (Ray){{queue->originX[i], queue->originY[i], queue->originZ[i]}, {queue->directionX[i], queue->directionY[i], queue->directionZ[i]}};
+}
+
+// Generate stage: the center rays of the tile become the first bounce, and the tile's pixels start black
+static void generateStage(TileWorker* worker, RenderState* state, const Tile* tile, const RayGenerator* rayGenerator)
+{
+    RayQueue* rays = &worker->wavefront->rays;
+    FrameBuffer* frameBuffer = &state->frameBuffer;
+    generateRayTile(rayGenerator, tile->x, tile->y, tile->width, tile->height, worker->tileRays);
+
+    rays->count = 0;
+    for (int row = 0; row < tile->height; row++)
+    {
+        int y = tile->y + row;
+        for (int column = 0; column < tile->width; column++)
+        {
+            int x = tile->x + column;
+            int index = y * frameBuffer->width + x;
+            Ray ray = worker->tileRays[row * tile->width + column];
+
+            int i = rays->count++;
+            rays->originX[i] = ray.origin.x;
+            rays->originY[i] = ray.origin.y;
+            rays->originZ[i] = ray.origin.z;
+            rays->directionX[i] = ray.direction.x;
+            rays->directionY[i] = ray.direction.y;
+            rays->directionZ[i] = ray.direction.z;
+            rays->weight[i] = 1.0f;
+            rays->randomState[i] = pixelSeed(x, y, state->frameIndex);
+            rays->pixel[i] = index;
+
+            frameBuffer->red[index] = 0.0f;
+            frameBuffer->green[index] = 0.0f;
+            frameBuffer->blue[index] = 0.0f;
+        }
+    }
+}
+
+// Extend stage: finds the closest hit of every queued ray among the objects below the given BVH nodes
+static void extendStage(WavefrontQueues* queues, BVHNode* const* nodes, int nodeCount)
+{
+    RayQueue* rays = &queues->rays;
+    HitQueue* hits = &queues->hits;
+
+    for (int i = 0; i < rays->count; i++)
+    {
+        ObjectIntersection hit;
+        if (!intersectBVHNodes(readQueuedRay(rays, i), nodes, nodeCount, &hit) || hit.objectType < 0)
+        {
+            hits->object[i] = NULL;
+            continue;
+        }
+
+        hits->object[i] = hit.object;
+        hits->pointX[i] = hit.point.x;
+        hits->pointY[i] = hit.point.y;
+        hits->pointZ[i] = hit.point.z;
+        hits->normalX[i] = hit.normal.x;
+        hits->normalY[i] = hit.normal.y;
+        hits->normalZ[i] = hit.normal.z;
+        hits->material[i] = hit.material;
+    }
+}
+
+// Helper function that stores the primary hits in the G-buffer; misses become a far point along the ray
+static void storePrimaryHits(WavefrontQueues* queues, RenderState* state)
+{
+    RayQueue* rays = &queues->rays;
+    HitQueue* hits = &queues->hits;
+    if (state->gBuffer.object == NULL) return;
+
+    for (int i = 0; i < rays->count; i++)
+    {
+        PixelHit pixelHit;
+        if (hits->object[i] != NULL)
+        {
+            pixelHit = (PixelHit){hits->object[i], {hits->pointX[i], hits->pointY[i], hits->pointZ[i]},
+                                  {hits->normalX[i], hits->normalY[i], hits->normalZ[i]}, hits->material[i]};
+        }
+        else
+        {
+            Ray ray = readQueuedRay(rays, i);
+            pixelHit = (PixelHit){NULL, addVectors(ray.origin, multiplyVector(ray.direction, BACKGROUND_DISTANCE)), {0.0f, 0.0f, 0.0f}, {{0, 0, 0, 0}, 0, 0}};
+        }
+        writeGBufferHit(&state->gBuffer, rays->pixel[i], &pixelHit);
+    }
+}
+
+// Shade stage: queues a shadow ray for every light that would reach a hit, and clears the light the hit received
+static void shadeStage(WavefrontQueues* queues, Scene* scene)
+{
+    RayQueue* rays = &queues->rays;
+    HitQueue* hits = &queues->hits;
+    ShadowQueue* shadows = &queues->shadows;
+    shadows->count = 0;
+
+    int lightCount = scene->lights.pointLightCount + scene->lights.spotLightCount + scene->lights.directionalLightCount;
+    if (lightCount > queues->lightCapacity)
+    {
+        free(queues->lights);
+        free(queues->lightStart);
+        queues->lights = malloc(sizeof(LightContribution) * lightCount);
+        queues->lightStart = malloc(sizeof(int) * (lightCount + 1));
+        queues->lightCapacity = queues->lights && queues->lightStart ? lightCount : 0;
+    }
+    if (!reserveShadowQueue(shadows, rays->count * lightCount) || queues->lightCapacity < lightCount) lightCount = 0;
+
+    for (int i = 0; i < rays->count; i++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            hits->diffuse[3 * i + c] = 0.0f;
+            hits->specular[3 * i + c] = 0.0f;
+        }
+        if (hits->object[i] == NULL) continue;
+
+        Vector point = {hits->pointX[i], hits->pointY[i], hits->pointZ[i]};
+        Vector normal = {hits->normalX[i], hits->normalY[i], hits->normalZ[i]};
+        Vector viewDirection = {rays->directionX[i], rays->directionY[i], rays->directionZ[i]};
+        int count = computeLightContributions(scene, point, normal, viewDirection, hits->material[i].shininess, queues->lights, lightCount);
+
+        for (int light = 0; light < count; light++)
+        {
+            LightContribution* contribution = &queues->lights[light];
+            int s = shadows->count++;
+            shadows->originX[s] = contribution->shadowRay.origin.x;
+            shadows->originY[s] = contribution->shadowRay.origin.y;
+            shadows->originZ[s] = contribution->shadowRay.origin.z;
+            shadows->directionX[s] = contribution->shadowRay.direction.x;
+            shadows->directionY[s] = contribution->shadowRay.direction.y;
+            shadows->directionZ[s] = contribution->shadowRay.direction.z;
+            shadows->maxDistance[s] = contribution->maxDistance;
+            shadows->light[s] = contribution->light;
+            shadows->lightIndex[s] = contribution->lightIndex;
+            shadows->hit[s] = i;
+            for (int c = 0; c < 3; c++)
+            {
+                shadows->diffuse[3 * s + c] = contribution->diffuse[c];
+                shadows->specular[3 * s + c] = contribution->specular[c];
+            }
+        }
+    }
+}
+
+// Helper function that adds the light a shadow ray carries to its hit
+static void addUnblockedLight(WavefrontQueues* queues, int s)
+{
+    ShadowQueue* shadows = &queues->shadows;
+    HitQueue* hits = &queues->hits;
+    int hit = shadows->hit[s];
+    for (int c = 0; c < 3; c++)
+    {
+        hits->diffuse[3 * hit + c] += shadows->diffuse[3 * s + c];
+        hits->specular[3 * hit + c] += shadows->specular[3 * s + c];
+    }
+}
+
+// Helper function that traces the shadow rays light by light, SIMD_LANES rays of the same light per packet.
+// shadows->order lists the rays grouped by light and lightStart[light] where each light's rays end.
+static void traceShadowPackets(WavefrontQueues* queues, RenderStats* stats, Scene* scene, int lightCount)
+{
+    ShadowQueue* shadows = &queues->shadows;
+    int first = 0;
+    for (int light = 0; light < lightCount; light++)
+    {
+        int end = queues->lightStart[light];
+        for (; first < end; first += SIMD_LANES)
+        {
+            int count = SDL_min(SIMD_LANES, end - first);
+            Ray rays[SIMD_LANES];
+            float maxDistances[SIMD_LANES];
+            for (int lane = 0; lane < count; lane++)
+            {
+                int s = shadows->order[first + lane];
+                rays[lane] = (Ray){{shadows->originX[s], shadows->originY[s], shadows->originZ[s]},
+                                   {shadows->directionX[s], shadows->directionY[s], shadows->directionZ[s]}};
+                maxDistances[lane] = shadows->maxDistance[s];
+            }
+
+            int blocked = traceShadowPacketBVH(scene->bvhRoot, rays, maxDistances, count);
+            for (int lane = 0; lane < count; lane++)
+            {
+                if (!((blocked >> lane) & 1)) addUnblockedLight(queues, shadows->order[first + lane]);
+            }
+            stats->shadowPackets++;
+        }
+        first = end;
+    }
+    stats->shadowRays += (Uint64)shadows->count;
+}
+
+// Occlusion stage: traces every queued shadow ray and adds the light of the unblocked ones to their hits.
+// With sorting on, the rays are traced in bin order instead of the order they were shaded in; with packets
+// on, they are grouped by light (keeping that order within each light) and traced through the BVH.
+static void occlusionStage(WavefrontQueues* queues, RenderStats* stats, Scene* scene, RenderSettings* settings)
+{
+    ShadowQueue* shadows = &queues->shadows;
+    if (shadows->count == 0) return;
+
+    int sorted = settings->raySortBatch > 0 && scene->bvhRoot != NULL
+        && sortRayBatches(queues, shadows->originX, shadows->originY, shadows->originZ, shadows->directionX, shadows->directionY,
+                          shadows->directionZ, shadows->count, settings->raySortBatch, &scene->bvhRoot->bounds);
+
+    if (settings->shadowPackets && scene->bvhRoot != NULL)
+    {
+        // Stable counting sort by light; lightStart ends up holding where each light's rays end
+        int lightCount = scene->lights.pointLightCount + scene->lights.spotLightCount + scene->lights.directionalLightCount;
+        int* lightStart = queues->lightStart;
+        SDL_memset(lightStart, 0, sizeof(int) * (lightCount + 1));
+        for (int s = 0; s < shadows->count; s++)
+        {
+            lightStart[shadows->lightIndex[s] + 1]++;
+        }
+        for (int light = 0; light < lightCount; light++)
+        {
+            lightStart[light + 1] += lightStart[light];
+        }
+        for (int k = 0; k < shadows->count; k++)
+        {
+            int s = sorted ? queues->sortEntries[k].index : k;
+            shadows->order[lightStart[shadows->lightIndex[s]]++] = s;
+        }
+
+        traceShadowPackets(queues, stats, scene, lightCount);
+        return;
+    }
+
+    for (int k = 0; k < shadows->count; k++)
+    {
+        int s = sorted ? queues->sortEntries[k].index : k;
+        Ray shadowRay = {{shadows->originX[s], shadows->originY[s], shadows->originZ[s]},
+                         {shadows->directionX[s], shadows->directionY[s], shadows->directionZ[s]}};
+        if (!traceShadowRay(scene, shadows->light[s], shadowRay, shadows->maxDistance[s]))
+        {
+            addUnblockedLight(queues, s);
+        }
+    }
+}
+
+// Accumulate stage: turns the light each hit received into its color and adds it, weighted, to the pixel
+static void accumulateStage(WavefrontQueues* queues, RenderState* state, Scene* scene)
+{
+    RayQueue* rays = &queues->rays;
+    HitQueue* hits = &queues->hits;
+    FrameBuffer* frameBuffer = &state->frameBuffer;
+
+    for (int i = 0; i < rays->count; i++)
+    {
+        if (hits->object[i] == NULL) continue;
+
+        FloatColor color = combineLightContributions(scene, hits->material[i], &hits->diffuse[3 * i], &hits->specular[3 * i]);
+        int pixel = rays->pixel[i];
+        frameBuffer->red[pixel] += rays->weight[i] * color.r;
+        frameBuffer->green[pixel] += rays->weight[i] * color.g;
+        frameBuffer->blue[pixel] += rays->weight[i] * color.b;
+    }
+}
+
+// Continue stage: spawns the mirror reflection of every hit whose path goes on, with the same termination
+// rules as the depth-first renderer, and counts the paths that end at this bounce
+static void continueStage(WavefrontQueues* queues, RenderSettings* settings, int bounces)
+{
+    RayQueue* rays = &queues->rays;
+    RayQueue* next = &queues->nextRays;
+    HitQueue* hits = &queues->hits;
+    int maxBounces = SDL_min(settings->maxBounces, MAX_REFLECTION_BOUNCES);
+
+    next->count = 0;
+    for (int i = 0; i < rays->count; i++)
+    {
+        if (hits->object[i] == NULL)
+        {
+            // A primary miss shows the background and is not a shaded path
+            if (bounces > 0) countPathBounces(bounces);
+            continue;
+        }
+
+        float throughput = rays->weight[i] * hits->material[i].reflectivity;
+        Uint32 randomState = rays->randomState[i];
+        int continues = bounces < maxBounces && throughput >= MIN_PATH_THROUGHPUT;
+        if (continues && bounces >= RUSSIAN_ROULETTE_DEPTH)
+        {
+            // Continue with probability equal to the throughput and compensate the survivors
+            float survival = SDL_min(throughput, 1.0f);
+            continues = randomFloat(&randomState) < survival;
+            throughput /= survival;
+        }
+        if (!continues)
+        {
+            countPathBounces(bounces);
+            continue;
+        }
+
+        // Mirror the incoming direction around the normal; the start is nudged off the surface
+        Vector direction = {rays->directionX[i], rays->directionY[i], rays->directionZ[i]};
+        Vector normal = {hits->normalX[i], hits->normalY[i], hits->normalZ[i]};
+        direction = subtractVectors(direction, multiplyVector(normal, 2.0f * dotProduct(direction, normal)));
+        Vector origin = addVectors((Vector){hits->pointX[i], hits->pointY[i], hits->pointZ[i]}, multiplyVector(direction, REFLECTION_RAY_OFFSET));
+
+        int n = next->count++;
+        next->originX[n] = origin.x;
+        next->originY[n] = origin.y;
+        next->originZ[n] = origin.z;
+        next->directionX[n] = direction.x;
+        next->directionY[n] = direction.y;
+        next->directionZ[n] = direction.z;
+        next->weight[n] = throughput;
+        next->randomState[n] = randomState;
+        next->pixel[n] = rays->pixel[i];
+    }
+
+    // The reflection rays are the next bounce
+    RayQueue swap = queues->rays;
+    queues->rays = queues->nextRays;
+    queues->nextRays = swap;
+}
+
+// Helper function that reorders the rays of the next bounce by bin, so the extend stage walks the BVH with
+// neighbouring rays one after the other
+static void sortReflectionRays(WavefrontQueues* queues, Scene* scene, RenderSettings* settings)
+{
+    RayQueue* rays = &queues->rays;
+    RayQueue* sorted = &queues->nextRays;
+    if (settings->raySortBatch <= 0 || scene->bvhRoot == NULL || rays->count < 2) return;
+    if (!sortRayBatches(queues, rays->originX, rays->originY, rays->originZ, rays->directionX, rays->directionY,
+                        rays->directionZ, rays->count, settings->raySortBatch, &scene->bvhRoot->bounds)) return;
+
+    for (int k = 0; k < rays->count; k++)
+    {
+        int i = queues->sortEntries[k].index;
+        sorted->originX[k] = rays->originX[i];
+        sorted->originY[k] = rays->originY[i];
+        sorted->originZ[k] = rays->originZ[i];
+        sorted->directionX[k] = rays->directionX[i];
+        sorted->directionY[k] = rays->directionY[i];
+        sorted->directionZ[k] = rays->directionZ[i];
+        sorted->weight[k] = rays->weight[i];
+        sorted->randomState[k] = rays->randomState[i];
+        sorted->pixel[k] = rays->pixel[i];
+    }
+    sorted->count = rays->count;
+
+    RayQueue swap = queues->rays;
+    queues->rays = queues->nextRays;
+    queues->nextRays = swap;
+}
+
+void renderTileWavefront(TileWorker* worker, RenderState* state, const Tile* tile, const RayGenerator* rayGenerator, Scene* scene, RenderSettings* settings)
+{
+    WavefrontQueues* queues = worker->wavefront;
+    queues->scratch = &worker->scratch;
+    generateStage(worker, state, tile, rayGenerator);
+    worker->stats.primaryRays += (Uint64)queues->rays.count;
+
+    // Primary rays only traverse the subtrees inside the tile's frustum, reflections the whole tree
+    BVHNode* tileNodes[BVH_FRUSTUM_MAX_NODES];
+    int tileNodeCount = cullTileBVH(rayGenerator, tile, scene->bvhRoot, tileNodes);
+
+    for (int bounces = 0; queues->rays.count > 0; bounces++)
+    {
+        if (bounces == 0)
+        {
+            extendStage(queues, tileNodes, tileNodeCount);
+            storePrimaryHits(queues, state);
+        }
+        else
+        {
+            extendStage(queues, &scene->bvhRoot, scene->bvhRoot != NULL);
+        }
+        shadeStage(queues, scene);
+        occlusionStage(queues, &worker->stats, scene, settings);
+        accumulateStage(queues, state, scene);
+        continueStage(queues, settings, bounces);
+        sortReflectionRays(queues, scene, settings);
+    }
+}
@@ -0,0 +1,81 @@
+#include "unity.h"
+#include "render_functions.h"
+
+void test_arenaAlloc_AlignsAndGrowsToHighWater(void) {
+    Arena arena;
+    TEST_ASSERT_TRUE(initArena(&arena, 256, 0));
+    TEST_ASSERT_EQUAL_UINT64(1, arena.heapAllocations);
+
+    // Allocations are cache-line aligned and do not overlap
+    unsigned char* first = arenaAlloc(&arena, 10);
+    unsigned char* second = arenaAlloc(&arena, 100);
+    TEST_ASSERT_EQUAL_INT(0, (int)((size_t)first % ARENA_ALIGNMENT));
+    TEST_ASSERT_EQUAL_INT(0, (int)((size_t)second % ARENA_ALIGNMENT));
+    TEST_ASSERT_TRUE(second >= first + 10);
+    TEST_ASSERT_EQUAL_UINT64(1, arena.heapAllocations);
+
+    // Overflowing takes heap blocks until the reset merges them into one allocation
+    unsigned char* large = arenaAlloc(&arena, 1000);
+    TEST_ASSERT_NOT_NULL(large);
+    SDL_memset(large, 0xAB, 1000);
+    TEST_ASSERT_EQUAL_UINT64(2, arena.heapAllocations);
+    resetArena(&arena);
+    TEST_ASSERT_EQUAL_INT(64 + 128 + 1024, (int)arena.highWater);
+    TEST_ASSERT_TRUE(arena.capacity >= arena.highWater);
+    TEST_ASSERT_EQUAL_UINT64(3, arena.heapAllocations);
+
+    // The same frame again fits without touching the heap
+    for (int frame = 0; frame < 3; frame++)
+    {
+        TEST_ASSERT_TRUE(arenaAlloc(&arena, 10) == arena.base);
+        arenaAlloc(&arena, 100);
+        arenaAlloc(&arena, 1000);
+        resetArena(&arena);
+    }
+    TEST_ASSERT_EQUAL_UINT64(3, arena.heapAllocations);
+    freeArena(&arena);
+}
+
+void test_initArena_HugePagesRoundsUpAndStaysUsable(void) {
+    Arena arena;
+    TEST_ASSERT_TRUE(initArena(&arena, 100000, ARENA_HUGE_PAGES));
+    TEST_ASSERT_TRUE(arena.capacity >= 100000);
+
+    unsigned char* memory = arenaAlloc(&arena, 100000);
+    TEST_ASSERT_NOT_NULL(memory);
+    TEST_ASSERT_EQUAL_INT(0, (int)((size_t)memory % ARENA_ALIGNMENT));
+    memory[0] = 1;
+    memory[99999] = 2;
+    TEST_ASSERT_EQUAL_UINT64(1, arena.heapAllocations);
+    freeArena(&arena);
+    TEST_ASSERT_NULL(arena.base);
+}
+
+void test_renderFrame_ScratchStopsAllocatingAfterWarmUp(void) {
+    const int width = 64, height = 48;
+    Camera camera;
+    Scene scene;
+    initialize_scene(width, height, &camera, &scene);
+
+    // Wavefront frames with sorted rays and cost-ordered tiles use both the tile and the frame scratch
+    RenderSettings settings = {0, 0, TILE_ORDER_COST, {1.0f, TONE_MAP_CLAMP, 0, 0}, 1, 0.1f, 0.0f, MOTION_FULL, 3, 1, 64, 1};
+    RenderState state;
+    initRenderState(&state, width, height, &settings);
+    static Uint32 pixels[64 * 48];
+    const SDL_PixelFormatDetails* format = SDL_GetPixelFormatDetails(SDL_PIXELFORMAT_RGBA32);
+
+    renderFrame(&state, &camera, &scene, &settings, pixels, width, format);
+    renderFrame(&state, &camera, &scene, &settings, pixels, width, format);
+    TEST_ASSERT_TRUE(state.stats.scratchBytes > 0);
+    Uint64 warmAllocations = state.workers[0].scratch.heapAllocations;
+
+    for (int frame = 0; frame < 3; frame++)
+    {
+        renderFrame(&state, &camera, &scene, &settings, pixels, width, format);
+    }
+    TEST_ASSERT_EQUAL_UINT64(warmAllocations, state.workers[0].scratch.heapAllocations);
+
+    freeRenderState(&state);
+    freeBVH(scene.bvhRoot);
+    freeScene(&scene);
+}
@@ -0,0 +1,193 @@
+#include "unity.h"
+#include "scene.h"
+#include "bvh.h"
+
+void test_intersectBVH_ReturnsClosestHit(void) {
+    Scene scene;
+    initScene(&scene, 8, 1, 1, 1, 1, 1);
+
+    // A row of spheres along the view axis, in scrambled order so the closest one is not stored first
+    float depths[6] = {9.0f, 3.0f, 12.0f, 6.0f, 15.0f, 18.0f};
+    for (int i = 0; i < 6; i++)
+    {
+        Material material = {{(Uint8)(40 * i), 0, 0, 255}, 0.0f, 8.0f};
+        addSphere(&scene, (Vector){0.0f, 0.0f, depths[i]}, 1.0f, material);
+    }
+    BVHNode* root = buildBVH(&scene.objects);
+    TEST_ASSERT_NOT_NULL(root);
+
+    Ray ray = {{0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 1.0f}};
+    ObjectIntersection hit;
+    TEST_ASSERT_TRUE(intersectBVH(ray, root, &hit));
+    TEST_ASSERT_EQUAL_INT(0, hit.objectType);
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, 2.0f, hit.distance);
+    TEST_ASSERT_EQUAL_INT(40, hit.material.color.r);
+
+    // Another ray into the same sphere reports the same primitive
+    Ray offsetRay = {{0.3f, 0.0f, 0.0f}, {0.0f, 0.0f, 1.0f}};
+    ObjectIntersection offsetHit;
+    TEST_ASSERT_TRUE(intersectBVH(offsetRay, root, &offsetHit));
+    TEST_ASSERT_EQUAL_PTR(hit.object, offsetHit.object);
+
+    // A ray that misses everything
+    Ray missRay = {{0.0f, 5.0f, 0.0f}, {0.0f, 0.0f, 1.0f}};
+    ObjectIntersection miss;
+    TEST_ASSERT_FALSE(intersectBVH(missRay, root, &miss));
+    TEST_ASSERT_EQUAL_INT(-1, miss.objectType);
+    TEST_ASSERT_NULL(miss.object);
+
+    freeBVH(root);
+    freeScene(&scene);
+}
+
+void test_traceShadowPacketBVH_MatchesPerRayTest(void) {
+    Scene scene;
+    initScene(&scene, 4, 1, 1, 1, 1, 1);
+    addSphere(&scene, (Vector){0.0f, 2.0f, 0.0f}, 0.5f, (Material){{255, 255, 255, 255}, 0.0f, 8.0f});
+    addSphere(&scene, (Vector){4.0f, 2.0f, 0.0f}, 0.5f, (Material){{255, 255, 255, 255}, 0.0f, 8.0f});
+    BVHNode* root = buildBVH(&scene.objects);
+
+    // Rays from the floor towards a light at (0, 4, 0): the first passes through the sphere above it, the
+    // second starts beside it, the third stops before the sphere, the fourth is a directional ray
+    Vector light = {0.0f, 4.0f, 0.0f};
+    Vector origins[3] = {{0.0f, 0.0f, 0.0f}, {2.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 0.0f}};
+    Ray rays[4];
+    float maxDistances[4];
+    for (int i = 0; i < 3; i++)
+    {
+        Vector toLight = subtractVectors(light, origins[i]);
+        rays[i] = (Ray){origins[i], normalizeVector(toLight)};
+        maxDistances[i] = vectorLength(toLight);
+    }
+    maxDistances[2] = 1.0f;
+    rays[3] = (Ray){{4.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}};
+    maxDistances[3] = __FLT_MAX__;
+
+    TEST_ASSERT_EQUAL_INT(0x9, traceShadowPacketBVH(root, rays, maxDistances, 4));
+
+    // Lanes past the count are never reported
+    TEST_ASSERT_EQUAL_INT(0x1, traceShadowPacketBVH(root, rays, maxDistances, 3));
+
+    freeBVH(root);
+    freeScene(&scene);
+}
+
+void test_cullBVHFrustum_KeepsOnlyVisibleSubtrees(void) {
+    Scene scene;
+    initScene(&scene, 8, 1, 1, 1, 1, 1);
+    Material material = {{255, 255, 255, 255}, 0.0f, 8.0f};
+    for (int i = 0; i < 8; i++)
+    {
+        addSphere(&scene, (Vector){-14.0f + 4.0f * i, 0.0f, -10.0f}, 0.5f, material);
+    }
+    BVHNode* root = buildBVH(&scene.objects);
+
+    // A narrow frustum from the origin down -z around x = 2 sees only the sphere at x = 2
+    BVHFrustum frustum;
+    Vector corners[4] = {{0.1f, 0.1f, -1.0f}, {0.3f, 0.1f, -1.0f}, {0.3f, -0.1f, -1.0f}, {0.1f, -0.1f, -1.0f}};
+    initBVHFrustum(&frustum, (Vector){0.0f, 0.0f, 0.0f}, corners);
+    BVHNode* nodes[BVH_FRUSTUM_MAX_NODES];
+    int count = cullBVHFrustum(root, &frustum, nodes, BVH_FRUSTUM_MAX_NODES);
+    TEST_ASSERT_TRUE(count >= 1);
+
+    // Rays inside the frustum hit what they hit through the whole tree
+    Ray ray = {{0.0f, 0.0f, 0.0f}, normalizeVector((Vector){0.2f, 0.0f, -1.0f})};
+    ObjectIntersection culledHit, fullHit;
+    TEST_ASSERT_EQUAL_INT(1, intersectBVHNodes(ray, nodes, count, &culledHit));
+    TEST_ASSERT_EQUAL_INT(1, intersectBVH(ray, root, &fullHit));
+    TEST_ASSERT_EQUAL_PTR(fullHit.object, culledHit.object);
+
+    // The spheres outside the frustum are no longer reachable
+    Ray outside = {{0.0f, 0.0f, 0.0f}, normalizeVector((Vector){-0.6f, 0.0f, -1.0f})};
+    TEST_ASSERT_EQUAL_INT(1, intersectBVH(outside, root, &fullHit));
+    TEST_ASSERT_EQUAL_INT(0, intersectBVHNodes(outside, nodes, count, &culledHit));
+
+    // A frustum looking away from every object keeps nothing
+    Vector awayCorners[4] = {{-0.1f, 0.1f, 1.0f}, {0.1f, 0.1f, 1.0f}, {0.1f, -0.1f, 1.0f}, {-0.1f, -0.1f, 1.0f}};
+    initBVHFrustum(&frustum, (Vector){0.0f, 0.0f, 0.0f}, awayCorners);
+    TEST_ASSERT_EQUAL_INT(0, cullBVHFrustum(root, &frustum, nodes, BVH_FRUSTUM_MAX_NODES));
+
+    freeBVH(root);
+    freeScene(&scene);
+}
+
+// Helper function that traces a ray straight down at x and returns the red channel of what it hits, -1 for nothing
+static int traceDownAt(BVHNode* root, float x)
+{
+    ObjectIntersection hit;
+    if (!intersectBVH((Ray){{x, 5.0f, 0.0f}, {0.0f, -1.0f, 0.0f}}, root, &hit)) return -1;
+    return hit.material.color.r;
+}
+
+void test_refitBVH_FollowsMovedObjectsInPlace(void) {
+    Scene scene;
+    initScene(&scene, 8, 1, 1, 1, 1, 1);
+    for (int i = 0; i < 8; i++)
+    {
+        addSphere(&scene, (Vector){3.0f * i, 0.0f, 0.0f}, 1.0f, (Material){{(Uint8)i, 0, 0, 255}, 0.0f, 8.0f});
+    }
+    BVHNode* root = buildBVH(&scene.objects);
+    TEST_ASSERT_EQUAL_INT(3, traceDownAt(root, 9.0f));
+
+    // Sphere 3 moves past the end of the row; the tree follows without being rebuilt
+    moveSphere(&scene, 3, (Vector){30.0f, 0.0f, 0.0f});
+    refitBVH(root, &scene.objects);
+    TEST_ASSERT_EQUAL_INT(-1, traceDownAt(root, 9.0f));
+    TEST_ASSERT_EQUAL_INT(3, traceDownAt(root, 30.0f));
+    TEST_ASSERT_EQUAL_INT(7, traceDownAt(root, 21.0f));
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 31.0f, root->bounds.max.x);
+
+    // One object travelling is not enough to make the tree worth rebuilding
+    TEST_ASSERT_TRUE(root->cost > root->builtCost);
+    TEST_ASSERT_EQUAL_INT(0, rebuildDegradedBVH(root, BVH_REBUILD_COST_RATIO));
+
+    freeBVH(root);
+    freeScene(&scene);
+}
+
+void test_rebuildDegradedBVH_RestoresCostAfterObjectsScatter(void) {
+    Scene scene;
+    initScene(&scene, 64, 1, 1, 1, 1, 1);
+    for (int i = 0; i < 64; i++)
+    {
+        addSphere(&scene, (Vector){(float)i, 0.0f, 0.0f}, 0.4f, (Material){{(Uint8)i, 0, 0, 255}, 0.0f, 8.0f});
+    }
+    BVHNode* root = buildBVH(&scene.objects);
+    float builtCost = root->builtCost;
+
+    // The last eight spheres swap places among themselves: only the subtree holding them degrades
+    for (int i = 56; i < 64; i++)
+    {
+        moveSphere(&scene, i, (Vector){(float)(56 + (i * 3) % 8), 0.0f, 0.0f});
+    }
+    refitBVH(root, &scene.objects);
+    TEST_ASSERT_TRUE(root->cost <= builtCost * BVH_REBUILD_COST_RATIO);
+    BVHNode* left = root->left;
+    TEST_ASSERT_TRUE(rebuildDegradedBVH(root, BVH_REBUILD_COST_RATIO) >= 1);
+    TEST_ASSERT_TRUE(root->left == left);
+
+    // Every sphere lands somewhere else: the whole tree is rebuilt, under the same root node
+    for (int i = 0; i < 64; i++)
+    {
+        moveSphere(&scene, i, (Vector){(float)((i * 37) % 64), 0.0f, 0.0f});
+    }
+    refitBVH(root, &scene.objects);
+    TEST_ASSERT_TRUE(root->cost > builtCost * BVH_REBUILD_COST_RATIO);
+    TEST_ASSERT_EQUAL_INT(1, rebuildDegradedBVH(root, BVH_REBUILD_COST_RATIO));
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, builtCost, root->cost);
+
+    int misplaced = 0;
+    for (int i = 0; i < 64; i++)
+    {
+        misplaced += traceDownAt(root, (float)((i * 37) % 64)) != i;
+    }
+    TEST_ASSERT_EQUAL_INT(0, misplaced);
+
+    // The rebuilt tree still refits from the scene's arrays
+    moveSphere(&scene, 0, (Vector){100.0f, 0.0f, 0.0f});
+    refitBVH(root, &scene.objects);
+    TEST_ASSERT_EQUAL_INT(0, traceDownAt(root, 100.0f));
+
+    freeBVH(root);
+    freeScene(&scene);
+}
@@ -72,3 +72,81 @@ void test_mapPixelToRay(void) {
     TEST_ASSERT_FLOAT_WITHIN(DIRECTION_EPSILON, expectedDir.z, cornerRay.direction.z);
 }
 
+
+void test_generateRayRow_MatchesMapPixelToRay(void) {
+    Camera cam;
+    int screenWidth = 640, screenHeight = 360;
+    initCamera(&cam, (Vector){1.0f, 2.0f, 3.0f}, (Vector){0.3f, -0.2f, -1.0f}, (Vector){0.0f, 1.0f, 0.0f}, 75.0f, screenWidth, screenHeight);
+
+    RayGenerator generator;
+    initRayGenerator(&generator, &cam, screenWidth, screenHeight);
+
+    // A row that does not start on a batch boundary and ends with a partial batch
+    Ray rays[11];
+    int rowsToCheck[3] = {0, 179, 359};
+    for (int r = 0; r < 3; r++)
+    {
+        int y = rowsToCheck[r];
+        generateRayRow(&generator, 301, y, 11, rays);
+
+        for (int i = 0; i < 11; i++)
+        {
+            Ray expected = mapPixelToRay(&cam, 301 + i, y, screenWidth, screenHeight);
+            TEST_ASSERT_FLOAT_WITHIN(EPSILON, expected.origin.x, rays[i].origin.x);
+            TEST_ASSERT_FLOAT_WITHIN(DIRECTION_EPSILON, expected.direction.x, rays[i].direction.x);
+            TEST_ASSERT_FLOAT_WITHIN(DIRECTION_EPSILON, expected.direction.y, rays[i].direction.y);
+            TEST_ASSERT_FLOAT_WITHIN(DIRECTION_EPSILON, expected.direction.z, rays[i].direction.z);
+        }
+    }
+
+    // Tiles are the same rays, stored row by row
+    Ray tile[4 * 3];
+    generateRayTile(&generator, 10, 20, 4, 3, tile);
+    Ray expected = mapPixelToRay(&cam, 13, 22, screenWidth, screenHeight);
+    TEST_ASSERT_FLOAT_WITHIN(DIRECTION_EPSILON, expected.direction.x, tile[2 * 4 + 3].direction.x);
+    TEST_ASSERT_FLOAT_WITHIN(DIRECTION_EPSILON, expected.direction.y, tile[2 * 4 + 3].direction.y);
+}
+
+void test_setRayGeneratorJitter_ShiftsWithinPixel(void) {
+    Camera cam;
+    int screenWidth = 320, screenHeight = 200;
+    initCamera(&cam, (Vector){0.0f, 1.0f, 0.0f}, (Vector){0.0f, 0.0f, -1.0f}, (Vector){0.0f, 1.0f, 0.0f}, 60.0f, screenWidth, screenHeight);
+
+    RayGenerator generator;
+    initRayGenerator(&generator, &cam, screenWidth, screenHeight);
+    RayGenerator jittered = generator;
+    setRayGeneratorJitter(&jittered, 0.25f, -0.375f);
+
+    // A jittered row matches single rays through the offset positions
+    Ray rays[5];
+    generateRayRow(&jittered, 40, 17, 5, rays);
+    for (int i = 0; i < 5; i++)
+    {
+        Ray expected = generateRay(&generator, 40 + i + 0.5f + 0.25f, 17 + 0.5f - 0.375f);
+        TEST_ASSERT_FLOAT_WITHIN(EPSILON, expected.direction.x, rays[i].direction.x);
+        TEST_ASSERT_FLOAT_WITHIN(EPSILON, expected.direction.y, rays[i].direction.y);
+        TEST_ASSERT_FLOAT_WITHIN(EPSILON, expected.direction.z, rays[i].direction.z);
+    }
+}
+
+void test_projectPointToPixel_InvertsGenerateRay(void) {
+    Camera cam;
+    initCamera(&cam, (Vector){1.0f, 2.0f, 3.0f}, (Vector){0.3f, -0.2f, -1.0f}, (Vector){0.0f, 1.0f, 0.0f}, 75.0f, 640, 360);
+    rotateCameraRight(&cam);
+
+    RayGenerator generator;
+    initRayGenerator(&generator, &cam, 640, 360);
+
+    // A point along the ray through a pixel position projects back onto that position
+    Ray ray = generateRay(&generator, 123.25f, 301.75f);
+    Vector point = addVectors(ray.origin, multiplyVector(ray.direction, 7.0f));
+    float imageX, imageY, depth;
+    TEST_ASSERT_TRUE(projectPointToPixel(&generator, point, &imageX, &imageY, &depth));
+    TEST_ASSERT_FLOAT_WITHIN(1e-2f, 123.25f, imageX);
+    TEST_ASSERT_FLOAT_WITHIN(1e-2f, 301.75f, imageY);
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, 7.0f * dotProduct(ray.direction, cam.direction), depth);
+
+    // Points behind the camera have no image position
+    Vector behind = addVectors(cam.position, multiplyVector(cam.direction, -2.0f));
+    TEST_ASSERT_FALSE(projectPointToPixel(&generator, behind, &imageX, &imageY, &depth));
+}
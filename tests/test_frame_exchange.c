@@ -0,0 +1,76 @@
+#include "unity.h"
+#include "frame_exchange.h"
+
+#define EXCHANGE_TEST_FRAMES 2000
+
+void test_acquireLatestFrame_ReturnsNewestPublishedFrame(void) {
+    FrameExchange exchange;
+    TEST_ASSERT_TRUE(initFrameExchange(&exchange, 4, 2));
+    TEST_ASSERT_NULL(acquireLatestFrame(&exchange));
+
+    // Two frames published before the presenter looks: it gets the second, the first is dropped
+    for (int frame = 1; frame <= 2; frame++)
+    {
+        RenderedFrame* target = getFrameToRender(&exchange);
+        target->pixels[0] = (Uint32)frame;
+        publishFrame(&exchange);
+    }
+    const RenderedFrame* shown = acquireLatestFrame(&exchange);
+    TEST_ASSERT_NOT_NULL(shown);
+    TEST_ASSERT_EQUAL_UINT32(2, shown->pixels[0]);
+    TEST_ASSERT_EQUAL_UINT64(2, shown->frameNumber);
+
+    // Without a new frame the presenter keeps its slot, and the render thread never writes into it
+    TEST_ASSERT_TRUE(acquireLatestFrame(&exchange) == shown);
+    TEST_ASSERT_TRUE(getFrameToRender(&exchange) != shown);
+    getFrameToRender(&exchange)->pixels[0] = 3;
+    publishFrame(&exchange);
+    TEST_ASSERT_TRUE(getFrameToRender(&exchange) != shown);
+    TEST_ASSERT_EQUAL_UINT32(2, shown->pixels[0]);
+
+    shown = acquireLatestFrame(&exchange);
+    TEST_ASSERT_EQUAL_UINT32(3, shown->pixels[0]);
+    TEST_ASSERT_EQUAL_UINT64(3, shown->frameNumber);
+    freeFrameExchange(&exchange);
+}
+
+// Producer thread: fills every pixel of each frame with its number before publishing it
+static int publishNumberedFrames(void* data)
+{
+    FrameExchange* exchange = (FrameExchange*)data;
+    for (Uint32 frame = 1; frame <= EXCHANGE_TEST_FRAMES; frame++)
+    {
+        RenderedFrame* target = getFrameToRender(exchange);
+        for (int i = 0; i < exchange->pixelsPerRow * exchange->maxHeight; i++)
+        {
+            target->pixels[i] = frame;
+        }
+        publishFrame(exchange);
+    }
+    return 0;
+}
+
+void test_acquireLatestFrame_NeverShowsAFrameBeingRendered(void) {
+    FrameExchange exchange;
+    TEST_ASSERT_TRUE(initFrameExchange(&exchange, 32, 32));
+    SDL_Thread* producer = SDL_CreateThread(publishNumberedFrames, "producer", &exchange);
+    TEST_ASSERT_NOT_NULL(producer);
+
+    // Every acquired frame is complete, and frame numbers only go up
+    Uint64 lastNumber = 0;
+    int torn = 0;
+    while (lastNumber < EXCHANGE_TEST_FRAMES)
+    {
+        const RenderedFrame* shown = acquireLatestFrame(&exchange);
+        if (shown == NULL) continue;
+        TEST_ASSERT_TRUE(shown->frameNumber >= lastNumber);
+        lastNumber = shown->frameNumber;
+        for (int i = 0; i < 32 * 32; i++)
+        {
+            torn += shown->pixels[i] != (Uint32)shown->frameNumber;
+        }
+    }
+    SDL_WaitThread(producer, NULL);
+    TEST_ASSERT_EQUAL_INT(0, torn);
+    freeFrameExchange(&exchange);
+}
@@ -0,0 +1,55 @@
+#include "unity.h"
+#include "frame_governor.h"
+
+void test_updateFrameGovernor_ShrinksThenDropsSamples(void) {
+    RenderSettings settings = {0, 0, TILE_ORDER_HILBERT, {1.0f, TONE_MAP_CLAMP, 0, 0}, 8, 0.1f, 0.0f, MOTION_FULL, 0, 0, 0, 0};
+    FrameGovernor governor;
+    initFrameGovernor(&governor, 16.0f, 0.5f, settings.maxSamplesPerPixel);
+
+    // Four times over budget: the scale shrinks by at most one step per update
+    TEST_ASSERT_TRUE(updateFrameGovernor(&governor, 64.0, &settings));
+    TEST_ASSERT_FLOAT_WITHIN(GOVERNOR_SCALE_STEP, 1.0f / GOVERNOR_MAX_STEP, governor.scale);
+    TEST_ASSERT_EQUAL_INT(8, settings.maxSamplesPerPixel);
+
+    // Keep it over budget until the minimum scale is reached, then samples are halved
+    for (int i = 0; i < 10; i++)
+    {
+        updateFrameGovernor(&governor, 64.0, &settings);
+    }
+    TEST_ASSERT_EQUAL_FLOAT(0.5f, governor.scale);
+    TEST_ASSERT_EQUAL_INT(1, settings.maxSamplesPerPixel);
+
+    int width, height;
+    getGovernedResolution(&governor, 1280, 720, &width, &height);
+    TEST_ASSERT_EQUAL_INT(640, width);
+    TEST_ASSERT_EQUAL_INT(360, height);
+}
+
+void test_updateFrameGovernor_RestoresSamplesThenScale(void) {
+    RenderSettings settings = {0, 0, TILE_ORDER_HILBERT, {1.0f, TONE_MAP_CLAMP, 0, 0}, 2, 0.1f, 0.0f, MOTION_FULL, 0, 0, 0, 0};
+    FrameGovernor governor;
+    initFrameGovernor(&governor, 16.0f, 0.5f, 8);
+    governor.scale = 0.5f;
+
+    // Inside the tolerance band nothing changes
+    TEST_ASSERT_FALSE(updateFrameGovernor(&governor, 15.0, &settings));
+
+    // Plenty of time to spare: samples come back before the resolution grows
+    governor.averageMilliseconds = 0.0f;
+    TEST_ASSERT_TRUE(updateFrameGovernor(&governor, 4.0, &settings));
+    TEST_ASSERT_EQUAL_INT(4, settings.maxSamplesPerPixel);
+    TEST_ASSERT_EQUAL_FLOAT(0.5f, governor.scale);
+
+    TEST_ASSERT_TRUE(updateFrameGovernor(&governor, 4.0, &settings));
+    TEST_ASSERT_EQUAL_INT(8, settings.maxSamplesPerPixel);
+
+    TEST_ASSERT_TRUE(updateFrameGovernor(&governor, 4.0, &settings));
+    TEST_ASSERT_TRUE(governor.scale > 0.5f);
+
+    // A disabled governor always asks for the full window
+    governor.enabled = 0;
+    int width, height;
+    getGovernedResolution(&governor, 1280, 720, &width, &height);
+    TEST_ASSERT_EQUAL_INT(1280, width);
+    TEST_ASSERT_EQUAL_INT(720, height);
+}
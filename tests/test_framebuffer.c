@@ -0,0 +1,92 @@
+#include "unity.h"
+#include "framebuffer.h"
+
+void test_resolveFrameBuffer_PacksLikeMapRGBA(void) {
+    // Width 6 exercises one full SIMD batch and one partial batch per row
+    FrameBuffer buffer;
+    initFrameBuffer(&buffer, 6, 2);
+    for (int i = 0; i < 12; i++)
+    {
+        buffer.red[i] = i / 11.0f;
+        buffer.green[i] = 1.5f - i / 11.0f;  // Above 1 at the start, clipped by the resolve
+        buffer.blue[i] = -0.25f + i * 0.05f; // Negative at the start, clipped to black
+    }
+
+    const SDL_PixelFormatDetails* format = SDL_GetPixelFormatDetails(SDL_PIXELFORMAT_RGBA32);
+    ResolveSettings settings = {1.0f, TONE_MAP_CLAMP, 0, 0};
+    Uint32 pixels[8 * 2] = {0};
+    resolveFrameBuffer(&buffer, 0, 2, pixels, 8, format, &settings);
+
+    for (int y = 0; y < 2; y++)
+    {
+        for (int x = 0; x < 6; x++)
+        {
+            int i = y * 6 + x;
+            Uint8 r = (Uint8)(SDL_clamp(buffer.red[i], 0.0f, 1.0f) * 255.0f + 0.5f);
+            Uint8 g = (Uint8)(SDL_clamp(buffer.green[i], 0.0f, 1.0f) * 255.0f + 0.5f);
+            Uint8 b = (Uint8)(SDL_clamp(buffer.blue[i], 0.0f, 1.0f) * 255.0f + 0.5f);
+            TEST_ASSERT_EQUAL_HEX32(SDL_MapRGBA(format, NULL, r, g, b, 255), pixels[y * 8 + x]);
+        }
+
+        // The row stride padding is left untouched
+        TEST_ASSERT_EQUAL_HEX32(0, pixels[y * 8 + 6]);
+    }
+
+    freeFrameBuffer(&buffer);
+}
+
+void test_resolveFrameBuffer_SRGBEncoding(void) {
+    FrameBuffer buffer;
+    initFrameBuffer(&buffer, 64, 1);
+    for (int i = 0; i < 64; i++)
+    {
+        buffer.red[i] = buffer.green[i] = buffer.blue[i] = i / 63.0f;
+    }
+
+    const SDL_PixelFormatDetails* format = SDL_GetPixelFormatDetails(SDL_PIXELFORMAT_RGBA32);
+    ResolveSettings settings = {1.0f, TONE_MAP_CLAMP, 1, 0};
+    Uint32 pixels[64];
+    resolveFrameBuffer(&buffer, 0, 1, pixels, 64, format, &settings);
+
+    // The fast curve stays within one step of the exact sRGB transfer function
+    for (int i = 0; i < 64; i++)
+    {
+        float linear = i / 63.0f;
+        float encoded = linear <= 0.0031308f ? 12.92f * linear : 1.055f * SDL_powf(linear, 1.0f / 2.4f) - 0.055f;
+        Uint8 expected = (Uint8)(encoded * 255.0f + 0.5f);
+        Uint8 red = (Uint8)((pixels[i] & format->Rmask) >> format->Rshift);
+        TEST_ASSERT_UINT8_WITHIN(1, expected, red);
+    }
+
+    freeFrameBuffer(&buffer);
+}
+
+void test_accumulateFrameBuffer_AveragesFrames(void) {
+    // Odd width so the scalar tail after the SIMD batches is covered too
+    AccumulationBuffer accumulation;
+    FrameBuffer frame;
+    initAccumulationBuffer(&accumulation, 7, 1);
+    initFrameBuffer(&frame, 7, 1);
+
+    for (int frameIndex = 0; frameIndex < 3; frameIndex++)
+    {
+        for (int i = 0; i < 7; i++)
+        {
+            frame.red[i] = (float)(frameIndex + i);
+            frame.green[i] = 1.0f;
+            frame.blue[i] = frameIndex == 0 ? 3.0f : 0.0f;
+        }
+        accumulateFrameBuffer(&accumulation, &frame);
+        finishAccumulationFrame(&accumulation);
+    }
+
+    for (int i = 0; i < 7; i++)
+    {
+        TEST_ASSERT_FLOAT_WITHIN(1e-5f, i + 1.0f, frame.red[i]);
+        TEST_ASSERT_FLOAT_WITHIN(1e-5f, 1.0f, frame.green[i]);
+        TEST_ASSERT_FLOAT_WITHIN(1e-5f, 1.0f, frame.blue[i]);
+    }
+
+    freeFrameBuffer(&frame);
+    freeAccumulationBuffer(&accumulation);
+}
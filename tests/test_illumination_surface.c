@@ -1,6 +1,9 @@
 #include "unity.h"
 #include "scene.h"
 #include "illumination.h"
+#include "light_buffer.h"
+#include "bvh.h"
+#include "simd.h"
 
 #define EPSILON 0.0001
 
@@ -193,3 +196,137 @@ void test_ComputeSurfaceColor_MaxIntensityClamping(void)
     TEST_ASSERT_EQUAL_UINT8(255, result.g);
     TEST_ASSERT_EQUAL_UINT8(255, result.b); 
 }
+
+// Tests that the batched shading path matches the scalar one, including shadowed and out-of-range lights.
+void test_ComputeSurfaceColorBatched_MatchesScalar(void)
+{
+    Scene testScene;
+    Vector testNormal = {0, 1, 0};
+    Vector viewDir = {0, 1, 1};
+    Material testMat = (Material){(SDL_Color){200, 150, 100, 255}, 0.5f, 16.0f};
+    LightMaterial ambientMat = {(SDL_Color){255, 255, 255, 255}, 0.1f};
+
+    // Initialize scene
+    initScene(&testScene,5,5,5,8,5,5);
+
+    setAmbientLight(&testScene, ambientMat);
+    for (int i = 0; i < 6; i++)
+    {
+        LightMaterial lightMat = {(SDL_Color){(Uint8)(40 * i), 255, (Uint8)(255 - 40 * i), 255}, 0.4f + 0.1f * i};
+        addPointLight(&testScene, lightMat, (Vector){i - 3.0f, 1.0f + 0.5f * i, -1.0f}, i == 5 ? 1.0f : 10.0f);
+    }
+    addSpotLight(&testScene, ambientMat, (Vector){0, 2, -1}, (Vector){0, 1, -0.5f}, 40.0f, 20.0f);
+    addSpotLight(&testScene, ambientMat, (Vector){1, 3, 0}, (Vector){0, 1, 0}, 30.0f, 10.0f);
+
+    // A small plane that shadows part of the floor from the first lights
+    addPlane(&testScene, (Vector){-2, 0.5f, -0.5f}, (Vector){0, 1, 0}, 1.0f, 1.0f, testMat);
+
+    testScene.lightBuffer = buildLightBuffer(&testScene.lights);
+
+    for (int i = 0; i < 5; i++)
+    {
+        Vector testPoint = {i - 2.0f, 0, 0};
+        SDL_Color expected = computeSurfaceColor(&testScene, testPoint, testNormal, viewDir, testMat);
+        SDL_Color result = computeSurfaceColorBatched(&testScene, testPoint, testNormal, viewDir, testMat);
+
+        TEST_ASSERT_UINT8_WITHIN(1, expected.r, result.r);
+        TEST_ASSERT_UINT8_WITHIN(1, expected.g, result.g);
+        TEST_ASSERT_UINT8_WITHIN(1, expected.b, result.b);
+        TEST_ASSERT_EQUAL_UINT8(expected.a, result.a);
+    }
+
+    freeScene(&testScene);
+}
+
+void test_ComputeSurfaceColorBatched_PrunedLightsMatchScalar(void)
+{
+    Scene testScene;
+    Vector testNormal = {0, 1, 0};
+    Vector viewDir = {0, 1, 0};
+    Material testMat = (Material){(SDL_Color){255, 255, 255, 255}, 0.0f, 1.0f};
+
+    initScene(&testScene,5,5,5,40,5,5);
+
+    // Two bright lights saturate the surface, many dim ones can no longer change it
+    LightMaterial brightMat = {(SDL_Color){255, 255, 255, 255}, 5.0f};
+    LightMaterial dimMat = {(SDL_Color){255, 255, 255, 255}, 0.002f};
+    addPointLight(&testScene, brightMat, (Vector){0, 1, 0}, 10.0f);
+    addPointLight(&testScene, brightMat, (Vector){0.5f, 1, 0}, 10.0f);
+    for (int i = 0; i < 30; i++)
+    {
+        addPointLight(&testScene, dimMat, (Vector){(i % 6) - 2.5f, 0.5f, (i / 6) - 2.0f}, 10.0f);
+    }
+
+    testScene.lightBuffer = buildLightBuffer(&testScene.lights);
+
+    Vector points[2] = {{0, 0, 0}, {4, 0, 4}};
+    for (int i = 0; i < 2; i++)
+    {
+        SDL_Color expected = computeSurfaceColor(&testScene, points[i], testNormal, viewDir, testMat);
+        SDL_Color result = computeSurfaceColorBatched(&testScene, points[i], testNormal, viewDir, testMat);
+
+        TEST_ASSERT_UINT8_WITHIN(1, expected.r, result.r);
+        TEST_ASSERT_UINT8_WITHIN(1, expected.g, result.g);
+        TEST_ASSERT_UINT8_WITHIN(1, expected.b, result.b);
+    }
+
+    freeScene(&testScene);
+}
+
+// Tests that shading with the chunked shadow-ray masks traced through the BVH matches the scalar path
+void test_ComputeSurfaceColorBatched_PacketShadowsMatchScalar(void)
+{
+    Scene testScene;
+    Vector testNormal = {0, 1, 0};
+    Vector viewDir = {0, 1, 1};
+    Material testMat = (Material){(SDL_Color){200, 150, 100, 255}, 0.5f, 16.0f};
+
+    // Initialize scene
+    initScene(&testScene,8,5,5,10,5,5);
+
+    for (int i = 0; i < 9; i++)
+    {
+        LightMaterial lightMat = {(SDL_Color){255, (Uint8)(25 * i), 128, 255}, 0.02f + 0.005f * i};
+        addPointLight(&testScene, lightMat, (Vector){(i % 3) - 1.0f, 2.0f, (i / 3) - 1.0f}, 10.0f);
+    }
+    addSpotLight(&testScene, (LightMaterial){(SDL_Color){255, 255, 255, 255}, 0.1f}, (Vector){0, 3, 0}, (Vector){0, 1, 0}, 30.0f, 10.0f);
+
+    // Small spheres between the floor and some of the lights
+    for (int i = 0; i < 4; i++)
+    {
+        addSphere(&testScene, (Vector){i - 1.5f, 1.0f, 0.5f * i - 0.75f}, 0.45f, testMat);
+    }
+
+    testScene.lightBuffer = buildLightBuffer(&testScene.lights);
+    updateSceneBVH(&testScene);
+
+    // The packet mask agrees with tracing each ray alone
+    Vector point = {-0.5f, 0, 0};
+    Ray rays[SIMD_LANES];
+    float maxDistances[SIMD_LANES];
+    const void* lights[SIMD_LANES];
+    int expectedMask = 0;
+    for (int i = 0; i < SIMD_LANES; i++)
+    {
+        PointLight* light = &testScene.lights.pointLights[i];
+        rays[i] = makeShadowRay(point, normalizeVector(subtractVectors(light->position, point)));
+        maxDistances[i] = vectorLength(subtractVectors(light->position, point));
+        lights[i] = light;
+        expectedMask |= traceShadowRay(&testScene, light, rays[i], maxDistances[i]) << i;
+    }
+    TEST_ASSERT_EQUAL_INT(expectedMask, traceShadowRays(&testScene, lights, rays, maxDistances, SIMD_LANES));
+
+    for (int i = 0; i < 9; i++)
+    {
+        Vector testPoint = {(i % 3) - 1.0f, 0, (i / 3) - 1.0f};
+        SDL_Color expected = computeSurfaceColor(&testScene, testPoint, testNormal, viewDir, testMat);
+        SDL_Color result = computeSurfaceColorBatched(&testScene, testPoint, testNormal, viewDir, testMat);
+
+        TEST_ASSERT_UINT8_WITHIN(1, expected.r, result.r);
+        TEST_ASSERT_UINT8_WITHIN(1, expected.g, result.g);
+        TEST_ASSERT_UINT8_WITHIN(1, expected.b, result.b);
+    }
+
+    freeBVH(testScene.bvhRoot);
+    freeScene(&testScene);
+}
@@ -0,0 +1,186 @@
+#include "unity.h"
+#include "render_functions.h"
+
+#define JOB_TEST_COUNT 10000
+
+// Adds every index of the range to its own slot, so indices visited twice or not at all show up
+static void markRange(int begin, int end, void* data)
+{
+    SDL_AtomicInt* visits = (SDL_AtomicInt*)data;
+    for (int i = begin; i < end; i++)
+    {
+        SDL_AddAtomicInt(&visits[i], 1);
+    }
+}
+
+// Parent job data: submits a child job per slot and waits for them inside the job
+typedef struct {
+    JobSystem* system;
+    SDL_AtomicInt* slots;
+    int count;
+    int childrenDone; // Every child had finished when the wait returned
+} ParentJob;
+
+static void incrementSlot(void* data)
+{
+    SDL_AddAtomicInt((SDL_AtomicInt*)data, 1);
+}
+
+static void runParentJob(void* data)
+{
+    ParentJob* parent = (ParentJob*)data;
+    JobCounter children;
+    initJobCounter(&children);
+    for (int i = 0; i < parent->count; i++)
+    {
+        submitJob(parent->system, incrementSlot, &parent->slots[i], &children);
+    }
+    waitForJobs(parent->system, &children);
+
+    // Checked on the test thread; Unity asserts must not run on a worker
+    parent->childrenDone = 1;
+    for (int i = 0; i < parent->count; i++)
+    {
+        parent->childrenDone &= SDL_GetAtomicInt(&parent->slots[i]) == 1;
+    }
+}
+
+void test_parallelFor_VisitsEveryIndexOnce(void) {
+    static SDL_AtomicInt visits[JOB_TEST_COUNT];
+    JobSystem* system = createJobSystem(4);
+    TEST_ASSERT_NOT_NULL(system);
+    TEST_ASSERT_EQUAL_INT(4, getJobWorkerCount(system));
+    TEST_ASSERT_EQUAL_INT(0, getCurrentJobWorker(system));
+
+    for (int grain = 1; grain <= 64; grain *= 8)
+    {
+        SDL_memset(visits, 0, sizeof(visits));
+        parallelFor(system, JOB_TEST_COUNT, grain, markRange, visits);
+        for (int i = 0; i < JOB_TEST_COUNT; i++)
+        {
+            TEST_ASSERT_EQUAL_INT(1, SDL_GetAtomicInt(&visits[i]));
+        }
+    }
+
+    // Parent jobs spawn children on whichever worker runs them and wait for them there
+    static SDL_AtomicInt slots[8][64];
+    SDL_memset(slots, 0, sizeof(slots));
+    ParentJob parents[8];
+    JobCounter counter;
+    initJobCounter(&counter);
+    for (int i = 0; i < 8; i++)
+    {
+        parents[i] = (ParentJob){system, slots[i], 64, 0};
+        submitJob(system, runParentJob, &parents[i], &counter);
+    }
+    waitForJobs(system, &counter);
+    TEST_ASSERT_EQUAL_INT(0, SDL_GetAtomicInt(&counter.pending));
+    for (int i = 0; i < 8; i++)
+    {
+        TEST_ASSERT_TRUE(parents[i].childrenDone);
+    }
+
+    destroyJobSystem(system);
+}
+
+void test_renderFrame_JobSystemMatchesSingleThread(void) {
+    const int width = 64, height = 48;
+    Camera camera;
+    Scene scene;
+    initialize_scene(width, height, &camera, &scene);
+
+    for (int wavefront = 0; wavefront <= 1; wavefront++)
+    {
+        RenderSettings settings = {0, 0, TILE_ORDER_COST, {1.0f, TONE_MAP_CLAMP, 0, 0}, 1, 0.1f, 0.0f, MOTION_FULL, 3, wavefront, 0, 1};
+        RenderState single, threaded;
+        initRenderState(&single, width, height, &settings);
+        initRenderState(&threaded, width, height, &settings);
+        JobSystem* system = createJobSystem(4);
+        TEST_ASSERT_EQUAL_INT(1, setRenderJobSystem(&threaded, system));
+
+        const SDL_PixelFormatDetails* format = SDL_GetPixelFormatDetails(SDL_PIXELFORMAT_RGBA32);
+        static Uint32 singlePixels[64 * 48];
+        static Uint32 threadedPixels[64 * 48];
+
+        // The second frame runs in the cost order measured during the first
+        for (int frame = 0; frame < 2; frame++)
+        {
+            renderFrame(&single, &camera, &scene, &settings, singlePixels, width, format);
+            renderFrame(&threaded, &camera, &scene, &settings, threadedPixels, width, format);
+            TEST_ASSERT_EQUAL_UINT32_ARRAY(singlePixels, threadedPixels, width * height);
+            TEST_ASSERT_EQUAL_INT((int)single.stats.primaryRays, (int)threaded.stats.primaryRays);
+            TEST_ASSERT_EQUAL_INT((int)single.stats.shadowRays, (int)threaded.stats.shadowRays);
+            for (int bounces = 0; bounces <= MAX_REFLECTION_BOUNCES; bounces++)
+            {
+                TEST_ASSERT_EQUAL_INT((int)single.stats.bounceHistogram[bounces], (int)threaded.stats.bounceHistogram[bounces]);
+            }
+        }
+
+        freeRenderState(&single);
+        freeRenderState(&threaded);
+        destroyJobSystem(system);
+    }
+    freeBVH(scene.bvhRoot);
+    freeScene(&scene);
+}
+
+// Helper function that renders one frame on both states and checks that the pixels and ray counts agree
+static void renderBothAndCompare(RenderState* single, RenderState* threaded, Camera* camera, Scene* scene, RenderSettings* settings, Uint32* singlePixels, Uint32* threadedPixels, int width, int height)
+{
+    const SDL_PixelFormatDetails* format = SDL_GetPixelFormatDetails(SDL_PIXELFORMAT_RGBA32);
+    renderFrame(single, camera, scene, settings, singlePixels, width, format);
+    renderFrame(threaded, camera, scene, settings, threadedPixels, width, format);
+    TEST_ASSERT_EQUAL_UINT32_ARRAY(singlePixels, threadedPixels, width * height);
+    TEST_ASSERT_EQUAL_INT(single->stats.spacing, threaded->stats.spacing);
+    TEST_ASSERT_EQUAL_INT((int)single->stats.primaryRays, (int)threaded->stats.primaryRays);
+    TEST_ASSERT_EQUAL_INT((int)single->stats.extraRays, (int)threaded->stats.extraRays);
+    TEST_ASSERT_EQUAL_INT((int)single->stats.refinedPixels, (int)threaded->stats.refinedPixels);
+    TEST_ASSERT_EQUAL_INT((int)single->stats.reusedPixels, (int)threaded->stats.reusedPixels);
+    TEST_ASSERT_EQUAL_INT((int)single->stats.reshadedPixels, (int)threaded->stats.reshadedPixels);
+    TEST_ASSERT_EQUAL_INT((int)single->stats.shadowRays, (int)threaded->stats.shadowRays);
+}
+
+void test_renderFrame_JobSystemMatchesSingleThreadForPartialFrames(void) {
+    const int width = 64, height = 48;
+    Camera camera;
+    Scene scene;
+    initialize_scene(width, height, &camera, &scene);
+
+    RenderSettings settings = {0, 0, TILE_ORDER_HILBERT, {1.0f, TONE_MAP_CLAMP, 0, 0}, 4, 0.1f, 0.0f, MOTION_PREVIEW, 2, 0, 0, 0};
+    RenderState single, threaded;
+    initRenderState(&single, width, height, &settings);
+    initRenderState(&threaded, width, height, &settings);
+    JobSystem* system = createJobSystem(4);
+    TEST_ASSERT_EQUAL_INT(1, setRenderJobSystem(&threaded, system));
+
+    static Uint32 singlePixels[64 * 48];
+    static Uint32 threadedPixels[64 * 48];
+
+    // Preview passes at spacing 8, 4 and 2, then the last pass with edge supersampling
+    restartRendering(&single);
+    restartRendering(&threaded);
+    for (int frame = 0; frame < 4; frame++)
+    {
+        renderBothAndCompare(&single, &threaded, &camera, &scene, &settings, singlePixels, threadedPixels, width, height);
+    }
+    TEST_ASSERT_TRUE(threaded.stats.refinedPixels > 0);
+
+    // A light edit reshades the G-buffer
+    movePointLight(&scene, 0, (Vector){2.0f, 1.0f, 1.0f});
+    renderBothAndCompare(&single, &threaded, &camera, &scene, &settings, singlePixels, threadedPixels, width, height);
+    TEST_ASSERT_TRUE(threaded.stats.reshadedPixels > 0);
+
+    // A camera move reprojects the last frame
+    settings.motionMode = MOTION_REPROJECT;
+    moveCameraRight(&camera);
+    restartRendering(&single);
+    restartRendering(&threaded);
+    renderBothAndCompare(&single, &threaded, &camera, &scene, &settings, singlePixels, threadedPixels, width, height);
+    TEST_ASSERT_TRUE(threaded.stats.reusedPixels > 0);
+
+    freeRenderState(&single);
+    freeRenderState(&threaded);
+    destroyJobSystem(system);
+    freeBVH(scene.bvhRoot);
+    freeScene(&scene);
+}
@@ -0,0 +1,36 @@
+#include "unity.h"
+#include "scene.h"
+#include "light_buffer.h"
+
+#define EPSILON 0.0001
+
+void test_buildLightBuffer(void) {
+    Scene scene;
+    initScene(&scene, 5, 5, 5, 5, 5, 5);
+
+    LightMaterial material = {{255, 0, 51, 255}, 0.75f};
+    for (int i = 0; i < 5; i++)
+    {
+        addPointLight(&scene, material, (Vector){(float)i, 2.0f, -1.0f}, 4.0f);
+    }
+    addSpotLight(&scene, material, (Vector){0.0f, 5.0f, 0.0f}, (Vector){0.0f, 1.0f, 0.0f}, 60.0f, 0.0f);
+
+    LightBuffer* buffer = buildLightBuffer(&scene.lights);
+    TEST_ASSERT_NOT_NULL(buffer);
+
+    // Lights are padded up to whole SIMD batches
+    TEST_ASSERT_EQUAL_INT(5, buffer->pointLights.count);
+    TEST_ASSERT_EQUAL_INT(0, buffer->pointLights.paddedCount % SIMD_LANES);
+    TEST_ASSERT_FLOAT_WITHIN(EPSILON, 3.0f, buffer->pointLights.positionX[3]);
+    TEST_ASSERT_FLOAT_WITHIN(EPSILON, 4.0f, buffer->pointLights.range[4]);
+    TEST_ASSERT_FLOAT_WITHIN(EPSILON, 0.2f, buffer->pointLights.blue[0]);
+    TEST_ASSERT_FLOAT_WITHIN(EPSILON, 0.0f, buffer->pointLights.intensity[buffer->pointLights.paddedCount - 1]);
+
+    // Spot cutoff angles are stored as cosines
+    TEST_ASSERT_EQUAL_INT(1, buffer->spotLights.count);
+    TEST_ASSERT_FLOAT_WITHIN(EPSILON, 0.5f, buffer->spotLights.outerCutoffCosine[0]);
+    TEST_ASSERT_FLOAT_WITHIN(EPSILON, 1.0f, buffer->spotLights.innerCutoffCosine[0]);
+
+    freeLightBuffer(buffer);
+    freeScene(&scene);
+}
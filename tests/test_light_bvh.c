@@ -0,0 +1,113 @@
+#include "unity.h"
+#include "scene.h"
+#include "illumination.h"
+#include "light_buffer.h"
+#include "light_bvh.h"
+
+// Collects the lights reported by queryLightBVH
+typedef struct {
+    int pointVisits[64];
+    int spotVisits[8];
+} VisitedLights;
+
+static void recordVisit(LightType type, int index, void* userData)
+{
+    VisitedLights* visited = userData;
+    if (type == LIGHT_TYPE_POINT) visited->pointVisits[index]++;
+    else visited->spotVisits[index]++;
+}
+
+void test_queryLightBVH(void) {
+    Scene scene;
+    initScene(&scene, 5, 5, 5, 64, 5, 5);
+
+    // An 8x8 grid of small point lights and one spotlight shining straight down
+    LightMaterial material = {{255, 255, 255, 255}, 1.0f};
+    for (int i = 0; i < 64; i++)
+    {
+        addPointLight(&scene, material, (Vector){(float)(i % 8), 1.0f, (float)(i / 8)}, 1.5f);
+    }
+    addSpotLight(&scene, material, (Vector){0.0f, 5.0f, 0.0f}, (Vector){0.0f, 1.0f, 0.0f}, 20.0f, 10.0f);
+
+    AABB sceneBounds = {{-1.0f, 0.0f, -1.0f}, {9.0f, 6.0f, 9.0f}};
+    LightBVHNode* root = buildLightBVH(&scene.lights, &sceneBounds);
+    TEST_ASSERT_NOT_NULL(root);
+
+    Vector queries[3] = {{0.0f, 0.0f, 0.0f}, {3.5f, 0.0f, 3.5f}, {8.5f, 0.0f, 8.5f}};
+    for (int q = 0; q < 3; q++)
+    {
+        VisitedLights visited = {{0}, {0}};
+        queryLightBVH(root, queries[q], recordVisit, &visited);
+
+        // Every light is visited exactly when the point is inside its range
+        for (int i = 0; i < 64; i++)
+        {
+            Vector toLight = subtractVectors(scene.lights.pointLights[i].position, queries[q]);
+            int inRange = vectorLength(toLight) <= scene.lights.pointLights[i].range;
+            TEST_ASSERT_EQUAL_INT(inRange, visited.pointVisits[i]);
+        }
+
+        // The spotlight only reaches the point right below it
+        TEST_ASSERT_EQUAL_INT(q == 0 ? 1 : 0, visited.spotVisits[0]);
+    }
+
+    freeLightBVH(root);
+    freeScene(&scene);
+}
+
+void test_updateSceneLightStructures_SpotlightsReachEverywhereWithoutObjects(void) {
+    Scene scene;
+    initScene(&scene, 1, 1, 1, 1, 1, 1);
+    LightMaterial material = {{255, 255, 255, 255}, 1.0f};
+    addSpotLight(&scene, material, (Vector){0.0f, 5.0f, 0.0f}, (Vector){0.0f, 1.0f, 0.0f}, 20.0f, 10.0f);
+
+    // Only lights: there are no bounds to cut the cone off at, so it reaches far below the light
+    updateSceneLightStructures(&scene);
+    VisitedLights farBelow = {{0}, {0}};
+    queryLightBVH(scene.lightBvhRoot, (Vector){0.0f, -60.0f, 0.0f}, recordVisit, &farBelow);
+    TEST_ASSERT_EQUAL_INT(1, farBelow.spotVisits[0]);
+
+    // An object added later gives the scene bounds, and the cone is rebuilt to end just past them
+    addSphere(&scene, (Vector){0.0f, -30.0f, 0.0f}, 1.0f, (Material){{255, 255, 255, 255}, 0.0f, 8.0f});
+    scene.bvhRoot = buildBVH(&scene.objects);
+    updateSceneLightStructures(&scene);
+    VisitedLights onSphere = {{0}, {0}};
+    VisitedLights pastSphere = {{0}, {0}};
+    queryLightBVH(scene.lightBvhRoot, (Vector){0.0f, -29.0f, 0.0f}, recordVisit, &onSphere);
+    queryLightBVH(scene.lightBvhRoot, (Vector){0.0f, -60.0f, 0.0f}, recordVisit, &pastSphere);
+    TEST_ASSERT_EQUAL_INT(1, onSphere.spotVisits[0]);
+    TEST_ASSERT_EQUAL_INT(0, pastSphere.spotVisits[0]);
+
+    freeBVH(scene.bvhRoot);
+    freeScene(&scene);
+}
+
+void test_ComputeSurfaceColorBatched_LightBVHMatchesScalar(void) {
+    Scene scene;
+    initScene(&scene, 5, 5, 5, 64, 5, 5);
+
+    LightMaterial material = {{255, 128, 64, 255}, 0.3f};
+    for (int i = 0; i < 64; i++)
+    {
+        addPointLight(&scene, material, (Vector){(float)(i % 8) - 4.0f, 0.5f, (float)(i / 8) - 4.0f}, 1.2f);
+    }
+    addSpotLight(&scene, material, (Vector){0.0f, 3.0f, 0.0f}, (Vector){0.0f, 1.0f, 0.0f}, 30.0f, 10.0f);
+
+    AABB sceneBounds = {{-5.0f, -1.0f, -5.0f}, {5.0f, 4.0f, 5.0f}};
+    scene.lightBuffer = buildLightBuffer(&scene.lights);
+    scene.lightBvhRoot = buildLightBVH(&scene.lights, &sceneBounds);
+
+    Material surface = {{200, 200, 200, 255}, 0.0f, 8.0f};
+    for (int i = 0; i < 8; i++)
+    {
+        Vector point = {i - 3.7f, 0.0f, 0.3f * i - 1.0f};
+        SDL_Color expected = computeSurfaceColor(&scene, point, (Vector){0, 1, 0}, (Vector){0, 1, 1}, surface);
+        SDL_Color result = computeSurfaceColorBatched(&scene, point, (Vector){0, 1, 0}, (Vector){0, 1, 1}, surface);
+
+        TEST_ASSERT_UINT8_WITHIN(1, expected.r, result.r);
+        TEST_ASSERT_UINT8_WITHIN(1, expected.g, result.g);
+        TEST_ASSERT_UINT8_WITHIN(1, expected.b, result.b);
+    }
+
+    freeScene(&scene);
+}
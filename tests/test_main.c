@@ -11,6 +11,9 @@ void test_dotProduct(void);
 
 void test_initCamera(void);
 void test_mapPixelToRay(void);
+void test_generateRayRow_MatchesMapPixelToRay(void);
+void test_projectPointToPixel_InvertsGenerateRay(void);
+void test_setRayGeneratorJitter_ShiftsWithinPixel(void);
 
 void test_computeSphereNormal(void);
 void test_computeTriangleNormal(void);
@@ -34,6 +37,7 @@ void test_setAmbientLight(void);
 void test_isPointInShadow(void);
 void test_isPointInShadowDir(void);
 void test_isPointInShadowSpot(void);
+void test_isPointInShadow_OccluderCache(void);
 
 void test_ComputePointLightDiffuse_PointInShadow(void);
 void test_ComputePointLightDiffuse_ZeroLightIntensity(void);
@@ -65,6 +69,76 @@ void test_ComputeSurfaceColor_HighShininess(void);
 void test_ComputeSurfaceColor_LowShininess(void);
 void test_ComputeSurfaceColor_LightOppositeNormal(void);
 void test_ComputeSurfaceColor_MaxIntensityClamping(void);
+void test_ComputeSurfaceColorBatched_MatchesScalar(void);
+void test_ComputeSurfaceColorBatched_PrunedLightsMatchScalar(void);
+void test_ComputeSurfaceColorBatched_PacketShadowsMatchScalar(void);
+
+void test_buildLightBuffer(void);
+
+void test_queryLightBVH(void);
+void test_updateSceneLightStructures_SpotlightsReachEverywhereWithoutObjects(void);
+void test_ComputeSurfaceColorBatched_LightBVHMatchesScalar(void);
+
+// Sampling Tests
+void test_randomFloat_UnitInterval(void);
+void test_radicalInverse_HaltonPoints(void);
+void test_ComputeSurfaceColorSampled_ConvergesToFullLoop(void);
+void test_ComputeSurfaceRadianceSampled_StaysUnclampedWithOneShadowRayPerSample(void);
+
+// Frame Buffer Tests
+void test_resolveFrameBuffer_PacksLikeMapRGBA(void);
+void test_resolveFrameBuffer_SRGBEncoding(void);
+void test_accumulateFrameBuffer_AveragesFrames(void);
+
+// Tile Order Tests
+void test_buildTileSchedule_CoversEveryPixelOnce(void);
+void test_buildTileSchedule_HilbertStepsToNeighbours(void);
+void test_scheduleTilesByCost_SplitsHotTilesAndSortsLargestFirst(void);
+
+// BVH Tests
+void test_intersectBVH_ReturnsClosestHit(void);
+void test_traceShadowPacketBVH_MatchesPerRayTest(void);
+void test_cullBVHFrustum_KeepsOnlyVisibleSubtrees(void);
+void test_refitBVH_FollowsMovedObjectsInPlace(void);
+void test_rebuildDegradedBVH_RestoresCostAfterObjectsScatter(void);
+
+// Frame Governor Tests
+void test_updateFrameGovernor_ShrinksThenDropsSamples(void);
+void test_updateFrameGovernor_RestoresSamplesThenScale(void);
+
+// Render Tests
+void test_renderFrame_PreviewRefinesToFullFrame(void);
+void test_renderFrame_ReprojectsAfterSmallMove(void);
+void test_renderFrame_LightEditReshadesWithoutTracing(void);
+void test_renderFrame_LightEditReshadeSupersamplesEdges(void);
+void test_renderFrame_ShowsObjectsAddedAndMovedOnTheScene(void);
+void test_computePixelColor_FollowsReflections(void);
+void test_renderFrame_WavefrontMatchesDepthFirst(void);
+
+// Wavefront Tests
+void test_rayBinKey_OrdersByOctantThenCell(void);
+void test_renderTileWavefront_SortingKeepsImage(void);
+void test_renderTileWavefront_ShadowPacketsMatchPerRayShadows(void);
+
+// Job System Tests
+void test_parallelFor_VisitsEveryIndexOnce(void);
+void test_renderFrame_JobSystemMatchesSingleThread(void);
+void test_renderFrame_JobSystemMatchesSingleThreadForPartialFrames(void);
+
+// Arena Tests
+void test_arenaAlloc_AlignsAndGrowsToHighWater(void);
+void test_initArena_HugePagesRoundsUpAndStaysUsable(void);
+void test_renderFrame_ScratchStopsAllocatingAfterWarmUp(void);
+
+// Frame Exchange Tests
+void test_acquireLatestFrame_ReturnsNewestPublishedFrame(void);
+void test_acquireLatestFrame_NeverShowsAFrameBeingRendered(void);
+
+// Scene Store Tests
+void test_commitSceneEdits_KeepsOldVersionForReadersUntilReleased(void);
+void test_commitSceneEdits_RefitsACopyOfTheBVHForMovedObjects(void);
+void test_commitSceneEdits_RefitsTheSpareBVHOfAFreedVersion(void);
+void test_acquireSceneVersion_TracesConsistentlyWhileAnotherThreadCommits(void);
 
 void setUp(void) {}   // Runs before each test (optional)
 void tearDown(void) {} // Runs after each test (optional)
@@ -84,6 +158,9 @@ int main(void) {
     printf("\n===== Running Camera Tests =====\n");
     RUN_TEST(test_initCamera);
     RUN_TEST(test_mapPixelToRay);
+    RUN_TEST(test_generateRayRow_MatchesMapPixelToRay);
+    RUN_TEST(test_projectPointToPixel_InvertsGenerateRay);
+    RUN_TEST(test_setRayGeneratorJitter_ShiftsWithinPixel);
 
     printf("\n===== Running Shapes Tests =====\n");
     RUN_TEST(test_computeSphereNormal);
@@ -110,6 +187,7 @@ int main(void) {
     RUN_TEST(test_isPointInShadow);
     RUN_TEST(test_isPointInShadowDir);
     RUN_TEST(test_isPointInShadowSpot);
+    RUN_TEST(test_isPointInShadow_OccluderCache);
 
     printf("\n===== Running Illumination Diffuse Tests =====\n");
     RUN_TEST(test_ComputePointLightDiffuse_PointInShadow);
@@ -144,6 +222,78 @@ int main(void) {
     RUN_TEST(test_ComputeSurfaceColor_LowShininess);
     RUN_TEST(test_ComputeSurfaceColor_LightOppositeNormal);
     RUN_TEST(test_ComputeSurfaceColor_MaxIntensityClamping);
+    RUN_TEST(test_ComputeSurfaceColorBatched_MatchesScalar);
+    RUN_TEST(test_ComputeSurfaceColorBatched_PrunedLightsMatchScalar);
+    RUN_TEST(test_ComputeSurfaceColorBatched_PacketShadowsMatchScalar);
+
+    printf("\n===== Running Light Buffer Tests =====\n");
+    RUN_TEST(test_buildLightBuffer);
+
+    printf("\n===== Running Light BVH Tests =====\n");
+    RUN_TEST(test_queryLightBVH);
+    RUN_TEST(test_updateSceneLightStructures_SpotlightsReachEverywhereWithoutObjects);
+    RUN_TEST(test_ComputeSurfaceColorBatched_LightBVHMatchesScalar);
+
+    printf("\n===== Running Sampling Tests =====\n");
+    RUN_TEST(test_randomFloat_UnitInterval);
+    RUN_TEST(test_radicalInverse_HaltonPoints);
+    RUN_TEST(test_ComputeSurfaceColorSampled_ConvergesToFullLoop);
+    RUN_TEST(test_ComputeSurfaceRadianceSampled_StaysUnclampedWithOneShadowRayPerSample);
+
+    printf("\n===== Running Frame Buffer Tests =====\n");
+    RUN_TEST(test_resolveFrameBuffer_PacksLikeMapRGBA);
+    RUN_TEST(test_resolveFrameBuffer_SRGBEncoding);
+    RUN_TEST(test_accumulateFrameBuffer_AveragesFrames);
+
+    printf("\n===== Running Tile Order Tests =====\n");
+    RUN_TEST(test_buildTileSchedule_CoversEveryPixelOnce);
+    RUN_TEST(test_buildTileSchedule_HilbertStepsToNeighbours);
+    RUN_TEST(test_scheduleTilesByCost_SplitsHotTilesAndSortsLargestFirst);
+
+    printf("\n===== Running BVH Tests =====\n");
+    RUN_TEST(test_intersectBVH_ReturnsClosestHit);
+    RUN_TEST(test_traceShadowPacketBVH_MatchesPerRayTest);
+    RUN_TEST(test_cullBVHFrustum_KeepsOnlyVisibleSubtrees);
+    RUN_TEST(test_refitBVH_FollowsMovedObjectsInPlace);
+    RUN_TEST(test_rebuildDegradedBVH_RestoresCostAfterObjectsScatter);
+
+    printf("\n===== Running Frame Governor Tests =====\n");
+    RUN_TEST(test_updateFrameGovernor_ShrinksThenDropsSamples);
+    RUN_TEST(test_updateFrameGovernor_RestoresSamplesThenScale);
+
+    printf("\n===== Running Render Tests =====\n");
+    RUN_TEST(test_renderFrame_PreviewRefinesToFullFrame);
+    RUN_TEST(test_renderFrame_ReprojectsAfterSmallMove);
+    RUN_TEST(test_renderFrame_LightEditReshadesWithoutTracing);
+    RUN_TEST(test_renderFrame_LightEditReshadeSupersamplesEdges);
+    RUN_TEST(test_renderFrame_ShowsObjectsAddedAndMovedOnTheScene);
+    RUN_TEST(test_computePixelColor_FollowsReflections);
+    RUN_TEST(test_renderFrame_WavefrontMatchesDepthFirst);
+
+    printf("\n===== Running Wavefront Tests =====\n");
+    RUN_TEST(test_rayBinKey_OrdersByOctantThenCell);
+    RUN_TEST(test_renderTileWavefront_SortingKeepsImage);
+    RUN_TEST(test_renderTileWavefront_ShadowPacketsMatchPerRayShadows);
+
+    printf("\n===== Running Job System Tests =====\n");
+    RUN_TEST(test_parallelFor_VisitsEveryIndexOnce);
+    RUN_TEST(test_renderFrame_JobSystemMatchesSingleThread);
+    RUN_TEST(test_renderFrame_JobSystemMatchesSingleThreadForPartialFrames);
+
+    printf("\n===== Running Arena Tests =====\n");
+    RUN_TEST(test_arenaAlloc_AlignsAndGrowsToHighWater);
+    RUN_TEST(test_initArena_HugePagesRoundsUpAndStaysUsable);
+    RUN_TEST(test_renderFrame_ScratchStopsAllocatingAfterWarmUp);
+
+    printf("\n===== Running Frame Exchange Tests =====\n");
+    RUN_TEST(test_acquireLatestFrame_ReturnsNewestPublishedFrame);
+    RUN_TEST(test_acquireLatestFrame_NeverShowsAFrameBeingRendered);
+
+    printf("\n===== Running Scene Store Tests =====\n");
+    RUN_TEST(test_commitSceneEdits_KeepsOldVersionForReadersUntilReleased);
+    RUN_TEST(test_commitSceneEdits_RefitsACopyOfTheBVHForMovedObjects);
+    RUN_TEST(test_commitSceneEdits_RefitsTheSpareBVHOfAFreedVersion);
+    RUN_TEST(test_acquireSceneVersion_TracesConsistentlyWhileAnotherThreadCommits);
 
     return UNITY_END();
 }
\ No newline at end of file
@@ -0,0 +1,269 @@
+#include "unity.h"
+#include "render_functions.h"
+
+#define PREVIEW_TEST_WIDTH 72
+#define PREVIEW_TEST_HEIGHT 40
+
+void test_renderFrame_PreviewRefinesToFullFrame(void) {
+    Camera camera;
+    Scene scene;
+    initialize_scene(PREVIEW_TEST_WIDTH, PREVIEW_TEST_HEIGHT, &camera, &scene);
+
+    RenderSettings settings = {0, 0, TILE_ORDER_HILBERT, {1.0f, TONE_MAP_CLAMP, 0, 0}, 4, 0.1f, 0.0f, MOTION_PREVIEW, 0, 0, 0, 0};
+    RenderState state;
+    initRenderState(&state, PREVIEW_TEST_WIDTH, PREVIEW_TEST_HEIGHT, &settings);
+
+    const SDL_PixelFormatDetails* format = SDL_GetPixelFormatDetails(SDL_PIXELFORMAT_RGBA32);
+    static Uint32 fullFrame[PREVIEW_TEST_WIDTH * PREVIEW_TEST_HEIGHT];
+    static Uint32 refined[PREVIEW_TEST_WIDTH * PREVIEW_TEST_HEIGHT];
+    TEST_ASSERT_TRUE(renderFrame(&state, &camera, &scene, &settings, fullFrame, PREVIEW_TEST_WIDTH, format));
+    TEST_ASSERT_EQUAL_INT(1, state.stats.spacing);
+
+    // With no time budget every frame runs one pass: spacing 8, 4, 2, then the remaining pixels
+    restartRendering(&state);
+    int expectedSpacing = PREVIEW_START_SPACING;
+    Uint64 tracedPixels = 0;
+    for (int frame = 0; frame < 4; frame++)
+    {
+        renderFrame(&state, &camera, &scene, &settings, refined, PREVIEW_TEST_WIDTH, format);
+        TEST_ASSERT_EQUAL_INT(expectedSpacing, state.stats.spacing);
+        tracedPixels += state.stats.primaryRays;
+        expectedSpacing = SDL_max(1, expectedSpacing / 2);
+    }
+
+    // Each pixel was traced exactly once, and the result matches a frame traced in one go
+    TEST_ASSERT_EQUAL_INT(PREVIEW_TEST_WIDTH * PREVIEW_TEST_HEIGHT, (int)tracedPixels);
+    TEST_ASSERT_EQUAL_UINT32_ARRAY(fullFrame, refined, PREVIEW_TEST_WIDTH * PREVIEW_TEST_HEIGHT);
+
+    freeRenderState(&state);
+    freeBVH(scene.bvhRoot);
+    freeScene(&scene);
+}
+
+void test_renderFrame_ReprojectsAfterSmallMove(void) {
+    Camera camera;
+    Scene scene;
+    initialize_scene(PREVIEW_TEST_WIDTH, PREVIEW_TEST_HEIGHT, &camera, &scene);
+
+    RenderSettings settings = {0, 0, TILE_ORDER_HILBERT, {1.0f, TONE_MAP_CLAMP, 0, 0}, 1, 0.1f, 0.0f, MOTION_REPROJECT, 0, 0, 0, 0};
+    RenderState state;
+    initRenderState(&state, PREVIEW_TEST_WIDTH, PREVIEW_TEST_HEIGHT, &settings);
+
+    const SDL_PixelFormatDetails* format = SDL_GetPixelFormatDetails(SDL_PIXELFORMAT_RGBA32);
+    static Uint32 reprojected[PREVIEW_TEST_WIDTH * PREVIEW_TEST_HEIGHT];
+    static Uint32 traced[PREVIEW_TEST_WIDTH * PREVIEW_TEST_HEIGHT];
+    renderFrame(&state, &camera, &scene, &settings, reprojected, PREVIEW_TEST_WIDTH, format);
+
+    moveCameraRight(&camera);
+    restartRendering(&state);
+    renderFrame(&state, &camera, &scene, &settings, reprojected, PREVIEW_TEST_WIDTH, format);
+
+    // Most pixels keep their shading, every other pixel is traced
+    int pixelCount = PREVIEW_TEST_WIDTH * PREVIEW_TEST_HEIGHT;
+    TEST_ASSERT_EQUAL_INT(0, state.stats.spacing);
+    TEST_ASSERT_EQUAL_INT(pixelCount, (int)(state.stats.primaryRays + state.stats.reusedPixels));
+    TEST_ASSERT_TRUE(state.stats.reusedPixels > (Uint64)pixelCount / 2);
+
+    // The next frame traces the new view completely; it looks nearly the same
+    renderFrame(&state, &camera, &scene, &settings, traced, PREVIEW_TEST_WIDTH, format);
+    TEST_ASSERT_EQUAL_INT(1, state.stats.spacing);
+    int differentPixels = 0;
+    for (int i = 0; i < pixelCount; i++)
+    {
+        for (int shift = 0; shift < 24; shift += 8)
+        {
+            int difference = (int)((reprojected[i] >> shift) & 0xFF) - (int)((traced[i] >> shift) & 0xFF);
+            if (difference > 24 || difference < -24)
+            {
+                differentPixels++;
+                break;
+            }
+        }
+    }
+    TEST_ASSERT_TRUE(differentPixels < pixelCount / 20);
+
+    freeRenderState(&state);
+    freeBVH(scene.bvhRoot);
+    freeScene(&scene);
+}
+
+void test_renderFrame_LightEditReshadesWithoutTracing(void) {
+    Camera camera;
+    Scene scene;
+    initialize_scene(PREVIEW_TEST_WIDTH, PREVIEW_TEST_HEIGHT, &camera, &scene);
+
+    RenderSettings settings = {0, 0, TILE_ORDER_HILBERT, {1.0f, TONE_MAP_CLAMP, 0, 0}, 1, 0.1f, 0.0f, MOTION_REPROJECT, 2, 0, 0, 0};
+    RenderState state;
+    initRenderState(&state, PREVIEW_TEST_WIDTH, PREVIEW_TEST_HEIGHT, &settings);
+
+    const SDL_PixelFormatDetails* format = SDL_GetPixelFormatDetails(SDL_PIXELFORMAT_RGBA32);
+    static Uint32 reshaded[PREVIEW_TEST_WIDTH * PREVIEW_TEST_HEIGHT];
+    static Uint32 traced[PREVIEW_TEST_WIDTH * PREVIEW_TEST_HEIGHT];
+    renderFrame(&state, &camera, &scene, &settings, reshaded, PREVIEW_TEST_WIDTH, format);
+
+    // Only the lights change: no primary rays, every pixel shaded again
+    movePointLight(&scene, 0, (Vector){2.0f, 1.0f, 1.0f});
+    setAmbientLight(&scene, (LightMaterial){{255, 255, 255, 255}, 0.2f});
+    renderFrame(&state, &camera, &scene, &settings, reshaded, PREVIEW_TEST_WIDTH, format);
+    TEST_ASSERT_EQUAL_INT(0, (int)state.stats.primaryRays);
+    TEST_ASSERT_EQUAL_INT(PREVIEW_TEST_WIDTH * PREVIEW_TEST_HEIGHT, (int)state.stats.reshadedPixels);
+
+    // The result is what tracing the edited scene from scratch gives
+    RenderState freshState;
+    initRenderState(&freshState, PREVIEW_TEST_WIDTH, PREVIEW_TEST_HEIGHT, &settings);
+    renderFrame(&freshState, &camera, &scene, &settings, traced, PREVIEW_TEST_WIDTH, format);
+    TEST_ASSERT_EQUAL_UINT32_ARRAY(traced, reshaded, PREVIEW_TEST_WIDTH * PREVIEW_TEST_HEIGHT);
+
+    // Editing an object traces every pixel again
+    addSphere(&scene, (Vector){0.0f, 1.0f, 0.0f}, 0.5f, (Material){{0, 0, 255, 255}, 0.5f, 16.0f});
+    renderFrame(&state, &camera, &scene, &settings, reshaded, PREVIEW_TEST_WIDTH, format);
+    TEST_ASSERT_EQUAL_INT(PREVIEW_TEST_WIDTH * PREVIEW_TEST_HEIGHT, (int)state.stats.primaryRays);
+
+    freeRenderState(&freshState);
+    freeRenderState(&state);
+    freeBVH(scene.bvhRoot);
+    freeScene(&scene);
+}
+
+void test_renderFrame_LightEditReshadeSupersamplesEdges(void) {
+    Camera camera;
+    Scene scene;
+    initialize_scene(PREVIEW_TEST_WIDTH, PREVIEW_TEST_HEIGHT, &camera, &scene);
+
+    RenderSettings settings = {0, 0, TILE_ORDER_HILBERT, {1.0f, TONE_MAP_CLAMP, 0, 0}, 4, 0.1f, 0.0f, MOTION_REPROJECT, 2, 0, 0, 0};
+    RenderState state;
+    initRenderState(&state, PREVIEW_TEST_WIDTH, PREVIEW_TEST_HEIGHT, &settings);
+
+    const SDL_PixelFormatDetails* format = SDL_GetPixelFormatDetails(SDL_PIXELFORMAT_RGBA32);
+    static Uint32 reshaded[PREVIEW_TEST_WIDTH * PREVIEW_TEST_HEIGHT];
+    static Uint32 traced[PREVIEW_TEST_WIDTH * PREVIEW_TEST_HEIGHT];
+    renderFrame(&state, &camera, &scene, &settings, reshaded, PREVIEW_TEST_WIDTH, format);
+
+    // The center hits are reshaded and the edges get their extra rays again
+    movePointLight(&scene, 0, (Vector){2.0f, 1.0f, 1.0f});
+    renderFrame(&state, &camera, &scene, &settings, reshaded, PREVIEW_TEST_WIDTH, format);
+    TEST_ASSERT_EQUAL_INT(0, (int)state.stats.primaryRays);
+    TEST_ASSERT_EQUAL_INT(PREVIEW_TEST_WIDTH * PREVIEW_TEST_HEIGHT, (int)state.stats.reshadedPixels);
+    TEST_ASSERT_TRUE(state.stats.refinedPixels > 0);
+    TEST_ASSERT_TRUE(state.stats.extraRays >= state.stats.refinedPixels);
+
+    // Edge pixels keep their antialiasing: the result matches tracing the edited scene from scratch
+    RenderState freshState;
+    initRenderState(&freshState, PREVIEW_TEST_WIDTH, PREVIEW_TEST_HEIGHT, &settings);
+    renderFrame(&freshState, &camera, &scene, &settings, traced, PREVIEW_TEST_WIDTH, format);
+    TEST_ASSERT_EQUAL_INT((int)freshState.stats.refinedPixels, (int)state.stats.refinedPixels);
+    TEST_ASSERT_EQUAL_UINT32_ARRAY(traced, reshaded, PREVIEW_TEST_WIDTH * PREVIEW_TEST_HEIGHT);
+
+    freeRenderState(&freshState);
+    freeRenderState(&state);
+    freeBVH(scene.bvhRoot);
+    freeScene(&scene);
+}
+
+void test_renderFrame_ShowsObjectsAddedAndMovedOnTheScene(void) {
+    Camera camera;
+    Scene scene;
+    initCamera(&camera, (Vector){0, 0, 0}, (Vector){0, 0, -1}, (Vector){0, 1, 0}, 90.0f, PREVIEW_TEST_WIDTH, PREVIEW_TEST_HEIGHT);
+    initScene(&scene, 2, 1, 1, 1, 1, 1);
+    addPointLight(&scene, (LightMaterial){{255, 255, 255, 255}, 1.0f}, (Vector){0.0f, 0.0f, 0.0f}, 100.0f);
+    addSphere(&scene, (Vector){4.0f, 0.0f, -6.0f}, 1.0f, (Material){{0, 255, 0, 255}, 0.0f, 8.0f});
+
+    RenderSettings settings = {0, 0, TILE_ORDER_HILBERT, {1.0f, TONE_MAP_CLAMP, 0, 0}, 1, 0.1f, 0.0f, MOTION_FULL, 0, 0, 0, 0};
+    RenderState state;
+    initRenderState(&state, PREVIEW_TEST_WIDTH, PREVIEW_TEST_HEIGHT, &settings);
+    const SDL_PixelFormatDetails* format = SDL_GetPixelFormatDetails(SDL_PIXELFORMAT_RGBA32);
+    static Uint32 pixels[PREVIEW_TEST_WIDTH * PREVIEW_TEST_HEIGHT];
+    int center = (PREVIEW_TEST_HEIGHT / 2) * PREVIEW_TEST_WIDTH + PREVIEW_TEST_WIDTH / 2;
+
+    // The scene has no BVH yet: the frame builds one, and the sphere off to the side leaves the center black
+    renderFrame(&state, &camera, &scene, &settings, pixels, PREVIEW_TEST_WIDTH, format);
+    TEST_ASSERT_NOT_NULL(scene.bvhRoot);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, state.frameBuffer.green[center]);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, state.frameBuffer.blue[center]);
+
+    // A sphere added straight on the scene shows up in the center
+    addSphere(&scene, (Vector){0.0f, 0.0f, -6.0f}, 1.0f, (Material){{0, 0, 255, 255}, 0.0f, 8.0f});
+    renderFrame(&state, &camera, &scene, &settings, pixels, PREVIEW_TEST_WIDTH, format);
+    TEST_ASSERT_TRUE(state.frameBuffer.blue[center] > 0.0f);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, state.frameBuffer.green[center]);
+
+    // Moving it behind the camera and the first sphere into its place swaps the colors
+    moveSphere(&scene, 1, (Vector){0.0f, 0.0f, 6.0f});
+    moveSphere(&scene, 0, (Vector){0.0f, 0.0f, -6.0f});
+    renderFrame(&state, &camera, &scene, &settings, pixels, PREVIEW_TEST_WIDTH, format);
+    TEST_ASSERT_TRUE(state.frameBuffer.green[center] > 0.0f);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, state.frameBuffer.blue[center]);
+
+    freeRenderState(&state);
+    freeBVH(scene.bvhRoot);
+    freeScene(&scene);
+}
+
+void test_computePixelColor_FollowsReflections(void) {
+    Scene scene;
+    initScene(&scene, 1, 1, 1, 1, 1, 1);
+    setAmbientLight(&scene, (LightMaterial){{255, 255, 255, 255}, 0.5f});
+    addPlane(&scene, (Vector){0.0f, 0.0f, 0.0f}, (Vector){0.0f, 1.0f, 0.0f}, 20.0f, 20.0f, (Material){{255, 0, 0, 255}, 1.0f, 8.0f});
+    addSphere(&scene, (Vector){0.0f, 2.0f, 0.0f}, 1.0f, (Material){{0, 0, 255, 255}, 0.0f, 8.0f});
+    scene.bvhRoot = buildBVH(&scene.objects);
+    updateSceneLightStructures(&scene);
+
+    // The ray hits the red mirror floor at (1, 0, 0) and its reflection hits the blue sphere
+    Ray ray = {{2.0f, 2.0f, 0.0f}, normalizeVector((Vector){-1.0f, -2.0f, 0.0f})};
+    RenderSettings settings = {0, 0, TILE_ORDER_HILBERT, {1.0f, TONE_MAP_CLAMP, 0, 0}, 1, 0.1f, 0.0f, MOTION_FULL, 0, 0, 0, 0};
+
+    resetBounceHistogram();
+    FloatColor direct = computePixelColor(ray, &scene, &settings, 1u, NULL);
+    settings.maxBounces = 4;
+    FloatColor reflected = computePixelColor(ray, &scene, &settings, 1u, NULL);
+
+    // Only ambient light: the reflection adds the sphere's ambient term at full mirror weight
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 0.5f, reflected.r - direct.r);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 0.5f, reflected.b - direct.b);
+
+    // The sphere does not reflect, so the second path ends after one reflection
+    Uint64 histogram[MAX_REFLECTION_BOUNCES + 1];
+    getBounceHistogram(histogram);
+    TEST_ASSERT_EQUAL_INT(1, (int)histogram[0]);
+    TEST_ASSERT_EQUAL_INT(1, (int)histogram[1]);
+
+    freeBVH(scene.bvhRoot);
+    freeScene(&scene);
+}
+
+void test_renderFrame_WavefrontMatchesDepthFirst(void) {
+    Camera camera;
+    Scene scene;
+    initialize_scene(PREVIEW_TEST_WIDTH, PREVIEW_TEST_HEIGHT, &camera, &scene);
+
+    RenderSettings settings = {0, 0, TILE_ORDER_HILBERT, {1.0f, TONE_MAP_CLAMP, 0, 0}, 1, 0.1f, 0.0f, MOTION_FULL, 3, 0, 0, 0};
+    RenderState depthFirst, wavefront;
+    initRenderState(&depthFirst, PREVIEW_TEST_WIDTH, PREVIEW_TEST_HEIGHT, &settings);
+    initRenderState(&wavefront, PREVIEW_TEST_WIDTH, PREVIEW_TEST_HEIGHT, &settings);
+
+    const SDL_PixelFormatDetails* format = SDL_GetPixelFormatDetails(SDL_PIXELFORMAT_RGBA32);
+    static Uint32 pixels[PREVIEW_TEST_WIDTH * PREVIEW_TEST_HEIGHT];
+    renderFrame(&depthFirst, &camera, &scene, &settings, pixels, PREVIEW_TEST_WIDTH, format);
+    settings.wavefront = 1;
+    renderFrame(&wavefront, &camera, &scene, &settings, pixels, PREVIEW_TEST_WIDTH, format);
+
+    // Same paths, same hits; the colors only differ by the faint lights the depth-first path prunes
+    TEST_ASSERT_NOT_NULL(wavefront.workers[0].wavefront);
+    TEST_ASSERT_EQUAL_INT((int)depthFirst.stats.primaryRays, (int)wavefront.stats.primaryRays);
+    for (int bounces = 0; bounces <= MAX_REFLECTION_BOUNCES; bounces++)
+    {
+        TEST_ASSERT_EQUAL_INT((int)depthFirst.stats.bounceHistogram[bounces], (int)wavefront.stats.bounceHistogram[bounces]);
+    }
+    for (int i = 0; i < PREVIEW_TEST_WIDTH * PREVIEW_TEST_HEIGHT; i++)
+    {
+        TEST_ASSERT_TRUE(depthFirst.gBuffer.object[i] == wavefront.gBuffer.object[i]);
+        TEST_ASSERT_FLOAT_WITHIN(0.01f, depthFirst.frameBuffer.red[i], wavefront.frameBuffer.red[i]);
+        TEST_ASSERT_FLOAT_WITHIN(0.01f, depthFirst.frameBuffer.green[i], wavefront.frameBuffer.green[i]);
+        TEST_ASSERT_FLOAT_WITHIN(0.01f, depthFirst.frameBuffer.blue[i], wavefront.frameBuffer.blue[i]);
+    }
+
+    freeRenderState(&depthFirst);
+    freeRenderState(&wavefront);
+    freeBVH(scene.bvhRoot);
+    freeScene(&scene);
+}
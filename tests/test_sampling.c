@@ -0,0 +1,116 @@
+#include "unity.h"
+#include "scene.h"
+#include "illumination.h"
+#include "light_buffer.h"
+#include "light_bvh.h"
+#include "sampling.h"
+#include "framebuffer.h"
+
+void test_randomFloat_UnitInterval(void) {
+    Uint32 state = pixelSeed(17, 42, 3);
+    float sum = 0.0f;
+
+    for (int i = 0; i < 10000; i++)
+    {
+        float value = randomFloat(&state);
+        TEST_ASSERT_TRUE(value >= 0.0f && value < 1.0f);
+        sum += value;
+    }
+
+    // The mean of a uniform [0, 1) distribution is 0.5
+    TEST_ASSERT_FLOAT_WITHIN(0.02f, 0.5f, sum / 10000.0f);
+}
+
+void test_radicalInverse_HaltonPoints(void) {
+    // Halton points used for progressive jitter: 1/2, 1/4, 3/4 in base 2 and 1/3, 2/3, 1/9 in base 3
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.5f, radicalInverse(1, 2));
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.25f, radicalInverse(2, 2));
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.75f, radicalInverse(3, 2));
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 1.0f / 3.0f, radicalInverse(1, 3));
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 2.0f / 3.0f, radicalInverse(2, 3));
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 1.0f / 9.0f, radicalInverse(3, 3));
+}
+
+void test_ComputeSurfaceColorSampled_ConvergesToFullLoop(void) {
+    Scene scene;
+    initScene(&scene, 5, 5, 5, 16, 5, 5);
+
+    // Dim lights so a single weighted sample never clips and the average stays unbiased
+    LightMaterial material = {{255, 255, 255, 255}, 0.02f};
+    for (int i = 0; i < 16; i++)
+    {
+        addPointLight(&scene, material, (Vector){(float)(i % 4) - 1.5f, 1.0f, (float)(i / 4) - 1.5f}, 3.0f);
+    }
+    addSpotLight(&scene, material, (Vector){0.0f, 2.0f, 0.0f}, (Vector){0.0f, 1.0f, 0.0f}, 40.0f, 20.0f);
+
+    AABB sceneBounds = {{-3.0f, -1.0f, -3.0f}, {3.0f, 3.0f, 3.0f}};
+    scene.lightBuffer = buildLightBuffer(&scene.lights);
+    scene.lightBvhRoot = buildLightBVH(&scene.lights, &sceneBounds);
+
+    Material surface = {{255, 255, 255, 255}, 0.0f, 4.0f};
+    Vector point = {0.2f, 0.0f, -0.3f};
+    SDL_Color expected = computeSurfaceColor(&scene, point, (Vector){0, 1, 0}, (Vector){0, 1, 1}, surface);
+
+    // Average many frames through the accumulation buffer like the renderer does
+    AccumulationBuffer accumulation;
+    initAccumulationBuffer(&accumulation, 1, 1);
+    FrameBuffer frame;
+    initFrameBuffer(&frame, 1, 1);
+    for (Uint32 frameNumber = 0; frameNumber < 2000; frameNumber++)
+    {
+        Uint32 state = pixelSeed(0, 0, frameNumber);
+        FloatColor sample = computeSurfaceRadianceSampled(&scene, point, (Vector){0, 1, 0}, (Vector){0, 1, 1}, surface, 4, &state);
+        frame.red[0] = sample.r;
+        frame.green[0] = sample.g;
+        frame.blue[0] = sample.b;
+        accumulateFrameBuffer(&accumulation, &frame);
+        finishAccumulationFrame(&accumulation);
+    }
+    FloatColor average = {frame.red[0], frame.green[0], frame.blue[0]};
+
+    TEST_ASSERT_FLOAT_WITHIN(3.0f, expected.r, average.r * 255.0f);
+    TEST_ASSERT_FLOAT_WITHIN(3.0f, expected.g, average.g * 255.0f);
+    TEST_ASSERT_FLOAT_WITHIN(3.0f, expected.b, average.b * 255.0f);
+
+    freeFrameBuffer(&frame);
+    freeAccumulationBuffer(&accumulation);
+    freeScene(&scene);
+}
+
+void test_ComputeSurfaceRadianceSampled_StaysUnclampedWithOneShadowRayPerSample(void) {
+    Scene scene;
+    initScene(&scene, 5, 5, 5, 16, 5, 5);
+
+    // Brighter lights, one sample: a single weighted sample often exceeds 1 though the full loop does not
+    LightMaterial material = {{255, 255, 255, 255}, 0.06f};
+    for (int i = 0; i < 16; i++)
+    {
+        addPointLight(&scene, material, (Vector){(float)(i % 4) - 1.5f, 1.0f, (float)(i / 4) - 1.5f}, 3.0f);
+    }
+    AABB sceneBounds = {{-3.0f, -1.0f, -3.0f}, {3.0f, 3.0f, 3.0f}};
+    scene.lightBuffer = buildLightBuffer(&scene.lights);
+    scene.lightBvhRoot = buildLightBVH(&scene.lights, &sceneBounds);
+
+    Material surface = {{255, 255, 255, 255}, 0.0f, 4.0f};
+    Vector point = {0.2f, 0.0f, -0.3f};
+    SDL_Color expected = computeSurfaceColor(&scene, point, (Vector){0, 1, 0}, (Vector){0, 1, 1}, surface);
+    TEST_ASSERT_TRUE(expected.r < 255);
+
+    // Every sample traces at most one shadow ray, and the mean of the raw samples is the full loop's color
+    float sum = 0.0f;
+    float brightest = 0.0f;
+    resetShadowCacheStats();
+    for (Uint32 frame = 0; frame < 4000; frame++)
+    {
+        Uint32 state = pixelSeed(0, 0, frame);
+        FloatColor sample = computeSurfaceRadianceSampled(&scene, point, (Vector){0, 1, 0}, (Vector){0, 1, 1}, surface, 1, &state);
+        sum += sample.r;
+        brightest = SDL_max(brightest, sample.r);
+    }
+    ShadowCacheStats shadowRays = getShadowCacheStats();
+    TEST_ASSERT_TRUE(shadowRays.hits + shadowRays.misses <= 4000);
+    TEST_ASSERT_TRUE(brightest > 1.0f);
+    TEST_ASSERT_FLOAT_WITHIN(3.0f, expected.r, sum / 4000.0f * 255.0f);
+
+    freeScene(&scene);
+}
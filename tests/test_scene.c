@@ -192,4 +192,40 @@ void test_isPointInShadowSpot(void){
     Vector point = {0,0,0};
 
     TEST_ASSERT_EQUAL_INT(1, isPointInShadowSpot(point,&scene.lights.spotLights[0],&scene));
-}
\ No newline at end of file
+}
+
+void test_isPointInShadow_OccluderCache(void){
+    Scene scene;
+    initScene(&scene, MAX_SPHERES, MAX_PLANES, MAX_TRIANGLES, MAX_POINT_LIGHTS, MAX_DIRECTIONAL_LIGHTS, MAX_SPOT_LIGHTS);
+
+    LightMaterial material = {{255, 255, 255, 255}, 1.0f};
+    addPointLight(&scene, material, (Vector){0.0f, 5.0f, 0.0f}, 10.0f);
+
+    // Spheres off to the side are tested before the plane that actually blocks the light
+    Material materialS = {{255, 0, 0, 255}, 0.0f, 1.0f};
+    for (int i = 0; i < MAX_SPHERES; i++)
+    {
+        addSphere(&scene, (Vector){20.0f + i, 0.0f, 0.0f}, 0.5f, materialS);
+    }
+    Material materialP = {{0, 255, 0, 255}, 0.8f};
+    addPlane(&scene, (Vector){0.0f, 1.0f, 0.0f}, (Vector){0.0f, 1.0f, 0.0f}, 10.0f, 10.0f, materialP);
+
+    resetShadowCacheStats();
+
+    // Neighbouring points are blocked by the same plane, so only the first one walks the scene
+    for (int i = 0; i < 8; i++)
+    {
+        Vector point = {0.1f * i, 0.0f, 0.0f};
+        TEST_ASSERT_EQUAL_INT(1, isPointInShadow(point, &scene.lights.pointLights[0], &scene));
+    }
+
+    ShadowCacheStats stats = getShadowCacheStats();
+    TEST_ASSERT_TRUE(stats.misses <= 1);
+    TEST_ASSERT_EQUAL_INT(8, (int)(stats.hits + stats.misses));
+
+    // A point outside the plane is lit: the cached test fails and the full walk finds nothing
+    TEST_ASSERT_EQUAL_INT(0, isPointInShadow((Vector){0.0f, 0.0f, 8.0f}, &scene.lights.pointLights[0], &scene));
+    TEST_ASSERT_EQUAL_INT((int)stats.misses + 1, (int)getShadowCacheStats().misses);
+
+    freeScene(&scene);
+}
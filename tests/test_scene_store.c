@@ -0,0 +1,176 @@
+#include "unity.h"
+#include "scene_store.h"
+#include "bvh.h"
+
+#define STORE_TEST_COMMITS 200
+
+// Helper function that builds a scene with one sphere and one point light
+static void initStoreTestScene(Scene* scene)
+{
+    initScene(scene, 1, 1, 1, 1, 1, 1);
+    addSphere(scene, (Vector){0, 0, -5}, 1.0f, (Material){{255, 255, 255, 255}, 0.0f, 16.0f});
+    addPointLight(scene, (LightMaterial){{255, 255, 255, 255}, 1.0f}, (Vector){0, 5, 0}, 20.0f);
+    scene->bvhRoot = buildBVH(&scene->objects);
+}
+
+void test_commitSceneEdits_KeepsOldVersionForReadersUntilReleased(void) {
+    Scene scene;
+    initStoreTestScene(&scene);
+    SceneStore store;
+    TEST_ASSERT_TRUE(initSceneStore(&store, &scene));
+    TEST_ASSERT_FALSE(commitSceneEdits(&store)); // Nothing queued
+
+    // A frame holds the first version while a sphere is added past the scene's limit
+    SceneVersion* first = acquireSceneVersion(&store);
+    SceneEdit addition = {SCENE_EDIT_ADD_SPHERE, .sphere = {{3, 0, -5}, 1.0f, {{255, 0, 0, 255}, 0.0f, 16.0f}}};
+    TEST_ASSERT_TRUE(queueSceneEdit(&store, &addition));
+    TEST_ASSERT_TRUE(commitSceneEdits(&store));
+
+    SceneVersion* second = acquireSceneVersion(&store);
+    TEST_ASSERT_TRUE(second != first);
+    TEST_ASSERT_EQUAL_UINT64(2, second->number);
+    TEST_ASSERT_EQUAL_INT(1, first->scene.objects.sphereCount);
+    TEST_ASSERT_EQUAL_INT(2, second->scene.objects.sphereCount);
+    TEST_ASSERT_TRUE(second->scene.geometryRevision != first->scene.geometryRevision);
+    TEST_ASSERT_TRUE(second->scene.bvhRoot != first->scene.bvhRoot);
+    TEST_ASSERT_NOT_NULL(second->scene.lightBuffer);
+    TEST_ASSERT_EQUAL_INT(2, SDL_GetAtomicInt(&store.liveVersions));
+
+    // The first version goes away with the last frame that used it
+    releaseSceneVersion(first);
+    TEST_ASSERT_EQUAL_INT(1, SDL_GetAtomicInt(&store.liveVersions));
+
+    // Moving a light shares the BVH, which keeps the version that built it alive
+    SceneEdit move = {SCENE_EDIT_MOVE_POINT_LIGHT, .movePointLight = {0, {1, 5, 0}}};
+    queueSceneEdit(&store, &move);
+    TEST_ASSERT_TRUE(commitSceneEdits(&store));
+    SceneVersion* third = acquireSceneVersion(&store);
+    TEST_ASSERT_TRUE(third->scene.bvhRoot == second->scene.bvhRoot);
+    TEST_ASSERT_EQUAL_FLOAT(1.0f, third->scene.lights.pointLights[0].position.x);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, second->scene.lights.pointLights[0].position.x);
+    TEST_ASSERT_TRUE(third->scene.lightsRevision != second->scene.lightsRevision);
+    TEST_ASSERT_TRUE(third->scene.geometryRevision == second->scene.geometryRevision);
+    releaseSceneVersion(second);
+    TEST_ASSERT_EQUAL_INT(2, SDL_GetAtomicInt(&store.liveVersions));
+
+    releaseSceneVersion(third);
+    freeSceneStore(&store);
+}
+
+void test_commitSceneEdits_RefitsACopyOfTheBVHForMovedObjects(void) {
+    Scene scene;
+    initStoreTestScene(&scene);
+    SceneStore store;
+    TEST_ASSERT_TRUE(initSceneStore(&store, &scene));
+    SceneVersion* first = acquireSceneVersion(&store);
+
+    // The sphere moves up out of the view axis; the frame on the first version still sees it where it was
+    SceneEdit move = {SCENE_EDIT_MOVE_SPHERE, .moveSphere = {0, {0, 3, -5}}};
+    queueSceneEdit(&store, &move);
+    TEST_ASSERT_TRUE(commitSceneEdits(&store));
+    SceneVersion* second = acquireSceneVersion(&store);
+    TEST_ASSERT_TRUE(second->scene.bvhRoot != first->scene.bvhRoot);
+    TEST_ASSERT_TRUE(second->scene.geometryRevision != first->scene.geometryRevision);
+
+    ObjectIntersection hit;
+    Ray viewAxis = {{0, 0, 0}, {0, 0, -1}};
+    TEST_ASSERT_TRUE(intersectBVH(viewAxis, first->scene.bvhRoot, &hit));
+    TEST_ASSERT_FALSE(intersectBVH(viewAxis, second->scene.bvhRoot, &hit));
+    TEST_ASSERT_TRUE(intersectBVH((Ray){{0, 3, 0}, {0, 0, -1}}, second->scene.bvhRoot, &hit));
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 4.0f, second->scene.bvhRoot->bounds.max.y);
+
+    releaseSceneVersion(first);
+    releaseSceneVersion(second);
+    TEST_ASSERT_EQUAL_INT(1, SDL_GetAtomicInt(&store.liveVersions));
+    freeSceneStore(&store);
+}
+
+void test_commitSceneEdits_RefitsTheSpareBVHOfAFreedVersion(void) {
+    Scene scene;
+    initStoreTestScene(&scene);
+    SceneStore store;
+    TEST_ASSERT_TRUE(initSceneStore(&store, &scene));
+    BVHNode* firstTree = store.current->scene.bvhRoot;
+
+    // Once no frame holds the first version its tree is kept as the spare
+    SceneEdit move = {SCENE_EDIT_MOVE_SPHERE, .moveSphere = {0, {0, 3, -5}}};
+    queueSceneEdit(&store, &move);
+    TEST_ASSERT_TRUE(commitSceneEdits(&store));
+    TEST_ASSERT_TRUE(store.spareBVH == firstTree);
+    BVHNode* secondTree = store.current->scene.bvhRoot;
+
+    // The next move refits the spare instead of copying the current tree, and the trees swap roles
+    move.moveSphere.position = (Vector){0, 0, -5};
+    queueSceneEdit(&store, &move);
+    TEST_ASSERT_TRUE(commitSceneEdits(&store));
+    TEST_ASSERT_TRUE(store.current->scene.bvhRoot == firstTree);
+    TEST_ASSERT_TRUE(store.spareBVH == secondTree);
+
+    ObjectIntersection hit;
+    TEST_ASSERT_TRUE(intersectBVH((Ray){{0, 0, 0}, {0, 0, -1}}, store.current->scene.bvhRoot, &hit));
+    TEST_ASSERT_FALSE(intersectBVH((Ray){{0, 3, 0}, {0, 0, -1}}, store.current->scene.bvhRoot, &hit));
+
+    // An addition builds a new tree; the spare no longer matches the objects and is dropped at the next move
+    SceneEdit addition = {SCENE_EDIT_ADD_SPHERE, .sphere = {{3, 0, -5}, 1.0f, {{255, 0, 0, 255}, 0.0f, 16.0f}}};
+    queueSceneEdit(&store, &addition);
+    TEST_ASSERT_TRUE(commitSceneEdits(&store));
+    queueSceneEdit(&store, &move);
+    TEST_ASSERT_TRUE(commitSceneEdits(&store));
+    TEST_ASSERT_EQUAL_INT(2, countBVHObjects(store.current->scene.bvhRoot));
+    TEST_ASSERT_EQUAL_INT(2, countBVHObjects(store.spareBVH));
+    TEST_ASSERT_EQUAL_INT(1, SDL_GetAtomicInt(&store.liveVersions));
+
+    freeSceneStore(&store);
+}
+
+// Editor thread: alternately adds spheres and moves the light, committing after every edit
+static int editScene(void* data)
+{
+    SceneStore* store = (SceneStore*)data;
+    for (int i = 0; i < STORE_TEST_COMMITS; i++)
+    {
+        SceneEdit edit;
+        if (i % 2 == 0)
+        {
+            edit = (SceneEdit){SCENE_EDIT_ADD_SPHERE, .sphere = {{(float)(i % 10) - 5.0f, -3.0f, -8.0f}, 0.5f, {{0, 255, 0, 255}, 0.0f, 16.0f}}};
+        }
+        else
+        {
+            edit = (SceneEdit){SCENE_EDIT_MOVE_POINT_LIGHT, .movePointLight = {0, {(float)i, 5, 0}}};
+        }
+        queueSceneEdit(store, &edit);
+        commitSceneEdits(store);
+    }
+    return 0;
+}
+
+void test_acquireSceneVersion_TracesConsistentlyWhileAnotherThreadCommits(void) {
+    Scene scene;
+    initStoreTestScene(&scene);
+    SceneStore store;
+    TEST_ASSERT_TRUE(initSceneStore(&store, &scene));
+    SDL_Thread* editor = SDL_CreateThread(editScene, "editor", &store);
+    TEST_ASSERT_NOT_NULL(editor);
+
+    // Each "frame" traces the version it acquired; the first sphere is in every version
+    int misses = 0;
+    Uint64 lastNumber = 0;
+    while (lastNumber < STORE_TEST_COMMITS + 1)
+    {
+        SceneVersion* version = acquireSceneVersion(&store);
+        TEST_ASSERT_TRUE(version->number >= lastNumber);
+        lastNumber = version->number;
+
+        ObjectIntersection hit;
+        misses += !intersectBVH((Ray){{0, 0, 0}, {0, 0, -1}}, version->scene.bvhRoot, &hit);
+        TEST_ASSERT_TRUE(version->scene.objects.sphereCount >= 1);
+        releaseSceneVersion(version);
+    }
+    SDL_WaitThread(editor, NULL);
+    TEST_ASSERT_EQUAL_INT(0, misses);
+
+    // Only the current version survives, with the version whose BVH it shares (the last edit moved the light)
+    TEST_ASSERT_EQUAL_INT(2, SDL_GetAtomicInt(&store.liveVersions));
+    TEST_ASSERT_EQUAL_INT(1 + STORE_TEST_COMMITS / 2, store.current->scene.objects.sphereCount);
+    freeSceneStore(&store);
+}
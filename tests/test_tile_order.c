@@ -0,0 +1,120 @@
+#include "unity.h"
+#include "tile_order.h"
+
+#include <stdlib.h>
+
+void test_buildTileSchedule_CoversEveryPixelOnce(void) {
+    int width = 70, height = 45, tileSize = 16;
+    int* coverage = calloc(width * height, sizeof(int));
+
+    for (int order = 0; order < TILE_ORDER_COUNT; order++)
+    {
+        TileSchedule schedule;
+        buildTileSchedule(&schedule, width, height, tileSize, (TileOrder)order);
+        TEST_ASSERT_EQUAL_INT(5 * 3, schedule.count);
+
+        for (int i = 0; i < schedule.count; i++)
+        {
+            Tile* tile = &schedule.tiles[i];
+            for (int y = tile->y; y < tile->y + tile->height; y++)
+            {
+                for (int x = tile->x; x < tile->x + tile->width; x++)
+                {
+                    coverage[y * width + x]++;
+                }
+            }
+        }
+        freeTileSchedule(&schedule);
+    }
+
+    // Every order visits every pixel exactly once
+    for (int i = 0; i < width * height; i++)
+    {
+        TEST_ASSERT_EQUAL_INT(TILE_ORDER_COUNT, coverage[i]);
+    }
+    free(coverage);
+}
+
+void test_buildTileSchedule_HilbertStepsToNeighbours(void) {
+    TileSchedule schedule;
+    buildTileSchedule(&schedule, 128, 128, 16, TILE_ORDER_HILBERT);
+    TEST_ASSERT_EQUAL_INT(64, schedule.count);
+
+    // On a power-of-two grid each tile shares an edge with the one rendered before it
+    for (int i = 1; i < schedule.count; i++)
+    {
+        int dx = abs(schedule.tiles[i].x - schedule.tiles[i - 1].x);
+        int dy = abs(schedule.tiles[i].y - schedule.tiles[i - 1].y);
+        TEST_ASSERT_EQUAL_INT(16, dx + dy);
+    }
+
+    freeTileSchedule(&schedule);
+
+    TEST_ASSERT_EQUAL_UINT32(0x0Fu, mortonIndex(3, 3));
+    TEST_ASSERT_EQUAL_UINT32(0x02u, mortonIndex(0, 1));
+}
+
+void test_scheduleTilesByCost_SplitsHotTilesAndSortsLargestFirst(void) {
+    int width = 70, height = 45, tileSize = 16;
+    TileSchedule schedule;
+    buildTileSchedule(&schedule, width, height, tileSize, TILE_ORDER_COST);
+    TEST_ASSERT_EQUAL_INT(5 * 3, schedule.count);
+    Arena scratch;
+    TEST_ASSERT_TRUE(initArena(&scratch, 1024, 0));
+
+    // Every tile costs 10 except a hot one at (32, 16) and a warm one on the right edge
+    for (int i = 0; i < schedule.count; i++)
+    {
+        Tile* tile = &schedule.tiles[i];
+        Uint64 cost = 10;
+        if (tile->x == 32 && tile->y == 16) cost = 1000;
+        if (tile->x == 64 && tile->y == 0) cost = 30;
+        recordTileCost(&schedule, i, cost);
+    }
+    scheduleTilesByCost(&schedule, &scratch);
+
+    // The hot tile comes first as four 8x8 quadrants, then the warm tile, then the rest
+    TEST_ASSERT_EQUAL_INT(5 * 3 + 3, schedule.count);
+    for (int i = 0; i < 4; i++)
+    {
+        TEST_ASSERT_EQUAL_INT(8, schedule.tiles[i].width);
+        TEST_ASSERT_EQUAL_INT(8, schedule.tiles[i].height);
+        TEST_ASSERT_TRUE(schedule.tiles[i].x >= 32 && schedule.tiles[i].x < 48);
+        TEST_ASSERT_TRUE(schedule.tiles[i].y >= 16 && schedule.tiles[i].y < 32);
+    }
+    TEST_ASSERT_EQUAL_INT(64, schedule.tiles[4].x);
+    TEST_ASSERT_EQUAL_INT(0, schedule.tiles[4].y);
+
+    // Every pixel is still covered once, and a second pass without new costs keeps the order
+    int* coverage = calloc(width * height, sizeof(int));
+    for (int i = 0; i < schedule.count; i++)
+    {
+        Tile* tile = &schedule.tiles[i];
+        for (int y = tile->y; y < tile->y + tile->height; y++)
+        {
+            for (int x = tile->x; x < tile->x + tile->width; x++)
+            {
+                coverage[y * width + x]++;
+            }
+        }
+    }
+    for (int i = 0; i < width * height; i++)
+    {
+        TEST_ASSERT_EQUAL_INT(1, coverage[i]);
+    }
+    free(coverage);
+
+    scheduleTilesByCost(&schedule, &scratch);
+    TEST_ASSERT_EQUAL_INT(5 * 3 + 3, schedule.count);
+
+    // Once the hot tile cools down it is merged back into one tile
+    for (int i = 0; i < schedule.count; i++)
+    {
+        recordTileCost(&schedule, i, 10);
+    }
+    scheduleTilesByCost(&schedule, &scratch);
+    TEST_ASSERT_EQUAL_INT(5 * 3, schedule.count);
+
+    freeArena(&scratch);
+    freeTileSchedule(&schedule);
+}
@@ -0,0 +1,92 @@
+#include "unity.h"
+#include "wavefront.h"
+
+#define WAVEFRONT_TEST_WIDTH 48
+#define WAVEFRONT_TEST_HEIGHT 32
+
+void test_rayBinKey_OrdersByOctantThenCell(void) {
+    AABB bounds = {{0.0f, 0.0f, 0.0f}, {10.0f, 10.0f, 10.0f}};
+    Vector up = {0.0f, 1.0f, 0.0f};
+    Vector down = {0.0f, -1.0f, 0.0f};
+
+    Uint32 corner = rayBinKey((Vector){0.0f, 0.0f, 0.0f}, up, &bounds);
+    Uint32 near = rayBinKey((Vector){0.05f, 0.05f, 0.05f}, up, &bounds);
+    Uint32 far = rayBinKey((Vector){9.0f, 9.0f, 9.0f}, up, &bounds);
+    Uint32 flipped = rayBinKey((Vector){0.0f, 0.0f, 0.0f}, down, &bounds);
+
+    // Neighbouring origins get neighbouring keys, and any ray of another octant sorts after all of them
+    TEST_ASSERT_TRUE(near - corner < far - corner);
+    TEST_ASSERT_TRUE(flipped > far);
+
+    // Origins outside the bounds are clamped into the edge cells
+    TEST_ASSERT_EQUAL_UINT32(corner, rayBinKey((Vector){-5.0f, -5.0f, -5.0f}, up, &bounds));
+}
+
+void test_renderTileWavefront_SortingKeepsImage(void) {
+    Camera camera;
+    Scene scene;
+    initialize_scene(WAVEFRONT_TEST_WIDTH, WAVEFRONT_TEST_HEIGHT, &camera, &scene);
+
+    RenderSettings settings = {0, 0, TILE_ORDER_HILBERT, {1.0f, TONE_MAP_CLAMP, 0, 0}, 1, 0.1f, 0.0f, MOTION_FULL, 3, 1, 0, 0};
+    RenderState unsorted, sorted;
+    initRenderState(&unsorted, WAVEFRONT_TEST_WIDTH, WAVEFRONT_TEST_HEIGHT, &settings);
+    initRenderState(&sorted, WAVEFRONT_TEST_WIDTH, WAVEFRONT_TEST_HEIGHT, &settings);
+
+    const SDL_PixelFormatDetails* format = SDL_GetPixelFormatDetails(SDL_PIXELFORMAT_RGBA32);
+    static Uint32 pixels[WAVEFRONT_TEST_WIDTH * WAVEFRONT_TEST_HEIGHT];
+    renderFrame(&unsorted, &camera, &scene, &settings, pixels, WAVEFRONT_TEST_WIDTH, format);
+    settings.raySortBatch = 64;
+    renderFrame(&sorted, &camera, &scene, &settings, pixels, WAVEFRONT_TEST_WIDTH, format);
+
+    // Sorting changes the order rays are traced in, not what they find
+    TEST_ASSERT_TRUE(sorted.stats.shadowRays > 0);
+    TEST_ASSERT_EQUAL_INT((int)unsorted.stats.shadowRays, (int)sorted.stats.shadowRays);
+    for (int bounces = 0; bounces <= MAX_REFLECTION_BOUNCES; bounces++)
+    {
+        TEST_ASSERT_EQUAL_INT((int)unsorted.stats.bounceHistogram[bounces], (int)sorted.stats.bounceHistogram[bounces]);
+    }
+    for (int i = 0; i < WAVEFRONT_TEST_WIDTH * WAVEFRONT_TEST_HEIGHT; i++)
+    {
+        TEST_ASSERT_FLOAT_WITHIN(1e-5f, unsorted.frameBuffer.red[i], sorted.frameBuffer.red[i]);
+        TEST_ASSERT_FLOAT_WITHIN(1e-5f, unsorted.frameBuffer.green[i], sorted.frameBuffer.green[i]);
+        TEST_ASSERT_FLOAT_WITHIN(1e-5f, unsorted.frameBuffer.blue[i], sorted.frameBuffer.blue[i]);
+    }
+
+    freeRenderState(&unsorted);
+    freeRenderState(&sorted);
+    freeBVH(scene.bvhRoot);
+    freeScene(&scene);
+}
+
+void test_renderTileWavefront_ShadowPacketsMatchPerRayShadows(void) {
+    Camera camera;
+    Scene scene;
+    initialize_scene(WAVEFRONT_TEST_WIDTH, WAVEFRONT_TEST_HEIGHT, &camera, &scene);
+    addSphere(&scene, (Vector){0.0f, 0.6f, 2.5f}, 0.5f, (Material){{0, 0, 255, 255}, 0.0f, 16.0f});
+    freeBVH(scene.bvhRoot);
+    scene.bvhRoot = buildBVH(&scene.objects);
+
+    RenderSettings settings = {0, 0, TILE_ORDER_HILBERT, {1.0f, TONE_MAP_CLAMP, 0, 0}, 1, 0.1f, 0.0f, MOTION_FULL, 2, 1, 0, 0};
+    RenderState perRay, packets;
+    initRenderState(&perRay, WAVEFRONT_TEST_WIDTH, WAVEFRONT_TEST_HEIGHT, &settings);
+    initRenderState(&packets, WAVEFRONT_TEST_WIDTH, WAVEFRONT_TEST_HEIGHT, &settings);
+
+    const SDL_PixelFormatDetails* format = SDL_GetPixelFormatDetails(SDL_PIXELFORMAT_RGBA32);
+    static Uint32 perRayPixels[WAVEFRONT_TEST_WIDTH * WAVEFRONT_TEST_HEIGHT];
+    static Uint32 packetPixels[WAVEFRONT_TEST_WIDTH * WAVEFRONT_TEST_HEIGHT];
+    renderFrame(&perRay, &camera, &scene, &settings, perRayPixels, WAVEFRONT_TEST_WIDTH, format);
+    settings.shadowPackets = 1;
+    settings.raySortBatch = 64;
+    renderFrame(&packets, &camera, &scene, &settings, packetPixels, WAVEFRONT_TEST_WIDTH, format);
+
+    // Same shadow rays, several per packet, and the same shadows
+    TEST_ASSERT_EQUAL_INT((int)perRay.stats.shadowRays, (int)packets.stats.shadowRays);
+    TEST_ASSERT_TRUE(packets.stats.shadowPackets > 0);
+    TEST_ASSERT_TRUE(packets.stats.shadowRays > 2 * packets.stats.shadowPackets);
+    TEST_ASSERT_EQUAL_UINT32_ARRAY(perRayPixels, packetPixels, WAVEFRONT_TEST_WIDTH * WAVEFRONT_TEST_HEIGHT);
+
+    freeRenderState(&perRay);
+    freeRenderState(&packets);
+    freeBVH(scene.bvhRoot);
+    freeScene(&scene);
+}